@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""Host client for the LoRa DV serial control and telemetry protocol.
+
+Frames are KISS framed, content is type byte, payload and CRC-16/CCITT
+(little endian) of type and payload. Requires pyserial.
+
+Examples:
+  loradv_serial.py /dev/ttyUSB0 ping
+  loradv_serial.py /dev/ttyUSB0 get LoraFreqRx --type int
+  loradv_serial.py /dev/ttyUSB0 set LoraFreqRx 433775000 --type int
+  loradv_serial.py /dev/ttyUSB0 telemetry --interval 1000
+  loradv_serial.py /dev/ttyUSB0 rx voice.bin
+  loradv_serial.py /dev/ttyUSB0 tx voice.bin
+  loradv_serial.py /dev/ttyUSB0 data-tx "hello"
+  loradv_serial.py /dev/ttyUSB0 data-rx
+  loradv_serial.py /dev/ttyUSB0 tasks
+  loradv_serial.py /dev/ttyUSB0 set-key 1 <64 hex digits>
+  loradv_serial.py /dev/ttyUSB0 key-slot 1
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+FEND, FESC, TFEND, TFESC = 0xC0, 0xDB, 0xDC, 0xDD
+
+CMD_PING = 0x01
+CMD_GET_CONFIG = 0x02
+CMD_SET_CONFIG = 0x03
+CMD_REBOOT = 0x04
+CMD_PTT = 0x05
+CMD_VOICE_TX = 0x06
+CMD_TELEMETRY = 0x07
+CMD_VOICE_RX_STREAM = 0x08
+CMD_DATA_TX = 0x09
+CMD_TASK_STATS = 0x0A
+CMD_SET_KEY = 0x0B
+CMD_SET_KEY_ID = 0x0C
+RSP_FLAG = 0x80
+EVT_VOICE_RX = 0x90
+EVT_TELEMETRY = 0x91
+EVT_DATA_RX = 0x92
+RSP_ERROR = 0xFF
+
+TELEMETRY_FIELDS = (
+    "rx_packets", "rx_errors", "rx_lost", "rx_dropped",
+    "tx_packets", "tx_errors", "tx_dropped", "airtime_ms",
+    "audio_tx_frames", "audio_rx_frames", "audio_tx_dropped", "codec_bit_rate",
+    "serial_dropped",
+)
+
+# value representation as stored in settings
+VALUE_TYPES = {"int": "<i", "bool": "<B", "float": "<f"}
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_frame(frame_type, payload=b""):
+    data = bytes([frame_type]) + payload
+    data += struct.pack("<H", crc16(data))
+    out = bytearray([FEND])
+    for b in data:
+        if b == FEND:
+            out += bytes([FESC, TFEND])
+        elif b == FESC:
+            out += bytes([FESC, TFESC])
+        else:
+            out.append(b)
+    out.append(FEND)
+    return bytes(out)
+
+
+class LoraDvClient:
+
+    def __init__(self, port, baud_rate=115200, timeout=1.0):
+        self.serial = serial.Serial(port, baud_rate, timeout=0.05)
+        self.timeout = timeout
+        self.frame = bytearray()
+        self.is_escaped = False
+
+    def send(self, frame_type, payload=b""):
+        self.serial.write(encode_frame(frame_type, payload))
+
+    def frames(self):
+        """Yields (type, payload) of valid frames, log text between frames is skipped."""
+        while True:
+            chunk = self.serial.read(256)
+            if not chunk:
+                yield None
+                continue
+            for b in chunk:
+                if b == FEND:
+                    if len(self.frame) >= 3 and crc16(self.frame[:-2]) == struct.unpack("<H", self.frame[-2:])[0]:
+                        yield self.frame[0], bytes(self.frame[1:-2])
+                    self.frame = bytearray()
+                    self.is_escaped = False
+                elif b == FESC:
+                    self.is_escaped = True
+                else:
+                    if self.is_escaped:
+                        b = FEND if b == TFEND else FESC if b == TFESC else b
+                        self.is_escaped = False
+                    self.frame.append(b)
+
+    def request(self, frame_type, payload=b""):
+        self.send(frame_type, payload)
+        deadline = time.time() + self.timeout
+        for frame in self.frames():
+            if time.time() > deadline:
+                raise TimeoutError("no response")
+            if frame is None:
+                continue
+            rsp_type, rsp_payload = frame
+            if rsp_type == (frame_type | RSP_FLAG):
+                return rsp_payload
+            if rsp_type == RSP_ERROR and rsp_payload[:1] == bytes([frame_type]):
+                raise RuntimeError("command 0x%02x failed, error %d" % (frame_type, rsp_payload[1]))
+
+    def ping(self):
+        return self.request(CMD_PING).decode()
+
+    def get_config(self, name, value_type):
+        payload = self.request(CMD_GET_CONFIG, name.encode() + b"\0")
+        value = payload[len(name) + 1:]
+        return struct.unpack(VALUE_TYPES[value_type], value)[0] if value_type in VALUE_TYPES else value
+
+    def set_config(self, name, value, value_type):
+        raw = struct.pack(VALUE_TYPES[value_type], value) if value_type in VALUE_TYPES else bytes.fromhex(value)
+        self.request(CMD_SET_CONFIG, name.encode() + b"\0" + raw)
+
+    def reboot(self):
+        self.request(CMD_REBOOT)
+
+    def ptt(self, is_on):
+        self.request(CMD_PTT, bytes([1 if is_on else 0]))
+
+    def set_telemetry(self, interval_ms):
+        self.request(CMD_TELEMETRY, struct.pack("<H", interval_ms))
+
+    def set_voice_rx_stream(self, is_enabled):
+        self.request(CMD_VOICE_RX_STREAM, bytes([1 if is_enabled else 0]))
+
+    def send_voice(self, packet):
+        self.send(CMD_VOICE_TX, packet)
+
+    def send_data(self, message):
+        self.request(CMD_DATA_TX, message)
+
+    def get_task_stats(self):
+        return parse_task_stats(self.request(CMD_TASK_STATS))
+
+    def set_key(self, key_id, key):
+        self.request(CMD_SET_KEY, bytes([key_id]) + key)
+
+    def set_key_id(self, key_id):
+        self.request(CMD_SET_KEY_ID, bytes([key_id]))
+
+
+def parse_telemetry(payload):
+    count = len(TELEMETRY_FIELDS)
+    values = struct.unpack("<%dIbb" % count, payload[:count * 4 + 2])
+    result = dict(zip(TELEMETRY_FIELDS, values[:count]))
+    result["rssi"] = values[count]
+    result["snr"] = values[count + 1] / 4.0
+    return result
+
+
+def parse_task_stats(payload):
+    """Core load and peak per core, stack usage and load per task, load is None if not available."""
+    core_count = payload[0]
+    cores = [{"load": payload[1 + 2 * i], "peak_load": payload[2 + 2 * i]} for i in range(core_count)]
+    tasks = []
+    pos = 1 + 2 * core_count
+    while pos < len(payload):
+        stack_size, stack_free, load, peak_load = struct.unpack("<IIBB", payload[pos:pos + 10])
+        name_end = payload.index(b"\0", pos + 10)
+        tasks.append({
+            "name": payload[pos + 10:name_end].decode(),
+            "stack_size": stack_size,
+            "stack_free": stack_free,
+            "load": None if load == 0xFF else load,
+            "peak_load": None if peak_load == 0xFF else peak_load,
+        })
+        pos = name_end + 1
+    return {"cores": cores, "tasks": tasks}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="LoRa DV serial protocol client")
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("ping")
+    get_parser = sub.add_parser("get")
+    get_parser.add_argument("name")
+    get_parser.add_argument("--type", choices=list(VALUE_TYPES) + ["raw"], default="int")
+    set_parser = sub.add_parser("set")
+    set_parser.add_argument("name")
+    set_parser.add_argument("value")
+    set_parser.add_argument("--type", choices=list(VALUE_TYPES) + ["raw"], default="int")
+    sub.add_parser("reboot")
+    ptt_parser = sub.add_parser("ptt")
+    ptt_parser.add_argument("state", choices=["on", "off"])
+    telemetry_parser = sub.add_parser("telemetry")
+    telemetry_parser.add_argument("--interval", type=int, default=1000)
+    rx_parser = sub.add_parser("rx", help="record received voice packets, length prefixed")
+    rx_parser.add_argument("file")
+    tx_parser = sub.add_parser("tx", help="transmit length prefixed voice packets")
+    tx_parser.add_argument("file")
+    tx_parser.add_argument("--packet-ms", type=int, default=80, help="pacing between packets")
+    data_tx_parser = sub.add_parser("data-tx", help="transmit text or hex data message")
+    data_tx_parser.add_argument("message")
+    data_tx_parser.add_argument("--hex", action="store_true")
+    sub.add_parser("data-rx", help="print received data messages")
+    sub.add_parser("tasks", help="print core loads and task stack usage")
+    set_key_parser = sub.add_parser("set-key", help="store privacy key into slot 1 and above, used right away")
+    set_key_parser.add_argument("slot", type=int)
+    set_key_parser.add_argument("key", help="256 bit key as hex")
+    key_slot_parser = sub.add_parser("key-slot", help="select privacy key slot for transmission")
+    key_slot_parser.add_argument("slot", type=int)
+    args = parser.parse_args()
+
+    client = LoraDvClient(args.port, args.baud)
+    if args.command == "ping":
+        print(client.ping())
+    elif args.command == "get":
+        print(client.get_config(args.name, args.type))
+    elif args.command == "set":
+        value = {"int": int, "bool": int, "float": float}.get(args.type, str)(args.value)
+        client.set_config(args.name, value, args.type)
+        print("ok, applied after reboot")
+    elif args.command == "reboot":
+        client.reboot()
+    elif args.command == "ptt":
+        client.ptt(args.state == "on")
+    elif args.command == "telemetry":
+        client.set_telemetry(args.interval)
+        try:
+            for frame in client.frames():
+                if frame is not None and frame[0] == EVT_TELEMETRY:
+                    print(parse_telemetry(frame[1]))
+        except KeyboardInterrupt:
+            client.set_telemetry(0)
+    elif args.command == "rx":
+        client.set_voice_rx_stream(True)
+        with open(args.file, "wb") as f:
+            try:
+                for frame in client.frames():
+                    if frame is not None and frame[0] == EVT_VOICE_RX:
+                        packet = frame[1][2:]
+                        f.write(struct.pack("<H", len(packet)) + packet)
+                        print("rssi %d snr %.1f size %d" % (struct.unpack("b", frame[1][:1])[0],
+                            struct.unpack("b", frame[1][1:2])[0] / 4.0, len(packet)))
+            except KeyboardInterrupt:
+                client.set_voice_rx_stream(False)
+    elif args.command == "tx":
+        with open(args.file, "rb") as f:
+            while True:
+                header = f.read(2)
+                if len(header) < 2:
+                    break
+                client.send_voice(f.read(struct.unpack("<H", header)[0]))
+                time.sleep(args.packet_ms / 1000.0)
+    elif args.command == "data-tx":
+        client.send_data(bytes.fromhex(args.message) if args.hex else args.message.encode())
+    elif args.command == "data-rx":
+        try:
+            for frame in client.frames():
+                if frame is not None and frame[0] == EVT_DATA_RX:
+                    print("rssi %d snr %.1f: %r" % (struct.unpack("b", frame[1][:1])[0],
+                        struct.unpack("b", frame[1][1:2])[0] / 4.0, frame[1][2:]))
+        except KeyboardInterrupt:
+            pass
+    elif args.command == "tasks":
+        stats = client.get_task_stats()
+        for core_id, core in enumerate(stats["cores"]):
+            print("core %d load %d%% peak %d%%" % (core_id, core["load"], core["peak_load"]))
+        for task in stats["tasks"]:
+            load = "" if task["load"] is None else " load %d%% peak %d%%" % (task["load"], task["peak_load"])
+            print("%-14s stack %6d free %6d%s" % (task["name"], task["stack_size"], task["stack_free"], load))
+    elif args.command == "set-key":
+        key = bytes.fromhex(args.key)
+        if len(key) != 32:
+            parser.error("key must be 32 bytes")
+        client.set_key(args.slot, key)
+        print("ok")
+    elif args.command == "key-slot":
+        client.set_key_id(args.slot)
+        print("ok")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
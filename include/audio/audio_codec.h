@@ -15,10 +15,16 @@ public:
   virtual void stop() = 0;
 
   virtual int encode(uint8_t *encodedOut, int16_t *pcmIn) = 0;
-  virtual int decode(int16_t *pcmOut, uint8_t *encodedIn, uint16_t encodedSize) = 0;
+  virtual int decode(int16_t *pcmOut, const uint8_t *encodedIn, uint16_t encodedSize) = 0;
 
   virtual bool isFixedFrameSize() const = 0;
+
+  // runtime bit rate degradation when radio cannot keep up, codec must stay decodable
+  // by the receiver without any signalling, so only codecs with self describing frames support it
+  virtual bool reduceBitRate() { return false; }
+  virtual void restoreBitRate() {}
   
+  virtual int getBitRate() const = 0;
   virtual int getFrameSize() const = 0;
   virtual int getPcmFrameSize() const = 0;
   virtual int getPcmFrameBufferSize() const = 0;
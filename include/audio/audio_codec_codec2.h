@@ -5,7 +5,11 @@
 
 namespace LoraDv {
 
-class AudioCodecCodec2 : public AudioCodec {
+class AudioCodecCodec2 final : public AudioCodec {
+
+public:
+  static constexpr int CfgMaxPcmFrameSize = 320;   // 40 ms at 8 kHz, longest codec2 frame
+  static constexpr int CfgMaxFrameSize = 8;        // largest encoded frame, 3200 and 1600 modes
 
 public:
   AudioCodecCodec2();
@@ -14,15 +18,21 @@ public:
   virtual void stop() override;
 
   virtual int encode(uint8_t *encodedOut, int16_t *pcmIn) override;
-  virtual int decode(int16_t *pcmOut, uint8_t *encodedIn, uint16_t encodedSize) override;
+  virtual int decode(int16_t *pcmOut, const uint8_t *encodedIn, uint16_t encodedSize) override;
 
   virtual bool isFixedFrameSize() const override { return true; }
 
+  virtual int getBitRate() const override;
   virtual int getFrameSize() const override;
   virtual int getPcmFrameSize() const override;
   virtual int getPcmFrameBufferSize() const override;
 
+  // voicing, pitch and energy bits of the mode frame, speech is unintelligible when they are damaged
+  static bool getSensitiveBits(int mode, int &frameSize, int &offset, int &count);
+
 private:
+  static constexpr int CfgSampleRate = 8000;
+
   struct CODEC2 *codec_; 
 
   int codecSamplesPerFrame_;
@@ -6,7 +6,12 @@
 
 namespace LoraDv {
 
-class AudioCodecOpus : public AudioCodec {
+class AudioCodecOpus final : public AudioCodec {
+
+public:
+  static constexpr int CfgMaxFrameMs = 120;        // longest opus frame
+  static constexpr int CfgMaxPcmFrameSize = CFG_AUDIO_CODEC_SAMPLE_RATE / 1000 * CfgMaxFrameMs;
+  static constexpr int CfgMaxFrameSize = 1024;     // encoded frame buffer size
 
 public:
   AudioCodecOpus();
@@ -15,17 +20,21 @@ public:
   virtual void stop() override;
 
   virtual int encode(uint8_t *encodedOut, int16_t *pcmIn) override;
-  virtual int decode(int16_t *pcmOut, uint8_t *encodedIn, uint16_t encodedSize) override;
+  virtual int decode(int16_t *pcmOut, const uint8_t *encodedIn, uint16_t encodedSize) override;
 
   virtual bool isFixedFrameSize() const override { return false; }
 
+  virtual bool reduceBitRate() override;
+  virtual void restoreBitRate() override;
+
+  virtual int getBitRate() const override { return currentBitRate_; }
   virtual int getFrameSize() const override { return encodedFrameBufferSize_; }
   virtual int getPcmFrameSize() const override { return pcmFrameSize_; };
   virtual int getPcmFrameBufferSize() const override { return pcmFrameBufferSize_; };
 
 private:
-  const int CfgComplexity = 0;
-  const int CfgEncodedFrameBufferSize = 1024;
+  const int CfgMinBitRate = 2400;
+  const int CfgBitRateReductionPercent = 25;
 
   OpusEncoder *opusEncoder_;
   OpusDecoder *opusDecoder_;
@@ -33,6 +42,9 @@ private:
   int pcmFrameSize_;
   int pcmFrameBufferSize_;
   int encodedFrameBufferSize_;
+
+  int bitRate_;
+  int currentBitRate_;
 };
 
 }
@@ -0,0 +1,125 @@
+#ifndef AUDIO_PIPELINE_H
+#define AUDIO_PIPELINE_H
+
+#include <memory>
+
+#include "settings/config.h"
+#include "audio/audio_codec.h"
+#include "audio/audio_codec_codec2.h"
+#include "audio/audio_codec_opus.h"
+#include "utils/dsp.h"
+#include "utils/memory_arena.h"
+
+namespace LoraDv {
+
+// Frame processing between i2s and codec, implementation is selected once at start
+// for the configured codec and resample ratio, so there is a single call per frame
+class AudioPipeline {
+
+public:
+  virtual ~AudioPipeline() = default;
+
+  static std::shared_ptr<AudioPipeline> create(std::shared_ptr<const Config> config, std::shared_ptr<Dsp> dsp,
+    std::shared_ptr<MemoryArena> arena);
+  static constexpr size_t getMaxSize();
+
+  virtual bool start(std::shared_ptr<const Config> config) = 0;
+  virtual void stop() = 0;
+
+  // codec control and parameters, not used per frame
+  virtual AudioCodec &getCodec() = 0;
+
+  // mic frame is captured into this buffer at mic sample rate, while the other one is encoded
+  virtual int16_t *getMicBuffer() = 0;
+  virtual void swapMicBuffers() = 0;
+
+  // filter, downsample and encode last captured mic frame, returns encoded size
+  virtual int encode(int micFrameSize, const uint8_t *&encodedFrame) = 0;
+
+  // decode, adjust gain and upsample, returns number of samples at speaker rate
+  virtual int decode(const uint8_t *encodedFrame, int frameSize, int16_t targetLevel, const int16_t *&pcmFrame) = 0;
+};
+
+template <class Codec, int ResampleCoeff,
+  int MaxPcmFrameSize = Codec::CfgMaxPcmFrameSize, int MaxFrameSize = Codec::CfgMaxFrameSize>
+class AudioPipelineImpl final : public AudioPipeline {
+
+  static_assert(ResampleCoeff == 1 || ResampleCoeff == 2, "Only 1x and 2x resampling is supported");
+
+public:
+  static constexpr int CfgMicBufferSize = MaxPcmFrameSize * ResampleCoeff;
+
+public:
+  explicit AudioPipelineImpl(std::shared_ptr<Dsp> dsp)
+    : dsp_(dsp)
+    , micBufferIndex_(0)
+  {
+  }
+
+  bool start(std::shared_ptr<const Config> config) override
+  {
+    if (!codec_.start(config)) return false;
+    // buffers are sized for the largest frame of the codec
+    if (codec_.getPcmFrameBufferSize() > MaxPcmFrameSize || codec_.getFrameSize() > MaxFrameSize) {
+      LOG_ERROR("Codec frame does not fit into pipeline buffers", codec_.getPcmFrameBufferSize(), codec_.getFrameSize());
+      codec_.stop();
+      return false;
+    }
+    LOG_INFO("Audio pipeline started, resample", ResampleCoeff, "buffers", MaxPcmFrameSize, MaxFrameSize);
+    return true;
+  }
+
+  void stop() override { codec_.stop(); }
+
+  AudioCodec &getCodec() override { return codec_; }
+
+  int16_t *getMicBuffer() override { return micBuffers_[micBufferIndex_]; }
+  void swapMicBuffers() override { micBufferIndex_ ^= 1; }
+
+  int encode(int micFrameSize, const uint8_t *&encodedFrame) override
+  {
+    int16_t *pcmBuffer = micBuffers_[micBufferIndex_ ^ 1];
+    dsp_->audioFilterHpf(pcmBuffer, micFrameSize);
+    if (ResampleCoeff == 2) {
+      dsp_->audioDownsample2x(pcmBuffer, pcmFrameBuffer_, micFrameSize);
+      pcmBuffer = pcmFrameBuffer_;
+    }
+    encodedFrame = encodedFrameBuffer_;
+    return codec_.encode(encodedFrameBuffer_, pcmBuffer);
+  }
+
+  int decode(const uint8_t *encodedFrame, int frameSize, int16_t targetLevel, const int16_t *&pcmFrame) override
+  {
+    int pcmFrameSize = codec_.decode(pcmFrameBuffer_, encodedFrame, frameSize);
+    if (pcmFrameSize <= 0) return pcmFrameSize;
+    dsp_->audioAdjustGainAgc(pcmFrameBuffer_, pcmFrameSize, targetLevel);
+    if (ResampleCoeff == 2) {
+      pcmFrame = pcmResampleBuffer_;
+      return dsp_->audioUpsample2x(pcmFrameBuffer_, pcmResampleBuffer_, pcmFrameSize);
+    }
+    pcmFrame = pcmFrameBuffer_;
+    return pcmFrameSize;
+  }
+
+private:
+  std::shared_ptr<Dsp> dsp_;
+  Codec codec_;
+
+  int16_t pcmFrameBuffer_[MaxPcmFrameSize];
+  int16_t pcmResampleBuffer_[CfgMicBufferSize];
+  int16_t micBuffers_[2][CfgMicBufferSize];
+  int micBufferIndex_;
+  uint8_t encodedFrameBuffer_[MaxFrameSize];
+};
+
+// arena room for the largest supported pipeline
+constexpr size_t AudioPipeline::getMaxSize()
+{
+  return MemoryArena::maxSize(
+    MemoryArena::maxSize(sizeof(AudioPipelineImpl<AudioCodecCodec2, 1>), sizeof(AudioPipelineImpl<AudioCodecCodec2, 2>)),
+    MemoryArena::maxSize(sizeof(AudioPipelineImpl<AudioCodecOpus, 1>), sizeof(AudioPipelineImpl<AudioCodecOpus, 2>)));
+}
+
+} // LoraDv
+
+#endif // AUDIO_PIPELINE_H
@@ -4,12 +4,18 @@
 #include <driver/i2s.h>
 #include <memory>
 #include <codec2.h>
+#include <arduino-timer.h>
 
 #include "hal/radio_task.h"
 #include "settings/config.h"
 #include "hal/pm_service.h"
-#include "audio/audio_codec.h"
+#include "audio/audio_pipeline.h"
+#include "audio/voice_recorder.h"
+#include "hal/serial_protocol.h"
 #include "utils/dsp.h"
+#include "utils/event_notifier.h"
+#include "utils/memory_arena.h"
+#include "utils/seq_lock.h"
 
 namespace LoraDv {
 
@@ -18,15 +24,37 @@ class RadioTask;
 class AudioTask {
 
 public:
-  explicit AudioTask(std::shared_ptr<const Config> config, std::shared_ptr<PmService> pmService);
+  struct Stats {
+    uint32_t txFrames;          // encoded audio frames
+    uint32_t txPackets;         // packets queued to the radio
+    uint32_t txDropped;         // packets or frames dropped because radio could not keep up
+    uint32_t txOverDropped;     // dropped during current or last transmission
+    uint32_t txBitRateReductions; // codec bit rate reductions
+    uint32_t rxFrames;          // decoded and played frames
+    uint32_t codecBitRate;      // current codec bit rate
+    uint32_t codecLoad;         // codec and dsp time in percent of frame duration at maximum cpu frequency
+    uint32_t wakeupLatencyMs;   // last wakeup by the radio to the first played sample
+    uint32_t micOverruns;       // mic dma buffers overwritten before they were read
+  };
 
-  void start(std::shared_ptr<RadioTask> radioTask);
+public:
+  explicit AudioTask(std::shared_ptr<const Config> config, std::shared_ptr<EventNotifier> eventNotifier,
+    std::shared_ptr<PmService> pmService, std::shared_ptr<VoiceRecorder> voiceRecorder, 
+    std::shared_ptr<SerialProtocol> serialProtocol, std::shared_ptr<MemoryArena> arena);
+
+  void start(std::shared_ptr<RadioTask> rxRadioTask, std::shared_ptr<RadioTask> txRadioTask);
   inline void stop() { isRunning_ = false; }
+  inline TaskHandle_t getTaskHandle() const { return audioTaskHandle_; }
+  inline uint32_t getTaskStackSize() const { return CfgAudioTaskStack; }
   bool loop();
+  uint32_t getLoopTimeoutMs() const;
 
-  void play() const; 
+  bool play() const; 
+  void wakeup();
   bool isPlaying() const { return isPlaying_; }
+  bool isFullDuplex() const { return rxRadioTask_ != txRadioTask_; }
   void record() const;
+  void replay() const;
 
   void setPtt(bool isPttOn);
 
@@ -38,6 +66,8 @@ public:
   void changeVolume(int deltaVolume);
   inline int getVolume() const { return volume_; }
 
+  inline Stats getStats() const { return statsLock_.read(); }
+
 private:
   static constexpr int CfgCoreId = 0;                        // core id where task will run
   static constexpr int CfgTaskPriority = 2;                  // task priority
@@ -47,48 +77,105 @@ private:
 
   static constexpr uint32_t CfgAudioPlayBit = 0x01;          // task bit for playback
   static constexpr uint32_t CfgAudioRecBit = 0x02;           // task bit for recording
+  static constexpr uint32_t CfgAudioReplayBit = 0x04;        // task bit for recorded over playback
+  static constexpr uint32_t CfgAudioParrotBit = 0x08;        // task bit for recorded over transmission
+  static constexpr uint32_t CfgAudioWakeupBit = 0x10;        // task bit for wakeup by the radio
+  static constexpr uint32_t CfgAudioIdleBit = 0x20;          // task bit for playback completed
 
   static constexpr int CfgStartupDelayMs = 3000;             // startup delay
-  static constexpr int CfgAudioTaskStack = 32768;            // audio stack size
+  static constexpr int CfgCodecLoadDecay = 16;               // codec load falls slowly, rises immediately
+  static constexpr uint32_t CfgWakeupLatencyMaxMs = 1000;    // longer gaps mean wakeup was not caused by voice
+  static constexpr int CfgAudioTaskStack = CFG_AUDIO_TASK_STACK; // audio stack size
   static constexpr int CfgPlayCompletedDelayMs = 500;        // playback stopped status after ms
   static constexpr int CfgAudioMaxVolumePcmMultiplier = 10;  // multipier to get max pcm volume from max control volume
+  static constexpr int CfgTxQueueHighLoad = 75;              // radio tx queue load in percents to start reducing bit rate
+  static constexpr int CfgBitRateReduceIntervalMs = 1000;    // minimum interval between bit rate reductions
+  static constexpr int CfgRecorderFrameSize = 256;           // recorded frame buffer size
+  static constexpr uint32_t CfgRecorderFlushTimeoutMs = 1000; // wait for recorder to store last frames
+  static constexpr int CfgParrotQueueWaitMs = 10;            // wait for radio when tx queue is full in parrot mode
+  static constexpr int CfgMicDmaFrames = 3;                  // mic frames in dma, captured, encoded and one for encoding spikes
+  static constexpr int CfgMaxDmaBufLen = 1024;               // i2s driver limit for dma buffer length in samples
+  static constexpr uint32_t CfgMicEventTimeoutMs = 500;      // longer than the longest frame, mic is not clocked
+  static constexpr int CfgMaxPacketSize = 256;               // packet buffer is never larger than radio packet
+
+public:
+  // static memory needed by the task, buffers are taken from the arena when started
+  static constexpr size_t CfgArenaSize = MemoryArena::reserve(AudioPipeline::getMaxSize()) +
+    MemoryArena::reserve(CfgMaxPacketSize) + MemoryArena::reserve(CfgRecorderFrameSize);
 
 private:
-  void installAudio(int bytesPerSample) const;
+  void installAudio(int pcmFrameSize);
   void uninstallAudio() const;
+  void setI2sActive(bool isSpkActive, bool isMicActive);
+  void flushMicDma();
+  inline i2s_port_t getMicI2sId() const { return isI2sFullDuplex_ ? CfgAudioI2sSpkId : CfgAudioI2sMicId; }
 
   static void task(void *param);
 
   void audioTask();
   void audioTaskPlay();
   void audioTaskRecord();
+  void audioTaskReplay();
+  void audioTaskParrot();
+  void audioTaskWakeup();
 
-  void decodeAndPlay(int frameSize, int16_t targetLevel);
-  int encodeAndQueue(int pcmFrameSize);
+  bool playNextFrame(int16_t targetLevel);
+  void decodeAndPlay(const uint8_t *encodedFrame, int frameSize, int16_t targetLevel);
+  bool captureMicFrame();
+  int encodeAndQueue(int pcmFrameSize, int packetSize);
+  bool transmitPacket(int packetSize);
 
   void playTimerReset();
   static bool playTimerEnter(void *param);
   void playTimer();
+  void notifyStateChanged();
+  void publishStats();
+  void updateCodecLoad(uint32_t codecTimeUs);
 
 private:
   std::shared_ptr<const Config> config_;
   TaskHandle_t audioTaskHandle_;
 
-  std::shared_ptr<RadioTask> radioTask_;
+  std::shared_ptr<RadioTask> rxRadioTask_;
+  std::shared_ptr<RadioTask> txRadioTask_;
+  std::shared_ptr<EventNotifier> eventNotifier_;
   std::shared_ptr<PmService> pmService_;
+  std::shared_ptr<VoiceRecorder> voiceRecorder_;
+  std::shared_ptr<SerialProtocol> serialProtocol_;
+  std::shared_ptr<MemoryArena> arena_;
 
   Timer<1> playTimer_;
   Timer<1>::Task playTimerTask_;
 
   std::shared_ptr<Dsp> dsp_;
-  std::shared_ptr<AudioCodec> audioCodec_;
+  std::shared_ptr<AudioPipeline> audioPipeline_;
+  AudioCodec *audioCodec_;
 
-  int16_t *pcmFrameBuffer_;
-  int16_t *pcmResampleBuffer_;
-  uint8_t *encodedFrameBuffer_;
+  uint8_t *packetBuffer_;
+  uint8_t *recorderBuffer_;
+
+  int packetBufferSize_;
+
+  // mic frame is an exact number of dma buffers, rx events tell when each of them is filled
+  QueueHandle_t micEventQueue_;
+  int micFrameSize_;
+  int micFrameOffset_;
+  int micDmaBufLen_;
+  int micDmaBufCount_;
+
+  // mic and speaker could share one port, unused direction is stopped
+  bool isI2sFullDuplex_;
+  bool isSpkActive_;
+  bool isMicActive_;
 
   int codecSamplesPerFrame_;
   int codecBytesPerFrame_;
+  bool isFixedFrameSize_;
+  int playOffset_;
+
+  Stats stats_;
+  SeqLock<Stats> statsLock_;
+  uint32_t lastBitRateReduceMs_;
 
   long volume_;
   long maxVolume_;
@@ -97,6 +184,8 @@ private:
   volatile bool isRunning_;
   volatile bool shouldUpdateScreen_;
   volatile bool isPlaying_;
+  volatile bool isDraining_;
+  volatile uint32_t wakeupMs_;
 };
 
 }
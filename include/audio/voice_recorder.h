@@ -0,0 +1,113 @@
+#ifndef VOICE_RECORDER_H
+#define VOICE_RECORDER_H
+
+#include <Arduino.h>
+#include <memory>
+#include <LittleFS.h>
+
+#define DEBUGLOG_DEFAULT_LOG_LEVEL_INFO
+#include <DebugLog.h>
+
+#include "settings/config.h"
+#include "hal/radio_queue.h"
+
+namespace LoraDv {
+
+// Records encoded audio packets with timestamps into a log structured ring of
+// segment files on the flash file system. Audio task only stages packets in RAM,
+// recorder task batches them and writes to flash, so flash latency does not affect
+// audio and number of flash writes is reduced. Oldest segment is overwritten when
+// the ring is full.
+class VoiceRecorder {
+
+public:
+  struct Frame {
+    uint32_t timestampMs;   // time when frame was recorded
+    uint8_t flags;          // frame flags
+    uint8_t size;           // encoded frame size
+  };
+
+  static constexpr uint8_t CfgFlagTx = 0x01;          // frame was transmitted, otherwise received
+  static constexpr uint8_t CfgFlagOverStart = 0x02;   // first frame of the over
+
+public:
+  explicit VoiceRecorder(std::shared_ptr<const Config> config);
+
+  void start();
+  inline void stop() { isRunning_ = false; }
+  inline TaskHandle_t getTaskHandle() const { return recorderTaskHandle_; }
+  inline uint32_t getTaskStackSize() const { return CfgTaskStack; }
+
+  bool write(const byte *frameBuf, int frameSize, bool isTx);
+  bool flush(uint32_t timeoutMs);
+
+  bool openLastOver();
+  bool openHistory();
+  int readNext(byte *frameBuf, int maxFrameSize, Frame &frame);
+  void close();
+
+private:
+  static constexpr int CfgCoreId = 1;                   // core id where task will run
+  static constexpr int CfgTaskPriority = 1;             // task priority, lower than radio and audio
+  static constexpr int CfgTaskStack = 4096;             // task stack size
+
+  static constexpr uint32_t CfgStoreBit = 0x01;         // task bit for new staged frames
+  static constexpr uint32_t CfgFlushBit = 0x02;         // task bit for flush request
+
+  static constexpr int CfgSegmentsCount = CFG_RECORDER_SEGMENTS;      // number of segment files in the ring
+  static constexpr int CfgSegmentSize = CFG_RECORDER_SEGMENT_SIZE;    // segment file size
+  static constexpr int CfgBatchSize = 512;              // flash write batch size
+  static constexpr uint32_t CfgBatchTimeoutMs = 2000;   // write incomplete batch after ms
+  static constexpr uint32_t CfgOverGapMs = 1000;        // gap between frames which starts new over
+
+  static constexpr uint32_t CfgSegmentMagic = 0x3152444c; // segment header magic, "LDR1"
+  static constexpr int CfgSegmentHeaderSize = 8;        // magic and segment sequence number
+  static constexpr int CfgFrameHeaderSize = 6;          // timestamp, flags and size
+  static constexpr int CfgStagedHeaderSize = 5;         // timestamp and flags
+
+private:
+  static void task(void *param);
+  void recorderTask();
+
+  void storeStagedFrames();
+  void appendFrame(const byte *frameBuf, int frameSize, uint32_t timestampMs, uint8_t flags);
+  void writeBatch();
+  bool openSegment(int segmentId, uint32_t segmentSeq);
+  bool loadSegments();
+  bool openReadSegment();
+
+  static void segmentPath(char *path, int pathLen, int segmentId);
+
+private:
+  std::shared_ptr<const Config> config_;
+  TaskHandle_t recorderTaskHandle_;
+
+  RadioQueue stagingQueue_;
+  byte batch_[CfgBatchSize];
+  int batchSize_;
+  uint32_t batchStartMs_;
+
+  File segmentFile_;
+  int segmentId_;
+  uint32_t segmentSeq_;
+  int segmentOffset_;
+
+  uint32_t lastRxFrameMs_;
+  uint32_t lastTxFrameMs_;
+  int lastOverSegmentId_;
+  int lastOverOffset_;
+
+  File readFile_;
+  int readSegmentId_;
+  int readSegmentsLeft_;
+  bool isReadingOver_;
+  bool isReadStarted_;
+
+  bool isMounted_;
+  volatile bool isFlushRequested_;
+  volatile bool isRunning_;
+};
+
+} // LoraDv
+
+#endif // VOICE_RECORDER_H
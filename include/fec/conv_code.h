@@ -0,0 +1,48 @@
+#ifndef CONV_CODE_H
+#define CONV_CODE_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Rate 1/2 convolutional code with constraint length 5, generator polynomials
+// G1 = 1 + D^3 + D^4 and G2 = 1 + D + D^2 + D^4 as used by M17. Encoder appends
+// flush bits, so the decoder always ends in zero state. Puncturing pattern removes
+// encoded bits where pattern is 0, decoder treats them as erasures. Decoder is
+// Viterbi with soft input (0 - strong zero, 255 - strong one, 128 - erasure),
+// branch outputs are precomputed, so each step is table lookups and compares.
+class ConvCode {
+
+public:
+  static constexpr int CfgConstraintLen = 5;            // constraint length
+  static constexpr int CfgFlushBits = CfgConstraintLen - 1; // zero bits appended by encoder
+  static constexpr int CfgStates = 1 << CfgFlushBits;   // trellis states
+  static constexpr uint8_t CfgSoftZero = 0;             // soft value of received zero
+  static constexpr uint8_t CfgSoftOne = 255;            // soft value of received one
+  static constexpr uint8_t CfgSoftErasure = 128;        // punctured or unknown bit
+
+public:
+  explicit ConvCode(int maxDataBits);
+  ~ConvCode();
+
+  // packed data bits, msb first, to unpacked encoded bits, returns encoded bits count
+  int encode(const byte *data, int dataBits, const uint8_t *puncture, int punctureLen, uint8_t *encodedBits) const;
+  // unpacked soft encoded bits to packed data bits, returns path metric, lower is better
+  int decode(const uint8_t *softBits, int softBitsCount, const uint8_t *puncture, int punctureLen, 
+    byte *data, int dataBits);
+
+  static int getEncodedBits(int dataBits, const uint8_t *puncture, int punctureLen);
+
+private:
+  static constexpr uint8_t CfgPolyG1 = 0x13;            // register taps for G1, bit 4 is the input bit
+  static constexpr uint8_t CfgPolyG2 = 0x1d;            // register taps for G2
+
+private:
+  int maxDataBits_;
+  uint8_t outputs_[2 * CfgStates];                      // encoder output pair by register value
+  uint16_t *decisions_;                                 // survivor bits per step, bit per state
+};
+
+} // LoraDv
+
+#endif // CONV_CODE_H
@@ -0,0 +1,37 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Forward error correction stage for raw FSK packets, which are otherwise only
+// protected by radio CRC, so a single bit error drops the whole packet. Encoded bits
+// are block interleaved, so a burst of errors is spread over several codewords.
+// Radio CRC is disabled when FEC is used, decoder drops packets it could not correct.
+class Fec {
+
+public:
+  virtual ~Fec() = default;
+
+  // returns encoded size
+  virtual int encode(const byte *data, int dataSize, byte *encoded) = 0;
+  // returns data size or -1 if packet could not be corrected, counts corrected bits
+  virtual int decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits = nullptr) = 0;
+
+  virtual int getEncodedSize(int dataSize) const = 0;
+  // largest data size which always fits into encoded size, some packets could decode into more
+  virtual int getMaxDataSize(int encodedSize) const = 0;
+  virtual const char *getName() const = 0;
+
+protected:
+  static void unpackBits(const byte *data, int bitsCount, uint8_t *bits);
+  static void packBits(const uint8_t *bits, int bitsCount, byte *data);
+  // bits are written by rows and read by columns, last row could be partial
+  static void interleave(const uint8_t *bits, int bitsCount, int rowBits, uint8_t *out);
+  static void deinterleave(const uint8_t *bits, int bitsCount, int rowBits, uint8_t *out);
+};
+
+} // LoraDv
+
+#endif // FEC_H
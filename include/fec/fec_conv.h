@@ -0,0 +1,39 @@
+#ifndef FEC_CONV_H
+#define FEC_CONV_H
+
+#include "fec/fec.h"
+#include "fec/conv_code.h"
+
+namespace LoraDv {
+
+// Rate 1/2 K=5 convolutional packet coding with Viterbi decoding, n data bytes are
+// sent as 2n + 1 bytes, so data size is known from the packet size. Corrects more
+// scattered errors than Golay at the same rate, but has no error detection, so packets
+// are dropped when re-encoded data differs from the received bits too much.
+class FecConv : public Fec {
+
+public:
+  FecConv();
+
+  virtual int encode(const byte *data, int dataSize, byte *encoded) override;
+  virtual int decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits = nullptr) override;
+
+  virtual int getEncodedSize(int dataSize) const override;
+  virtual int getMaxDataSize(int encodedSize) const override;
+  virtual const char *getName() const override { return "Conv"; }
+
+private:
+  static constexpr int CfgMaxDataSize = 127;            // largest data size fitting into the radio packet
+  static constexpr int CfgMaxEncodedBits = 2 * (8 * CfgMaxDataSize + ConvCode::CfgFlushBits);
+  static constexpr int CfgRowBits = 16;                 // interleaver row, adjacent bits are spread by rows
+  static constexpr int CfgMaxErrorRatio = 10;           // packet is dropped if more than 1/n bits were corrected
+
+private:
+  ConvCode convCode_;
+  uint8_t bits_[CfgMaxEncodedBits];
+  uint8_t interleavedBits_[CfgMaxEncodedBits];
+};
+
+} // LoraDv
+
+#endif // FEC_CONV_H
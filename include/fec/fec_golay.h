@@ -0,0 +1,39 @@
+#ifndef FEC_GOLAY_H
+#define FEC_GOLAY_H
+
+#include "fec/fec.h"
+#include "fec/golay24.h"
+
+namespace LoraDv {
+
+// Rate 1/2 Golay(24,12) packet coding, every 3 data bytes are sent as two codewords.
+// First codeword carries data size and format id, so padding of the last codeword is
+// not delivered as data. Interleaving depth is the number of codewords, so a burst up
+// to 3 bits per codeword is corrected. Any uncorrectable codeword drops the packet.
+class FecGolay : public Fec {
+
+public:
+  FecGolay();
+
+  virtual int encode(const byte *data, int dataSize, byte *encoded) override;
+  virtual int decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits = nullptr) override;
+
+  virtual int getEncodedSize(int dataSize) const override;
+  virtual int getMaxDataSize(int encodedSize) const override;
+  virtual const char *getName() const override { return "Golay"; }
+
+private:
+  static constexpr int CfgCodewordBits = 24;            // encoded bits per codeword
+  static constexpr int CfgMaxCodewords = 85;            // codewords in the largest radio packet
+  static constexpr uint16_t CfgFormatId = 0x100;        // header codeword format id, bits 8-11
+
+private:
+  Golay24 golay_;
+  uint16_t words_[CfgMaxCodewords];
+  uint8_t bits_[CfgMaxCodewords * CfgCodewordBits];
+  uint8_t interleavedBits_[CfgMaxCodewords * CfgCodewordBits];
+};
+
+} // LoraDv
+
+#endif // FEC_GOLAY_H
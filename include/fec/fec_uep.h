@@ -0,0 +1,70 @@
+#ifndef FEC_UEP_H
+#define FEC_UEP_H
+
+#include <functional>
+
+#include "fec/fec.h"
+#include "fec/golay24.h"
+#include "fec/conv_code.h"
+
+namespace LoraDv {
+
+// Unequal error protection for packets of fixed size codec frames. Packet header and the
+// sensitive bits of every frame (voicing, pitch, energy) are protected with rate 1/2
+// convolutional code and CRC, remaining frame bits use the same code punctured to rate 3/4.
+// Packet is delivered when the protected part passes CRC, damaged spectral bits only
+// degrade the audio, so it is used with radio CRC disabled. Layout is Golay coded descriptor
+// with protected bytes and frames count, then protected and lightly coded sections.
+class FecUep : public Fec {
+
+public:
+  // returns how many leading packet bytes are fully protected, rest are codec frames
+  typedef std::function<int(const byte *packet, int packetSize)> HeaderSizeFn;
+
+public:
+  FecUep(int frameSize, int sensitiveOffset, int sensitiveBits, HeaderSizeFn getHeaderSize);
+
+  virtual int encode(const byte *data, int dataSize, byte *encoded) override;
+  virtual int decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits = nullptr) override;
+
+  virtual int getEncodedSize(int dataSize) const override;
+  virtual int getMaxDataSize(int encodedSize) const override;
+  virtual const char *getName() const override { return "UEP"; }
+
+private:
+  static constexpr int CfgDescriptorBits = 24;          // golay codeword with protected size and frames
+  static constexpr int CfgCrcBits = 16;                 // protected section crc
+  static constexpr int CfgMaxProtected = 127;           // protected bytes, 7 bits in descriptor
+  static constexpr int CfgMaxFrames = 31;               // frames, 5 bits in descriptor
+  static constexpr int CfgMaxBits = 8 * 256;            // bits of the largest packet
+  static constexpr int CfgRowBits = 16;                 // interleaver row
+  static constexpr int CfgMaxErrorRatio = 10;           // protected part is dropped if more than 1/n bits corrected
+  static constexpr int CfgPunctureLen = 6;              // rate 3/4 for unprotected bits
+  static const uint8_t Puncture[CfgPunctureLen];
+
+private:
+  int getProtectedBits(int protectedSize, int frames) const;
+  int getUnprotectedBits(int frames) const;
+  int getCodedBits(int protectedSize, int frames) const;
+  inline bool isSensitive(int bit) const { return bit >= sensitiveOffset_ && bit < sensitiveOffset_ + sensitiveBits_; }
+  static uint16_t crc16(const uint8_t *bits, int bitsCount);
+
+private:
+  int frameSize_;
+  int maxDataSize_;
+  int sensitiveOffset_;
+  int sensitiveBits_;
+  HeaderSizeFn getHeaderSize_;
+
+  Golay24 golay_;
+  ConvCode convCode_;
+  uint8_t protectedBits_[CfgMaxBits];
+  uint8_t unprotectedBits_[CfgMaxBits];
+  uint8_t bits_[CfgMaxBits];
+  uint8_t interleavedBits_[CfgMaxBits];
+  byte packed_[CfgMaxBits / 8];
+};
+
+} // LoraDv
+
+#endif // FEC_UEP_H
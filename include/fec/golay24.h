@@ -0,0 +1,38 @@
+#ifndef GOLAY24_H
+#define GOLAY24_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Extended Golay(24,12) code, 12 data bits are followed by 12 parity bits, corrects
+// up to 3 bit errors and detects 4. Both encoding and decoding are table driven,
+// parity is looked up by data nibbles and error pattern by syndrome, so the decoder
+// does not search, syndrome table takes 16KB, it is shared by all instances and is
+// built once on first construction.
+class Golay24 {
+
+public:
+  Golay24();
+
+  uint32_t encode(uint16_t data) const;
+  bool decode(uint32_t codeword, uint16_t &data) const;
+
+private:
+  static constexpr int CfgSyndromes = 4096;             // 12 bit syndrome
+  static constexpr uint32_t CfgNoPattern = 0xffffffff;  // more than 3 errors
+  static const uint16_t EncodeMatrix[12];
+
+private:
+  static const uint32_t *getSyndromeTable();
+  static uint32_t *buildSyndromeTable();
+  uint16_t getParity(uint16_t data) const;
+
+private:
+  uint16_t parityTable_[3][16];
+  const uint32_t *syndromeTable_;
+};
+
+} // LoraDv
+
+#endif // GOLAY24_H
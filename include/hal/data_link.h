@@ -0,0 +1,63 @@
+#ifndef DATA_LINK_H
+#define DATA_LINK_H
+
+#include <Arduino.h>
+#include <functional>
+
+#define DEBUGLOG_DEFAULT_LOG_LEVEL_INFO
+#include <DebugLog.h>
+
+#include "hal/radio_queue.h"
+
+namespace LoraDv {
+
+// Arbitrary data messages (text, position, telemetry) sent over the same link as voice.
+// Messages larger than the radio packet are split into fragments, each fragment carries
+// message id, fragment index and fragments count, receiver reassembles fragments in order
+// and drops the whole message if any fragment is missing. Radio task pulls fragments
+// only when there is no voice to send, so data never delays voice packets.
+class DataLink {
+
+public:
+  static constexpr int CfgMaxMessageSize = 512;         // maximum data message size
+  static constexpr int CfgFragmentHeaderSize = 3;       // message id, fragment index, fragments count
+
+public:
+  DataLink();
+
+  // application side, could be called from any task
+  bool send(const byte *dataBuf, int dataSize);
+  int receive(byte *dataBuf, int maxDataSize, float *rssi = nullptr, float *snr = nullptr);
+  inline bool hasData() const { return rxQueue_.hasData(); }
+  inline void onReceive(std::function<void()> handler) { onReceive_ = handler; }
+
+  // radio side, tx fragments are only pulled by the transmitting radio task
+  bool hasFragments() const;
+  int peekFragment(byte *fragmentBuf, int maxFragmentSize);
+  void releaseFragment();
+  bool onFragment(const byte *fragmentBuf, int fragmentSize, float rssi, float snr);
+
+private:
+  RadioQueue txQueue_;
+  RadioQueue rxQueue_;
+  std::function<void()> onReceive_;
+
+  // message being sent
+  byte txMessage_[CfgMaxMessageSize];
+  int txMessageSize_;
+  int txOffset_;
+  int txFragmentSize_;
+  uint8_t txMessageId_;
+  uint8_t txFragmentIndex_;
+  uint8_t txFragmentsCount_;
+
+  // message being reassembled
+  byte rxMessage_[CfgMaxMessageSize];
+  int rxMessageSize_;
+  int rxNextIndex_;
+  uint8_t rxMessageId_;
+};
+
+} // LoraDv
+
+#endif // DATA_LINK_H
@@ -3,22 +3,67 @@
 
 #include <Arduino.h>
 #include <memory>
+#include <esp_adc_cal.h>
 #include "settings/config.h"
 
 namespace LoraDv {
 
+class RadioTask;
+
+// Samples battery voltage in background, readers get cached filtered values,
+// voltage sag while transmitting is tracked separately from resting voltage
 class HwMonitor {
 
 public:
   HwMonitor(std::shared_ptr<const Config> config);
-  
+
+  void start(std::shared_ptr<RadioTask> txRadioTask);
+  inline void stop() { isRunning_ = false; }
+  inline TaskHandle_t getTaskHandle() const { return hwMonitorTaskHandle_; }
+  inline uint32_t getTaskStackSize() const { return CfgTaskStack; }
+
   float getBatteryVoltage() const;
+  float getLoadVoltage() const;
+  float getSagVoltage() const;
+  float getBatteryPercent() const;
+
+  static float getVoltagePercent(float voltage);
+
+private:
+  static constexpr int CfgCoreId = 0;                       // core id where task will run
+  static constexpr int CfgTaskPriority = 1;                 // task priority
+  static constexpr int CfgTaskStack = 2048;                 // task stack size
+
+  static constexpr uint32_t CfgSampleIntervalMs = 1000;     // resting voltage sample interval
+  static constexpr uint32_t CfgTxSampleIntervalMs = 200;    // sample interval while transmitting
+  static constexpr uint32_t CfgTxRecoveryMs = 2000;         // battery recovers after transmission
+  static constexpr int CfgOversampleCount = 16;             // adc readings averaged per group
+  static constexpr int CfgMedianGroups = 5;                 // median of group averages rejects spikes
+  static constexpr float CfgFilterAlpha = 0.2f;             // low pass filter coefficient
+  static constexpr float CfgDividerRatio = 2.0f;            // battery voltage divider
+  static constexpr uint32_t CfgDefaultVrefMv = 1100;        // adc reference if efuse is not burned
+
+private:
+  static void task(void *param);
+  void hwMonitorTask();
+  void setupAdc();
+  float sampleVoltage() const;
+  bool isTransmitting() const;
 
 private:
   std::shared_ptr<const Config> config_;
+  std::shared_ptr<RadioTask> txRadioTask_;
+
+  TaskHandle_t hwMonitorTaskHandle_;
+  esp_adc_cal_characteristics_t adcChars_;
+
+  volatile float restingVoltage_;
+  volatile float loadVoltage_;
+  uint32_t lastTxMs_;
 
+  volatile bool isRunning_;
 };
 
 } // LoraDv
 
-#endif // HW_MONITOR_H
\ No newline at end of file
+#endif // HW_MONITOR_H
@@ -3,41 +3,99 @@
 
 #include <Arduino.h>
 #include <memory>
-#include <arduino-timer.h>
+#include <driver/rtc_io.h>
 #include <Adafruit_SSD1306.h>
 
 #include "settings/config.h"
+#include "utils/event_notifier.h"
 
 namespace LoraDv {
 
+class AudioTask;
+class RadioTask;
+class HwMonitor;
+
+// Steps down from active to idle (dimmed display, lower cpu frequency), then to light sleep
+// polling with radio rx duty cycle and optionally to deep sleep, any activity brings it back.
 class PmService {
 
+public:
+  enum class State {
+    Active = 0,
+    Idle,
+    Sleep,
+    DeepSleep
+  };
+
+  struct BatteryEstimate {
+    float voltage;          // last measured voltage
+    float percent;          // state of charge
+    float usedMah;          // charge used since boot
+    float averageMa;        // average current since boot
+    float remainingHours;   // runtime left at average current
+    float standbyHours;     // runtime left if staying in sleep
+  };
+
+public:
+  static constexpr uint32_t CfgMaxCpuFrequencyMhz = 240;
+
 public:
   PmService(std::shared_ptr<const Config> config, std::shared_ptr<Adafruit_SSD1306> display);
 
-  void setup();
+  void start(std::shared_ptr<AudioTask> audioTask, std::shared_ptr<RadioTask> rxRadioTask,
+    std::shared_ptr<HwMonitor> hwMonitor);
   bool loop();
+  uint32_t getLoopTimeoutMs() const;
 
   void lightSleepReset();
 
+  inline State getState() const { return state_; }
+  inline BatteryEstimate getBatteryEstimate() const { return estimate_; }
+
 private:
   static constexpr uint32_t CfgMinCpuFrequencyMhz = 80;
+  static constexpr uint32_t CfgMidCpuFrequencyMhz = 160;
+  static constexpr uint32_t CfgMaxCodecLoad = 50;         // codec load headroom, dsp, i2s and radio need the rest
+  static constexpr int CfgStatesCount = 4;
+
+  static constexpr uint32_t CfgEstimateIntervalMs = 60000; // battery estimate update and log interval
+  static constexpr float CfgMinBatteryVoltage = 2.5f;      // lower readings mean battery monitor is not connected
+  static constexpr float CfgVoltageWeight = 0.1f;          // how fast voltage corrects the coulomb count
 
 private:
-  static bool lightSleepEnterTimer(void *param);
+  void setState(State state);
   void lightSleepEnter();
+  void deepSleepEnter();
+  void setupWakeup() const;
+  void restoreWakeupPins() const;
   esp_sleep_wakeup_cause_t lightSleepWait(uint64_t sleepTimeUs) const;
 
+  void updateCpuFrequency();
+  uint32_t getTargetCpuFrequencyMhz() const;
+  bool isRxDutyCycleSupported() const;
+
+  int getStateCurrentMa(State state) const;
+  void accountResidency(uint32_t nowMs);
+  void updateEstimate(uint32_t nowMs);
+
 private:
   std::shared_ptr<const Config> config_;
   std::shared_ptr<Adafruit_SSD1306> display_;
+  std::shared_ptr<AudioTask> audioTask_;
+  std::shared_ptr<RadioTask> rxRadioTask_;
+  std::shared_ptr<HwMonitor> hwMonitor_;
 
-  Timer<1> lightSleepTimer_;
-  Timer<1>::Task lightSleepTimerTask_;
+  State state_;
+  uint32_t stateSinceMs_;
+  volatile uint32_t lastActivityMs_;
 
-  bool isExitFromSleep_;
+  // state residency and coulomb count for runtime prediction
+  uint32_t startMs_;
+  uint32_t nextEstimateMs_;
+  uint32_t residencyMs_[CfgStatesCount];
+  BatteryEstimate estimate_;
 };
 
 } // LoraDv
 
-#endif // PM_SERVICE_H
\ No newline at end of file
+#endif // PM_SERVICE_H
@@ -0,0 +1,74 @@
+#ifndef RADIO_QUEUE_H
+#define RADIO_QUEUE_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Packet queue between radio and audio tasks. Packets are stored contiguously in the
+// data buffer, so the producer could read radio FIFO directly into the queue memory using
+// reserve/commit and the consumer could decode directly from it using peek/release.
+// All operations are guarded by a spinlock, queue is shared between tasks on different cores.
+// push is safe for any number of producers, reserve/commit keep the reserved space outside
+// of the lock and must only be used when the queue has a single producer.
+class RadioQueue {
+
+public:
+  struct Packet {
+    uint16_t offset;    // packet start in the data buffer
+    uint16_t size;      // packet size
+    float rssi;         // packet rssi
+    float snr;          // packet snr
+    uint8_t flags;      // user defined packet flags
+  };
+
+public:
+  RadioQueue();
+
+  bool push(const byte *packetBuf, int packetSize, float rssi = 0, float snr = 0, uint8_t flags = 0);
+  int pop(byte *packetBuf, int maxPacketSize, Packet *packet = nullptr);
+
+  // only for single producer, no push is allowed between reserve and commit
+  byte *reserve(int packetSize);
+  bool commit(int packetSize, float rssi = 0, float snr = 0, uint8_t flags = 0);
+
+  // only for single consumer, which is also the only one removing packets
+  const byte *peek(Packet &packet);
+  void release();
+
+  // drops are counted by the queue, so producers in any task could report them
+  bool dropOldest();
+  void countDropped();
+  void clear();
+
+  bool hasData() const;
+  int size() const;
+  int load() const;
+  uint32_t getDroppedCount() const;
+
+private:
+  static constexpr int CfgDataLen = 1024;       // packet data buffer length
+  static constexpr int CfgSlotsLen = 32;        // maximum number of packets
+
+private:
+  int findSpace(int packetSize) const;
+
+private:
+  byte data_[CfgDataLen];
+  Packet slots_[CfgSlotsLen];
+
+  int head_;            // next slot to write
+  int tail_;            // oldest slot
+  int count_;           // number of packets
+  int writeOffset_;     // end of the newest packet in data buffer
+  int usedBytes_;       // bytes occupied by packets
+  int reservedOffset_;  // offset of reserved, but not yet committed packet
+  int reservedSize_;    // size of reserved packet, committed packet could be smaller
+  uint32_t dropped_;    // packets dropped to make room or not fitting into the queue
+
+  mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+} // LoraDv
+
+#endif // RADIO_QUEUE_H
@@ -3,17 +3,29 @@
 #include <Arduino.h>
 #include <memory>
 #include <RadioLib.h>
-#include <CircularBuffer.hpp>
 #include <ChaChaPoly.h>
-#include <esp_random.h>
 
 #define DEBUGLOG_DEFAULT_LOG_LEVEL_INFO
 #include <DebugLog.h>
 
 #include "settings/config.h"
+#include "hal/radio_queue.h"
+#include "hal/data_link.h"
+#include "protocol/m17_framer.h"
+#include "fec/fec_golay.h"
+#include "fec/fec_conv.h"
+#include "fec/fec_uep.h"
+#include "audio/audio_codec_codec2.h"
 #include "audio/audio_task.h"
 #include "utils/utils.h"
+#include "utils/ax25.h"
+#include "utils/replay_filter.h"
+#include "utils/repeater_filter.h"
+#include "utils/event_notifier.h"
+#include "utils/seq_lock.h"
+#include "utils/memory_arena.h"
 #include "settings/settings_menu.h"
+#include "settings/privacy_store.h"
 
 namespace LoraDv {
 
@@ -22,83 +34,302 @@ class AudioTask;
 class RadioTask {
 
 public:
-  explicit RadioTask(std::shared_ptr<const Config> config);
+  struct Stats {
+    uint32_t rxPackets;     // received and queued packets
+    uint32_t rxBytes;       // received and queued payload bytes
+    uint32_t rxErrors;      // read errors, wrong sizes and failed authentication
+    uint32_t rxDropped;     // packets dropped because rx queue is full
+    uint32_t txPackets;     // transmitted packets
+    uint32_t txBytes;       // transmitted payload bytes
+    uint32_t txErrors;      // transmit errors and wrong packet sizes
+    uint32_t txDropped;     // packets dropped from tx queue to make room for newer ones
+    uint32_t rxNotifies;    // audio task wakeups for playback
+    uint32_t rptPackets;    // packets queued for repeating
+    uint32_t rptDuplicates; // packets not repeated as already seen
+    uint32_t rptBusy;       // packets not repeated as another stream is being repeated
+    uint32_t scanChannels;  // channels checked for activity while scanning
+    uint32_t scanDetects;   // channels where activity was detected
+    uint32_t rxLost;        // packets missing in sender sequence, only known with privacy enabled
+    uint32_t airtimeMs;     // total time on air of received and transmitted packets
+    uint32_t rxDataPackets; // received data fragments
+    uint32_t txDataPackets; // transmitted data fragments
+    uint32_t rxFecBits;     // bits corrected by fsk fec
+    uint32_t rxWakeups;     // board wakeups from sleep by the radio
+    uint16_t rxQueueDepth;  // packets waiting for decoding
+    float rssi;             // last packet rssi
+    float snr;              // last packet snr
+  };
+
+  // last callsign heard in received AX.25 headers or M17 link setup
+  struct HeardCallsign {
+    char callsign[CFG_CALLSIGN_SIZE];
+    uint32_t heardMs;       // time when it was last received, 0 if none
+  };
+
+  // module could be used for both rx and tx or dedicated to one direction when
+  // two modules are installed, so rx and tx could run concurrently on different bands
+  enum class Role {
+    RxTx = 0,
+    RxOnly,
+    TxOnly
+  };
 
-  void start(std::shared_ptr<AudioTask> audioTask);
+public:
+  static constexpr int CfgMaxModules = 2;               // maximum number of radio modules
+  static constexpr int CfgKeySlots = CFG_AUDIO_PRIVACY_KEY_SLOTS; // number of privacy key slots
+  static constexpr size_t CfgKeySize = 32;              // privacy key size
+
+public:
+  explicit RadioTask(std::shared_ptr<const Config> config, std::shared_ptr<EventNotifier> eventNotifier,
+    std::shared_ptr<DataLink> dataLink, std::shared_ptr<PrivacyStore> privacyStore, std::shared_ptr<MemoryArena> arena,
+    int moduleId = 0, Role role = Role::RxTx);
+
+  void start(std::shared_ptr<AudioTask> audioTask, std::shared_ptr<RadioTask> repeaterRadioTask = nullptr);
   inline void stop() { isRunning_ = false; }
+  inline TaskHandle_t getTaskHandle() const { return loraTaskHandle_; }
+  inline uint32_t getTaskStackSize() const { return CfgRadioTaskStack; }
   bool loop();
+  uint32_t getLoopTimeoutMs() const;
 
   void setFreq(long freq) const;
-  inline bool isHalfDuplex() const { return config_->LoraFreqTx != config_->LoraFreqRx; }
+  inline bool isHalfDuplex() const { return role_ == Role::RxTx && config_->LoraFreqTx != config_->LoraFreqRx; }
+  inline bool isScanning() const { return isScanning_; }
+  inline bool isTransmitting() const { return isTransmitting_; }
+  inline long getRxFreq() const { return rxFreq_; }
+  inline bool canReceive() const { return role_ != Role::TxOnly; }
+  inline bool canTransmit() const { return role_ != Role::RxOnly; }
+  inline int getModuleId() const { return moduleId_; }
   inline float getRssi() const { return lastRssi_; }
+  inline float getSnr() const { return lastSnr_; }
+  inline Stats getStats() const { return statsLock_.read(); }
+  inline HeardCallsign getHeardCallsign() const { return heardLock_.read(); }
 
-  bool hasData() const;
-  bool readPacketSize(byte &packetSize);
-  bool readNextByte(byte &b);
+  inline bool hasData() const { return radioRxQueue_.hasData(); }
+  const byte *readPacket(RadioQueue::Packet &packet);
+  inline void releasePacket() { radioRxQueue_.release(); }
 
   void transmit() const;
   void startTransmit() const;
   void startReceive() const;
+  void setRxDutyCycle(bool isEnabled);
+  void wakeup();
   
-  bool writePacketSize(byte packetSize);
-  bool writeNextByte(byte b);
+  bool writePacket(const byte *packetBuf, int packetSize);
+  bool dropOldestTxPacket();
+  bool repeatPacket(const byte *packetBuf, int packetSize);
+  bool sendData(const byte *dataBuf, int dataSize);
+  inline int getTxQueueLoad() const { return radioTxQueue_.load(); }
+  int getMaxPacketSize() const;
+
+  bool setPrivacyKey(int keyId, const byte *key);
+  bool setPrivacyKeyId(int keyId);
 
 private:
   static constexpr int CfgCoreId = 1;                   // core id where task will run
   static constexpr int CfgTaskPriority = 2;             // task priority
 
-  static constexpr int CfgRadioQueueLen = 512;          // circular buffer length
   static constexpr int CfgRadioPacketBufLen = 256;      // packet buffer length
+  static constexpr int CfgRadioMaxPacketSize = 255;     // maximum radio packet size
+  static constexpr uint32_t CfgStatsLogIntervalMs = 10000; // throughput log interval
+
+  static constexpr int CfgScanCadSymbols = 2;           // symbols used by channel activity detection
+  static constexpr uint32_t CfgScanDetectHoldMs = 50;   // extra time to wait for the packet after detection
 
   static constexpr uint32_t CfgRadioRxBit = 0x01;       // task bit for rx
   static constexpr uint32_t CfgRadioTxBit = 0x02;       // task bit for tx
   static constexpr uint32_t CfgRadioRxStartBit = 0x04;  // task bit for start rx
   static constexpr uint32_t CfgRadioTxStartBit = 0x10;  // task bit for start tx
+  static constexpr uint32_t CfgRadioRxDutyBit = 0x20;   // task bit for rx duty cycle mode change
+  static constexpr uint32_t CfgRadioWakeupBit = 0x40;   // task bit for board wakeup by radio
 
   static constexpr int CfgRadioTaskStack = 4096;        // task stack size
+
+  static constexpr uint8_t CfgPacketFlagRaw = 0x01;     // tx packet is sent as is, without encryption
+
+  static constexpr int CfgPacketHeaderSize = 1;         // packet type, goes before payload and is encrypted with it
+  static constexpr uint8_t CfgPacketTypeMask = 0x0f;    // packet type bits
+  static constexpr uint8_t CfgPacketTypeVoice = 0x01;   // encoded audio frames
+  static constexpr uint8_t CfgPacketTypeData = 0x02;    // data message fragment
+  static constexpr uint8_t CfgPacketFlagAx25 = 0x10;    // AX.25 UI header follows the packet type
+  static constexpr const char *CfgCallsignDest = "CQ";  // AX.25 destination address
+
+  static constexpr uint32_t CfgVoiceIdleMs = 500;       // voice is idle if no packets for ms, until period is known
+  static constexpr uint32_t CfgDataGuardMs = 10;        // data fragment must end at least ms before next voice packet
+
+  static constexpr const char *CfgM17Dest = "@ALL";     // M17 destination, broadcast
+
+  static constexpr size_t CfgKeyIdSize = 1;             // key slot id size, goes before IV
   static constexpr size_t CfgIvSize = 12;               // IV/nonce, initialization vector size
   static constexpr size_t CfgAuthTagSize = 16;          // auth tag size
+  static constexpr size_t CfgPrivacyOverhead = CfgKeyIdSize + CfgIvSize + CfgAuthTagSize;
+
+  static constexpr int CfgPacketBufSize = CfgRadioPacketBufLen + Ax25::CfgHeaderSize; // room for callsign header
+  static constexpr int CfgTmpBufSize = CfgRadioPacketBufLen + CfgPrivacyOverhead;     // room for encryption overhead
+
+public:
+  // static memory needed by the task, radio driver and packet buffers are taken from the arena when started
+  static constexpr size_t CfgArenaSize = MemoryArena::reserve(sizeof(Module)) +
+    MemoryArena::reserve(sizeof(MODULE_NAME)) + MemoryArena::reserve(CfgPacketBufSize) +
+    MemoryArena::reserve(CfgTmpBufSize);
 
 private:
+  struct Pins {
+    byte ss;          // spi chip select
+    byte rst;         // reset
+    byte a;           // sx127x - dio0, sx126x/sx128x - dio1
+    byte b;           // sx127x - dio1, sx126x/sx128x - busy
+    byte switchRx;    // sx126x rx switch
+    byte switchTx;    // sx126x tx switch
+  };
+
+private:
+  void setupPins();
   void setupRig(long freq, long bw, int sf, int cr, int pwr, int sync, int crcBytes);
   void setupRigFsk(long freq, float bitRate, float freqDev, float rxBw, int pwr, byte shaping);
+  void setupRigIsr();
+  void setupRigModule();
+  long getFreq() const;
+  void tune(long freq, long bw, int sf);
 
-  static IRAM_ATTR void onRigIsrRxPacket();
+  template<int ModuleId> static IRAM_ATTR void onRigIsrRxPacket();
+  void onRigIsr();
 
   static void task(void *param);
 
   void rigTask();
   void rigTaskReceive(byte *packetBuf, byte *tmpBuf);
+  void rigTaskRepeat(byte *packetBuf, byte *tmpBuf, int rawPacketSize);
+  int rigTaskReadPacket(byte *packetBuf, int rawPacketSize, int &packetSize);
   void rigTaskTransmit(byte *packetBuf, byte *tmpBuf);
+  int rigTaskTagVoice(byte *payloadBuf, int payloadSize, int maxPacketSize);
+  void rigTaskHeardCallsign(const byte *header, int headerSize);
+  void rigTaskUpdateHeard(const char *callsign);
+  void rigTaskReceiveM17(int packetSize);
+  bool rigTaskTransmitM17(const byte *payloadBuf, int payloadSize, byte *tmpBuf);
+  void rigTaskEndM17();
+  bool rigTaskTransmitPacket(byte *packetBuf, byte *tmpBuf, int packetSize, bool isRaw);
   void rigTaskStartReceive();
   void rigTaskStartTransmit();
+  bool rigTaskScan();
+  bool isScanActive() const;
+  void rigTaskNotifyAudio();
+  void rigTaskWakeup(byte *packetBuf, byte *tmpBuf);
+  TickType_t rigTaskWaitTicks() const;
+  bool isVoiceActive() const;
+  bool canSendData(int fragmentSize) const;
+  bool isM17Mode() const;
+  void setupFec();
+  static int getPacketHeaderSize(const byte *packetBuf, int packetSize);
 
   void encryptPacket(byte *inBuf, byte *outBuf, int inBufSize, int& outBufSize);
   bool decryptPacket(byte *inBuf, byte *outBuf, int inBufSize, int& outBufSize);
+  bool setCipherKey(int keyId);
+
+  void publishStats();
+  void logStats();
+
+  static void writeUint32(byte *buf, uint32_t value);
+  static uint32_t readUint32(const byte *buf);
+
 private:
   std::shared_ptr<const Config> config_;
+  std::shared_ptr<EventNotifier> eventNotifier_;
+  std::shared_ptr<DataLink> dataLink_;
+  std::shared_ptr<PrivacyStore> privacyStore_;
+  std::shared_ptr<MemoryArena> arena_;
+
+  int moduleId_;
+  Role role_;
+  Pins pins_;
+
+  // isr has no context, so it looks up the task by module id
+  static RadioTask *instances_[CfgMaxModules];
+  static void (* const isrHandlers_[CfgMaxModules])();
 
   std::shared_ptr<MODULE_NAME> radioModule_;
+  void *moduleStorage_;
+  void *radioStorage_;
+  byte *packetBuf_;
+  byte *tmpBuf_;
   std::shared_ptr<AudioTask> audioTask_;
+  std::shared_ptr<RadioTask> repeaterRadioTask_;  // another module to repeat on, this one if not set
 
   std::shared_ptr<ChaChaPoly> cipher_;
+  ReplayFilter replayFilter_;
+  RepeaterFilter repeaterFilter_;
 
-  static TaskHandle_t loraTaskHandle_;
+  byte privacyKeys_[CfgKeySlots][CfgKeySize];
+  bool isPrivacyKeySet_[CfgKeySlots];
+  volatile int privacyKeyId_;
+  portMUX_TYPE privacyKeyLock_ = portMUX_INITIALIZER_UNLOCKED;
 
-  struct RadioQueue {
-    CircularBuffer<uint8_t, CfgRadioQueueLen> data;
-    CircularBuffer<uint8_t, CfgRadioQueueLen> index;
-  };
+  uint32_t senderId_;
+  uint32_t txEpoch_;
+  uint32_t txSeq_;
+  uint32_t lastRxSenderId_;
+  uint32_t lastRxEpoch_;
+  uint32_t lastRxSeq_;
+
+  // callsign header is sent at the start of the over and then periodically
+  byte callsignHeader_[Ax25::CfgHeaderSize];
+  bool isCallsignValid_;
+  uint32_t lastCallsignTxMs_;
+  HeardCallsign heardCallsign_;
+  SeqLock<HeardCallsign> heardLock_;
+
+  // raw packets are fec encoded after encryption, decoded before decryption
+  std::shared_ptr<Fec> fec_;
+  byte fecBuf_[CfgRadioPacketBufLen];
+
+  // voice is sent as M17 stream, link setup frame goes first, end of transmission closes it
+  std::shared_ptr<M17Framer> m17Framer_;
+  bool isM17StreamStarted_;
+
+  TaskHandle_t loraTaskHandle_;
 
   RadioQueue radioRxQueue_;
   RadioQueue radioTxQueue_;
 
+  // currently used channel, differs from settings when scanning memory channels
+  volatile long rxFreq_;
+  long txFreq_;
+  long loraBw_;
+  int loraSf_;
+  long tunedFreq_;
+  long tunedBw_;
+  int tunedSf_;
+
+  int scanChannelId_;
+  uint32_t scanHoldUntilMs_;
+  volatile bool isScanning_;
+
+  // radio sleeps between preamble checks while board is in sleep
+  volatile bool isRxDutyCycle_;
+  bool isRxDutyCycleActive_;
+
+  // first packet after wakeup goes to audio without batching
+  volatile bool isWakeupPending_;
+
+  // voice packet cadence, data is only sent in gaps between voice packets
+  volatile uint32_t lastVoiceQueuedMs_;
+  volatile uint32_t voicePeriodMs_;
+
+  int rxPendingPackets_;
+  uint32_t rxPendingSinceMs_;
+
   bool isImplicitMode_;
   bool isIsrInstalled_;
-  static volatile bool isIsrEnabled_;
+  volatile bool isIsrEnabled_;
+  volatile bool isTransmitting_;
   volatile bool isRunning_;
   volatile bool shouldUpdateScreen_;
   float lastRssi_;
+  float lastSnr_;
+
+  Stats stats_;
+  SeqLock<Stats> statsLock_;
+  Stats lastLoggedStats_;
+  uint32_t lastStatsLogMs_;
 };
 
 }
@@ -0,0 +1,138 @@
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define DEBUGLOG_DEFAULT_LOG_LEVEL_INFO
+#include <DebugLog.h>
+
+#include "settings/config.h"
+#include "hal/radio_queue.h"
+#include "hal/data_link.h"
+#include "hal/task_monitor.h"
+
+namespace LoraDv {
+
+class AudioTask;
+class RadioTask;
+
+// Binary control and telemetry protocol over serial for headless operation.
+// Frames are KISS framed (FEND, FESC escaping), each frame is started and ended
+// with FEND, so log output between frames is skipped by the host. Frame content
+// is type byte, payload and CRC-16/CCITT of type and payload, little endian.
+// Whole frame is written with a single write, so it is not interleaved with logs.
+// Outgoing voice is staged in a queue, so audio task never waits for the serial port.
+class SerialProtocol {
+
+public:
+  // host to device
+  static constexpr uint8_t CfgCmdPing = 0x01;           // -> pong with firmware version
+  static constexpr uint8_t CfgCmdGetConfig = 0x02;      // name\0 -> name\0 value
+  static constexpr uint8_t CfgCmdSetConfig = 0x03;      // name\0 value -> ack, applied after reboot
+  static constexpr uint8_t CfgCmdReboot = 0x04;         // restart device
+  static constexpr uint8_t CfgCmdPtt = 0x05;            // 1 byte, 1 - start, 0 - stop transmitting from mic
+  static constexpr uint8_t CfgCmdVoiceTx = 0x06;        // encoded voice packet to transmit
+  static constexpr uint8_t CfgCmdTelemetry = 0x07;      // uint16 interval ms, 0 - disable
+  static constexpr uint8_t CfgCmdVoiceRxStream = 0x08;  // 1 byte, 1 - stream received voice packets
+  static constexpr uint8_t CfgCmdDataTx = 0x09;         // data message to transmit
+  static constexpr uint8_t CfgCmdTaskStats = 0x0a;      // -> core loads and peaks, task stack usage and loads
+  static constexpr uint8_t CfgCmdSetKey = 0x0b;         // key slot, 32 byte key -> ack, applied immediately
+  static constexpr uint8_t CfgCmdSetKeyId = 0x0c;       // key slot for transmission -> ack, applied immediately
+  // device to host
+  static constexpr uint8_t CfgRspFlag = 0x80;           // response to a command has this bit set
+  static constexpr uint8_t CfgEvtVoiceRx = 0x90;        // int8 rssi, int8 snr * 4, encoded voice packet
+  static constexpr uint8_t CfgEvtTelemetry = 0x91;      // counters
+  static constexpr uint8_t CfgEvtDataRx = 0x92;         // int8 rssi, int8 snr * 4, received data message
+  static constexpr uint8_t CfgRspError = 0xff;          // command type, error code
+
+  static constexpr uint8_t CfgErrCrc = 0x01;            // frame crc mismatch
+  static constexpr uint8_t CfgErrUnknown = 0x02;        // unknown command
+  static constexpr uint8_t CfgErrArgs = 0x03;           // wrong command arguments
+  static constexpr uint8_t CfgErrFailed = 0x04;         // command failed
+
+  static constexpr int CfgMaxFrameSize = DataLink::CfgMaxMessageSize + 8; // unescaped frame size
+  static constexpr int CfgTxBufferSize = 2 * CfgMaxFrameSize + 2;        // serial tx ring, fits escaped frame
+
+public:
+  SerialProtocol(std::shared_ptr<Config> config, std::shared_ptr<DataLink> dataLink);
+
+  void start(std::shared_ptr<AudioTask> audioTask, std::shared_ptr<RadioTask> rxRadioTask, 
+    std::shared_ptr<RadioTask> txRadioTask, std::shared_ptr<TaskMonitor> taskMonitor);
+  inline void stop() { isRunning_ = false; }
+  inline TaskHandle_t getTaskHandle() const { return protocolTaskHandle_; }
+  inline uint32_t getTaskStackSize() const { return CfgTaskStack; }
+
+  bool sendVoice(const byte *packetBuf, int packetSize, float rssi, float snr);
+
+  static uint16_t crc16(const byte *data, int dataLen, uint16_t crc = 0xffff);
+
+private:
+  static constexpr int CfgCoreId = 1;                   // core id where task will run
+  static constexpr int CfgTaskPriority = 1;             // task priority, lower than radio and audio
+  static constexpr int CfgTaskStack = 4096;             // task stack size
+
+  static constexpr uint32_t CfgRxBit = 0x01;            // task bit for received serial data
+  static constexpr uint32_t CfgVoiceBit = 0x02;         // task bit for staged voice packets
+  static constexpr uint32_t CfgDataBit = 0x04;          // task bit for received data messages
+
+  static constexpr uint32_t CfgVoiceTxHangMs = 500;     // go back to rx after no voice from host for ms
+
+  static constexpr uint8_t CfgFend = 0xc0;              // kiss frame end
+  static constexpr uint8_t CfgFesc = 0xdb;              // kiss frame escape
+  static constexpr uint8_t CfgTfend = 0xdc;             // escaped frame end
+  static constexpr uint8_t CfgTfesc = 0xdd;             // escaped frame escape
+
+private:
+  static void task(void *param);
+  void protocolTask();
+
+  void receiveBytes();
+  void processFrame(const byte *frame, int frameSize);
+  void processCommand(uint8_t type, const byte *payload, int payloadSize);
+  void processVoiceTx(const byte *payload, int payloadSize);
+  void processDataTx(const byte *payload, int payloadSize);
+  void processSetKey(const byte *payload, int payloadSize);
+  void processSetKeyId(const byte *payload, int payloadSize);
+
+  void sendStagedVoice();
+  void sendReceivedData();
+  void sendTelemetry();
+  void sendTaskStats();
+  void sendAck(uint8_t type, const byte *payload = nullptr, int payloadSize = 0);
+  void sendError(uint8_t type, uint8_t errorCode);
+  bool sendFrame(uint8_t type, const byte *payload, int payloadSize);
+
+  TickType_t getWaitTicks() const;
+
+  static void writeUint32(byte *buf, uint32_t value);
+
+private:
+  std::shared_ptr<Config> config_;
+  std::shared_ptr<DataLink> dataLink_;
+  std::shared_ptr<AudioTask> audioTask_;
+  std::shared_ptr<RadioTask> rxRadioTask_;
+  std::shared_ptr<RadioTask> txRadioTask_;
+  std::shared_ptr<TaskMonitor> taskMonitor_;
+
+  TaskHandle_t protocolTaskHandle_;
+  RadioQueue voiceQueue_;
+
+  byte rxFrame_[CfgMaxFrameSize];
+  int rxFrameSize_;
+  bool isRxEscaped_;
+  bool isRxOverflow_;
+  byte txFrame_[CfgTxBufferSize];
+
+  uint32_t telemetryIntervalMs_;
+  uint32_t lastTelemetryMs_;
+  uint32_t lastVoiceTxMs_;
+  bool isVoiceTxActive_;
+  volatile bool isVoiceRxStreamEnabled_;
+  volatile bool isRunning_;
+  uint32_t txDropped_;
+};
+
+} // LoraDv
+
+#endif // SERIAL_PROTOCOL_H
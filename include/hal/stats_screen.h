@@ -0,0 +1,57 @@
+#ifndef STATS_SCREEN_H
+#define STATS_SCREEN_H
+
+#include <Arduino.h>
+#include <memory>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+
+#include "settings/config.h"
+#include "hal/radio_task.h"
+#include "audio/audio_task.h"
+
+namespace LoraDv {
+
+// Link statistics screen for field tuning, rssi and snr bars, packet loss,
+// rx queue depth, codec, effective bit rate and airtime duty cycle. Stats are
+// read as snapshots from radio and audio tasks, screen is redrawn at a bounded
+// rate, so it never slows down the audio path.
+class StatsScreen {
+
+public:
+  StatsScreen(std::shared_ptr<const Config> config, std::shared_ptr<Adafruit_SSD1306> display);
+
+  void reset();
+  bool loop(const RadioTask::Stats &radioStats, const AudioTask::Stats &audioStats);
+  uint32_t getLoopTimeoutMs() const;
+
+private:
+  static constexpr uint32_t CfgRefreshMs = 500;         // redraw interval
+  static constexpr float CfgRateSmoothing = 0.3f;       // weight of the newest rate sample
+  static constexpr float CfgRssiMin = -130.0f;          // rssi bar range
+  static constexpr float CfgRssiMax = -30.0f;
+  static constexpr float CfgSnrMin = -20.0f;            // snr bar range
+  static constexpr float CfgSnrMax = 15.0f;
+  static constexpr int CfgBarX = 8;                     // bar position and size
+  static constexpr int CfgBarWidth = 80;
+  static constexpr int CfgBarHeight = 6;
+
+private:
+  void drawBar(int y, float value, float minValue, float maxValue) const;
+  static float smooth(float average, float sample);
+
+private:
+  std::shared_ptr<const Config> config_;
+  std::shared_ptr<Adafruit_SSD1306> display_;
+
+  RadioTask::Stats lastRadioStats_;
+  uint32_t lastDrawMs_;
+  float bitRate_;
+  float dutyCycle_;
+  float lossPercent_;
+  bool hasLastStats_;
+};
+
+} // LoraDv
+
+#endif // STATS_SCREEN_H
@@ -0,0 +1,69 @@
+#ifndef STATUS_SCREEN_H
+#define STATUS_SCREEN_H
+
+#include <Arduino.h>
+#include <memory>
+#include <Wire.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+
+namespace LoraDv {
+
+// Retained status screen, keeps last text of each field, redraws only changed
+// fields in the frame buffer and pushes only changed columns of changed pages
+// to the display, so small updates such as rssi or volume do not transfer
+// the whole frame buffer over i2c.
+class StatusScreen {
+
+public:
+  enum class Field {
+    Volume = 0,
+    Battery,
+    Level,
+    Freq,
+    Mode,
+    Count
+  };
+
+public:
+  StatusScreen(std::shared_ptr<Adafruit_SSD1306> display, uint8_t i2cAddress);
+
+  void setField(Field field, const char *text);
+  void invalidate();
+  void update();
+
+private:
+  static constexpr int CfgFieldsCount = (int)Field::Count;
+  static constexpr int CfgMaxFieldLen = 16;             // maximum field text length
+  static constexpr int CfgMaxPages = 8;                 // 8 pixel rows per page, up to 64 pixels height
+  static constexpr int CfgI2cChunkSize = 127;           // data bytes per i2c transfer, wire buffer is 128 bytes
+  static constexpr uint8_t CfgI2cDataControl = 0x40;    // control byte for display ram data
+
+  struct FieldLayout {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    uint8_t textSize;
+  };
+
+  static const FieldLayout Layout[CfgFieldsCount];
+
+private:
+  void drawField(int fieldId);
+  void markDirty(int x, int y, int w, int h);
+  void pushPage(int page, int colStart, int colEnd);
+
+private:
+  std::shared_ptr<Adafruit_SSD1306> display_;
+  uint8_t i2cAddress_;
+
+  char texts_[CfgFieldsCount][CfgMaxFieldLen];
+  bool isFieldDirty_[CfgFieldsCount];
+  int16_t dirtyColStart_[CfgMaxPages];
+  int16_t dirtyColEnd_[CfgMaxPages];
+  bool isInvalidated_;
+};
+
+} // LoraDv
+
+#endif // STATUS_SCREEN_H
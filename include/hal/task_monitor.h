@@ -0,0 +1,97 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <Arduino.h>
+#include <memory>
+#include <esp_freertos_hooks.h>
+
+#include "settings/config.h"
+#include "utils/seq_lock.h"
+
+namespace LoraDv {
+
+// Samples task stack high water marks and per core load in background and keeps
+// peaks for the running codec mode, so task stacks could be sized from real usage.
+// Core load is sampled on every tick by checking if the idle task is running,
+// cores in light sleep have no ticks, so sleep does not count as load.
+class TaskMonitor {
+
+public:
+  static constexpr int CfgMaxTasks = 10;                    // maximum number of monitored tasks
+  static constexpr int CfgCoreCount = portNUM_PROCESSORS;   // number of cores
+  static constexpr uint32_t CfgNoLoad = UINT32_MAX;         // task load is not available
+
+  struct TaskStats {
+    const char *name;
+    uint32_t stackSize;       // configured stack size in bytes
+    uint32_t stackFree;       // minimum free stack since task start in bytes
+    uint32_t load;            // percent of one core during last interval, if run time stats are enabled
+    uint32_t peakLoad;        // maximum load since start
+  };
+
+  struct Stats {
+    int tasksCount;
+    TaskStats tasks[CfgMaxTasks];
+    uint32_t coreLoad[CfgCoreCount];      // percent during last interval
+    uint32_t corePeakLoad[CfgCoreCount];  // maximum since start
+  };
+
+public:
+  TaskMonitor(std::shared_ptr<const Config> config);
+
+  // tasks are added from setup before start
+  void addTask(const char *name, TaskHandle_t taskHandle, uint32_t stackSize);
+  void start();
+  inline void stop() { isRunning_ = false; }
+
+  inline bool isRunning() const { return isRunning_; }
+  inline Stats getStats() const { return statsLock_.read(); }
+  inline const char *getModeName() const { return modeName_; }
+  void logPeaks() const;
+
+private:
+  static constexpr int CfgCoreId = 0;                       // core id where task will run
+  static constexpr int CfgTaskPriority = 1;                 // task priority
+  static constexpr int CfgTaskStack = 2048;                 // task stack size
+  static constexpr uint32_t CfgPeakLogIntervalMs = 60000;   // log new peaks not more often than ms
+  static constexpr int CfgMaxSystemTasks = 24;              // task status snapshot size
+  static constexpr int CfgModeNameSize = 24;                // codec mode name size
+
+private:
+  static void task(void *param);
+  void taskMonitorTask();
+
+  template<int CoreId> static IRAM_ATTR void onTick();
+
+  bool sampleCoreLoad();
+  bool sampleStacks();
+  bool sampleTaskLoad();
+  void updateModeName();
+
+private:
+  std::shared_ptr<const Config> config_;
+  TaskHandle_t taskMonitorTaskHandle_;
+
+  TaskHandle_t taskHandles_[CfgMaxTasks];
+  Stats stats_;
+  SeqLock<Stats> statsLock_;
+  char modeName_[CfgModeNameSize];
+
+  // tick hooks count ticks and ticks when idle task was running
+  static void (* const tickHooks_[CfgCoreCount])();
+  static TaskHandle_t idleTaskHandles_[CfgCoreCount];
+  static volatile uint32_t tickCounts_[CfgCoreCount];
+  static volatile uint32_t idleTickCounts_[CfgCoreCount];
+  uint32_t lastTickCounts_[CfgCoreCount];
+  uint32_t lastIdleTickCounts_[CfgCoreCount];
+
+  uint32_t lastRunTimes_[CfgMaxTasks];
+  uint32_t lastTotalRunTime_;
+  uint32_t lastPeakLogMs_;
+
+  volatile bool isRunning_;
+};
+
+} // LoraDv
+
+#endif // TASK_MONITOR_H
@@ -0,0 +1,97 @@
+#ifndef M17_FRAMER_H
+#define M17_FRAMER_H
+
+#include <Arduino.h>
+
+#include "fec/golay24.h"
+#include "fec/conv_code.h"
+
+namespace LoraDv {
+
+// M17 stream mode framing. Stream starts with link setup frame (LSF) carrying
+// addresses and stream type, followed by 40 ms stream frames, each frame carries
+// 1/6 of the LSF (LICH) protected by Golay(24,12), so late listeners could rebuild
+// it, frame number and 16 bytes of Codec2 payload protected by punctured convolutional
+// code. Frame bits are interleaved and randomized, sync word goes first and end of
+// transmission frame closes the stream. Radio modulation is 2FSK, so frames follow
+// M17 bit layout, but are not compatible with 4FSK M17 radios on air.
+class M17Framer {
+
+public:
+  enum class FrameType {
+    Invalid = 0,
+    Lsf,
+    Stream,
+    Eot
+  };
+
+  static constexpr int CfgFrameSize = 48;               // sync word and 368 bits of frame
+  static constexpr int CfgPayloadSize = 16;             // stream frame payload, 2 x Codec2 3200 or Codec2 1600 with data
+  static constexpr uint32_t CfgFrameMs = 40;            // stream frame duration
+  static constexpr int CfgMaxCallsignLen = 9;           // base-40 encoded callsign length
+  static constexpr uint16_t CfgTypeVoice = 0x0005;      // stream, voice only, Codec2 3200
+  static constexpr uint16_t CfgTypeVoiceData = 0x0007;  // stream, voice and data, Codec2 1600
+
+public:
+  M17Framer();
+
+  bool setLsf(const char *dst, const char *src, uint16_t type);
+
+  void startStream();
+  int encodeLsf(byte *frame);
+  int encodeStream(const byte *payload, int payloadSize, bool isLast, byte *frame);
+  int encodeEot(byte *frame);
+
+  FrameType decode(const byte *frame, int frameSize, byte *payload, bool &isLast);
+  bool getRxSource(char *src, int srcLen) const;
+
+  static bool encodeCallsign(const char *text, byte *address);
+  static bool decodeCallsign(const byte *address, char *text, int textLen);
+  static uint16_t crc16(const byte *data, int dataLen);
+
+private:
+  static constexpr int CfgSyncSize = 2;                 // sync word size
+  static constexpr int CfgBits = 368;                   // frame bits after sync word
+  static constexpr int CfgLsfSize = 30;                 // dst, src, type, meta and crc
+  static constexpr int CfgLsfDataBits = 8 * CfgLsfSize; // convolutionally coded lsf bits
+  static constexpr int CfgLichChunkSize = 5;            // lsf bytes carried by each stream frame
+  static constexpr int CfgLichChunks = 6;               // lsf is split into 6 chunks
+  static constexpr int CfgLichBits = 96;                // 4 Golay codewords
+  static constexpr int CfgStreamDataBits = 8 * (2 + CfgPayloadSize); // frame number and payload
+  static constexpr int CfgPunctureP1Len = 61;           // lsf puncturing pattern length
+  static constexpr int CfgPunctureP2Len = 12;           // stream puncturing pattern length
+
+  static constexpr uint16_t CfgSyncLsf = 0x55f7;        // link setup frame sync word
+  static constexpr uint16_t CfgSyncStream = 0xff5d;     // stream frame sync word
+  static constexpr uint16_t CfgSyncEot = 0x555d;        // end of transmission marker
+  static constexpr uint16_t CfgFrameNumberLast = 0x8000; // end of stream bit in frame number
+
+  static const uint8_t RandomSequence[CfgBits / 8];
+  static const char Charset[41];
+
+private:
+  int finishFrame(uint16_t sync, const uint8_t *bits, byte *frame) const;
+  bool readFrameBits(const byte *frame, uint8_t *softBits) const;
+  void storeLichChunk(const byte *lich);
+
+private:
+  Golay24 golay_;
+  ConvCode convCode_;
+  uint8_t punctureP1_[CfgPunctureP1Len];
+  uint8_t punctureP2_[CfgPunctureP2Len];
+  uint16_t interleave_[CfgBits];
+
+  byte txLsf_[CfgLsfSize];
+  uint16_t txFrameNumber_;
+
+  byte rxLsf_[CfgLsfSize];
+  bool isRxLsfValid_;
+  byte rxLichLsf_[CfgLsfSize];
+  uint8_t rxLichMask_;
+
+  uint8_t bits_[CfgBits];
+};
+
+} // LoraDv
+
+#endif // M17_FRAMER_H
@@ -17,9 +17,18 @@
 #include "settings/config.h"
 #include "hal/radio_task.h"
 #include "audio/audio_task.h"
+#include "audio/voice_recorder.h"
 #include "hal/pm_service.h"
 #include "hal/hw_monitor.h"
+#include "hal/task_monitor.h"
+#include "hal/status_screen.h"
+#include "hal/stats_screen.h"
+#include "hal/serial_protocol.h"
+#include "hal/data_link.h"
 #include "settings/settings_menu.h"
+#include "settings/privacy_store.h"
+#include "utils/event_notifier.h"
+#include "utils/memory_arena.h"
 
 namespace LoraDv {
 
@@ -34,37 +43,70 @@ public:
 private:
   static constexpr int CfgDisplayWidth = 128;                // display width
   static constexpr int CfgDisplayHeight = 32;                // display height
+  static constexpr uint8_t CfgDisplayI2cAddress = 0x3C;      // display i2c address
 
   static constexpr int CfgEncoderBtnLongMs = 2000;           // encoder long button press
+  static constexpr uint32_t CfgButtonPollMs = 10;            // button polling interval while it is held
+  static constexpr uint32_t CfgDoubleClickMs = 400;          // second click within ms is a double click
+  static constexpr uint32_t CfgCallsignShowMs = 30000;       // show talker callsign while playing if heard within ms
+  static constexpr int CfgFreqFieldLen = 7;                  // characters fitting into frequency field
+
+  // task buffers for the audio task and all radio modules, reserved at build time
+  static constexpr size_t CfgArenaSize = AudioTask::CfgArenaSize + RadioTask::CfgMaxModules * RadioTask::CfgArenaSize;
 
 private:
+  void setupRadios();
   void setupEncoder();
   void setupScreen();
   void setupPttButton();
+  void setupTaskMonitor();
+  void logMemoryUsage() const;
 
   static IRAM_ATTR void isrReadEncoder();
+  static IRAM_ATTR void isrEncoderButton();
+  static IRAM_ATTR void isrPttButton();
 
   void updateScreen() const;
+  uint32_t getLoopTimeoutMs() const;
+
+  std::shared_ptr<RadioTask> getRxRadioTask() const;
+  std::shared_ptr<RadioTask> getTxRadioTask() const;
 
   bool processPttButton();
   bool processRotaryEncoder();
+  bool processPendingClick();
 
 private:
   std::shared_ptr<Config> config_;
 
+  static DMA_ATTR uint8_t arenaBuffer_[CfgArenaSize];
+  std::shared_ptr<MemoryArena> arena_;
+
   std::shared_ptr<Adafruit_SSD1306> display_;
+  std::shared_ptr<StatusScreen> statusScreen_;
+  std::shared_ptr<StatsScreen> statsScreen_;
   static std::shared_ptr<AiEsp32RotaryEncoder> rotaryEncoder_;
+  static std::shared_ptr<EventNotifier> eventNotifier_;
 
   std::shared_ptr<PmService> pmService_;
   std::shared_ptr<HwMonitor> hwMonitor_;
+  std::shared_ptr<TaskMonitor> taskMonitor_;
+  std::shared_ptr<DataLink> dataLink_;
+  std::shared_ptr<PrivacyStore> privacyStore_;
 
   std::shared_ptr<RadioTask> radioTask_;
+  std::shared_ptr<RadioTask> auxRadioTask_;   // second module if installed
+  std::shared_ptr<VoiceRecorder> voiceRecorder_;
+  std::shared_ptr<SerialProtocol> serialProtocol_;
   std::shared_ptr<AudioTask> audioTask_;
 
   std::shared_ptr<SettingsMenu> settingsMenu_;
 
   // other
   volatile bool btnPressed_;
+  bool isStatsVisible_;
+  bool isClickPending_;
+  uint32_t clickMs_;
 
 }; // Service
 
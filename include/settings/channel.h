@@ -0,0 +1,39 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Memory channel, 8 bytes, channel table is stored in NVS as a single blob.
+// Lora coding rate and fsk modem parameters are not per channel, they are taken from the settings,
+// fsk channels keep fec type in place of lora bandwidth.
+struct Channel {
+  uint32_t freqRx;        // rx frequency in Hz, 0 if channel is not used
+  int16_t txOffsetKhz;    // tx frequency offset from rx frequency in kHz
+  uint8_t modulation;     // bits 0-3 - lora spreading factor or 0 for fsk, bits 4-7 - lora bandwidth index or fsk fec
+  uint8_t audio;          // bits 0-3 - codec, bits 4-6 - privacy key slot, bit 7 - privacy enabled
+
+  static constexpr int CfgBandwidthsCount = 10;
+  static const long Bandwidths[CfgBandwidthsCount];   // lora bandwidths by index
+
+  inline bool isEmpty() const { return freqRx == 0; }
+  inline long getFreqRx() const { return freqRx; }
+  inline long getFreqTx() const { return (long)freqRx + (long)txOffsetKhz * 1000; }
+  inline bool isLora() const { return (modulation & 0x0f) != 0; }
+  inline int getLoraSf() const { return modulation & 0x0f; }
+  inline long getLoraBw() const { return Bandwidths[min((modulation >> 4) & 0x0f, CfgBandwidthsCount - 1)]; }
+  inline int getFskFec() const { return isLora() ? 0 : (modulation >> 4) & 0x0f; }
+  inline int getCodec() const { return audio & 0x0f; }
+  inline int getPrivKeyId() const { return (audio >> 4) & 0x07; }
+  inline bool isPrivacy() const { return (audio & 0x80) != 0; }
+
+  // tx offset must be whole kHz within int16 range, wider cross band splits could not be stored
+  static bool isTxOffsetValid(long freqRx, long freqTx);
+  static Channel make(long freqRx, long freqTx, bool isLora, long bw, int sf, int fskFec, int codec, 
+    bool isPrivacy, int privKeyId);
+};
+
+} // LoraDv
+
+#endif // CHANNEL_H
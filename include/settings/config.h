@@ -9,6 +9,7 @@
 
 #include "version.h"
 #include "settings/default_config.h"
+#include "settings/channel.h"
 
 namespace LoraDv {
 
@@ -33,11 +34,23 @@ public:
   int LoraCrc_;         // lora crc mode, 0 - disabled, 1 - 1 byte, 2 - 2 bytes
   int LoraPreambleLen_; // lora preamble length from 6 to 65535
 
+  // radio rx batching
+  int RadioRxBatchPackets_;      // wake up audio after given number of received packets
+  uint32_t RadioRxBatchDeadlineMs_; // wake up audio after given ms even if batch is not complete
+
+  // memory channels and scanning
+  int ChannelId;        // active memory channel, -1 if frequencies are set manually
+  bool ScanEnabled;     // scan memory channels for activity
+  int ScanHoldMs_;      // stay on the active channel after its last packet
+  Channel Channels_[CFG_CHANNELS_COUNT]; // memory channels
+
   // fsk modulation parameters
   float FskBitRate;     // fsk bit rate, 0.6 - 300.0 Kbps
   float FskFreqDev;     // fsk frequency deviation 0.6 - 200 kHz
   float FskRxBw;        // fsk rx bandwidth, discrete from 4.8 to 467 kHz
   byte FskShaping;      // fsk gaussian shaping
+  int FskFec;           // fsk forward error correction type
+  bool UepEnabled;      // unequal error protection of codec2 frames, lora and fsk, overrides fec type
 
   // lora hardware pinouts and isr
   byte LoraPinSs_;       // lora ss pin
@@ -48,6 +61,15 @@ public:
   byte LoraPinSwitchTx_; // (sx127x - unused, sx126x - TXEN pin number)
   long LoraFreqMin_;     // module minimum frequency
   long LoraFreqMax_;     // module maximum frequency
+
+  // second lora module, same modulation parameters as the first one
+  int Lora2Mode_;         // 0 - not installed, 1 - dedicated rx module, 2 - dedicated tx module
+  byte Lora2PinSs_;       // lora ss pin
+  byte Lora2PinRst_;      // lora rst pin
+  byte Lora2PinA_;        // (sx127x - dio0, sx126x/sx128x - dio1)
+  byte Lora2PinB_;        // (sx127x - dio1, sx126x/sx128x - busy)
+  byte Lora2PinSwitchRx_; // (sx127x - unused, sx126x - RXEN pin number)
+  byte Lora2PinSwitchTx_; // (sx127x - unused, sx126x - TXEN pin number)
   
   // rotary encoder
   byte EncoderPinA_;     // Encoder A pin number
@@ -70,6 +92,7 @@ public:
   // audio opus
   int AudioOpusRate;  // opus bit rate 2.4 - 512 kbps
   float AudioOpusPcmLen;   // opus pcm frame length, 2.5, 5, 10, 20, 40, 60, 80, 100, 120 ms  
+  int AudioOpusComplexity_; // opus encoder complexity 0 - 10
 
   // i2s speaker
   byte AudioSpkPinBclk_; // Speaker i2s clk pin
@@ -80,6 +103,7 @@ public:
   byte AudioMicPinSd_;   // Mic i2s sd pin
   byte AudioMicPinWs_;   // Mic i2s ws pin
   byte AudioMicPinSck_;  // Mic i2s sck pin
+  bool AudioI2sFullDuplex_; // Mic shares speaker i2s port and clocks
 
   // audio state
   int AudioMaxVol_;      // maximum volume
@@ -87,7 +111,16 @@ public:
 
   // privacy
   bool AudioEnPriv;     // enable/disable privacy
-  byte AudioPrivacyKey_[32]; // privacy key
+  int AudioPrivKeyId;   // privacy key slot used for transmission
+  byte AudioPrivacyKeys_[CFG_AUDIO_PRIVACY_KEY_SLOTS][32]; // privacy keys by key slot
+
+  // repeater
+  bool RepeaterEnabled;  // repeat received packets on tx frequency, no local playback
+  int RepeaterHangMs; // stay locked to the current stream after its last packet
+  bool RepeaterVerify_;  // authenticate encrypted packets before repeating
+
+  // voice recorder
+  int RecorderMode;      // 0 - off, 1 - rx, 2 - rx and tx, 3 - parrot
 
   // battery monitor
   byte BatteryMonPin_;   // Battery monitor adc pin
@@ -97,20 +130,64 @@ public:
   int PmSleepAfterMs; // Light sleep activation after given ms
   int PmLightSleepDurationMs_; // How long to sleep
   int PmLightSleepAwakeMs_; // How long to be active
+  int PmDimAfterMs_;   // Dim display and lower cpu frequency after given ms
+  int PmDeepSleepAfterMs_; // Deep sleep after given ms in light sleep, 0 - disabled
+  bool PmDvfsEnabled_; // Scale cpu frequency with codec load
+  uint32_t PmIdleCpuMhz_; // Cpu frequency when idle
+  int PmBatteryMah_;   // Battery capacity
+  int PmActiveMa_;     // Average current when active
+  int PmIdleMa_;       // Average current when idle
+  int PmSleepMa_;      // Average current in light sleep
+  int PmSleepDutyMa_;  // Average current in light sleep with rx duty cycle
 
   // ptt button
   int PttBtnPin_;            // ptt pin
 
+  // display
+  uint32_t DisplayI2cClock_; // display i2c bus clock
+
+  // serial control protocol
+  bool SerialProtocolEnabled_;   // binary control and telemetry protocol over serial
+  int SerialTelemetryMs_;        // default telemetry interval, 0 to disable
+
+  // task monitor
+  bool TaskMonitorEnabled_;      // sample task stack usage and core load
+  uint32_t TaskMonitorIntervalMs_; // sampling interval
+
+  // callsign
+  bool CallsignEnabled;          // tag transmitted voice with AX.25 header carrying callsign
+  char Callsign[CFG_CALLSIGN_SIZE]; // own callsign with optional ssid
+  int CallsignIntervalMs_;       // repeat callsign header during the over every ms
+
+  // m17
+  bool M17Enabled;               // send voice as M17 stream frames instead of native packets
+
 public:
   Config();
   void Load();
   void Save();
   void Reset();
 
+  int GetField(const char *name, byte *value, int maxValueSize);
+  bool SetField(const char *name, const byte *value, int valueSize);
+
+  bool IsPrivacyKeySet(int keyId) const;
+  void GetPrivacyKey(int keyId, byte *key) const;
+  bool ApplyChannel(int channelId);
+  bool StoreChannel(int channelId);
+  bool SetPrivacyKey(int keyId, const byte *key);
+  bool SetPrivacyKeyId(int keyId);
+
 private:
   void InitializeDefault();
+  void LoadPrivacyKeys();
+  void SavePrivacyKeys();
+  void LoadChannels();
+  void SaveChannels();
 
   Preferences prefs_;
+  Preferences serialPrefs_;      // serial task handle, prefs_ is used by the ui task
+  mutable portMUX_TYPE privacyKeysLock_ = portMUX_INITIALIZER_UNLOCKED;
 
 }; // Config
 
@@ -55,6 +55,33 @@
 #define CFG_LORA_PIN_TXEN           33          // (sx127x - unused, sx126x - TXEN pin number)
 #endif
 
+// second LoRa module on the same SPI bus for full duplex cross band operation,
+// one module is dedicated to rx and another one to tx, so rx is not interrupted when transmitting
+#define CFG_LORA2_MODE_NONE         0           // not installed, single module does both rx and tx
+#define CFG_LORA2_MODE_RX           1           // second module receives, first one transmits
+#define CFG_LORA2_MODE_TX           2           // second module transmits, first one receives
+#ifndef CFG_LORA2_MODE
+#define CFG_LORA2_MODE              CFG_LORA2_MODE_NONE
+#endif
+#ifndef CFG_LORA2_PIN_NSS
+#define CFG_LORA2_PIN_NSS           27
+#endif
+#ifndef CFG_LORA2_PIN_RST
+#define CFG_LORA2_PIN_RST           RADIOLIB_NC // do not share with the first module, begin() resets the module
+#endif
+#ifndef CFG_LORA2_PIN_DIO1
+#define CFG_LORA2_PIN_DIO1          35          // (sx127x - dio0, sx126x/sx128x - dio1)
+#endif
+#ifndef CFG_LORA2_PIN_BUSY
+#define CFG_LORA2_PIN_BUSY          RADIOLIB_NC // (sx127x - dio1, sx126x/sx128x - busy), must be set for sx126x
+#endif
+#ifndef CFG_LORA2_PIN_RXEN
+#define CFG_LORA2_PIN_RXEN          RADIOLIB_NC // (sx127x - unused, sx126x - RXEN pin number)
+#endif
+#ifndef CFG_LORA2_PIN_TXEN
+#define CFG_LORA2_PIN_TXEN          RADIOLIB_NC // (sx127x - unused, sx126x - TXEN pin number)
+#endif
+
 // generic - frequencies, tune step, power
 #ifndef CFG_LORA_FREQ_RX
 #define CFG_LORA_FREQ_RX            433.775e6   // RX frequency in MHz
@@ -95,6 +122,29 @@
 #define CFG_LORA_PREAMBLE_LEN       8           // preamble length from 6 to 65535
 #endif
 
+// memory channels, stored in settings, scan hops over lora channels with the same codec
+#ifndef CFG_CHANNELS_COUNT
+#define CFG_CHANNELS_COUNT          16          // number of memory channels
+#endif
+#ifndef CFG_CHANNEL_ID
+#define CFG_CHANNEL_ID              -1          // active memory channel, -1 to use frequencies from settings
+#endif
+#ifndef CFG_SCAN_ENABLED
+#define CFG_SCAN_ENABLED            false
+#endif
+#ifndef CFG_SCAN_HOLD_MS
+#define CFG_SCAN_HOLD_MS            3000        // stay on the channel after last packet before resuming scan
+#endif
+
+// radio rx batching, audio task is woken up once per batch instead of once per packet,
+// deadline bounds added latency when packets are sparse
+#ifndef CFG_RADIO_RX_BATCH_PACKETS
+#define CFG_RADIO_RX_BATCH_PACKETS  1           // 1 wakes up audio on every packet
+#endif
+#ifndef CFG_RADIO_RX_BATCH_DEADLINE_MS
+#define CFG_RADIO_RX_BATCH_DEADLINE_MS 40       // maximum delay before waking up audio
+#endif
+
 // fsk modem default parameters (they need to match between devices!!!)
 #ifndef CFG_FSK_BIT_RATE
 #define CFG_FSK_BIT_RATE            4.8         // bit rate in Kbps from 0.6 to 300.0
@@ -108,12 +158,65 @@
 #ifndef CFG_FSK_SHAPING
 #define CFG_FSK_SHAPING             RADIOLIB_SHAPING_NONE
 #endif
+#define CFG_FSK_FEC_NONE            0           // radio crc only
+#define CFG_FSK_FEC_GOLAY           1           // golay(24,12), rate 1/2, drops uncorrectable packets
+#define CFG_FSK_FEC_CONV            2           // convolutional k=5, rate 1/2, viterbi decoding
+#ifndef CFG_FSK_FEC
+#define CFG_FSK_FEC                 CFG_FSK_FEC_NONE
+#endif
+#ifndef CFG_UEP_ENABLED
+#define CFG_UEP_ENABLED             false       // codec2 sensitive bits protected stronger, radio crc disabled
+#endif
+#ifndef CFG_RADIO_STATS_LOG
+#define CFG_RADIO_STATS_LOG         false       // log radio throughput periodically, wakes up ui loop
+#endif
 
 // ptt button
 #ifndef CFG_PTT_BTN_PIN
 #define CFG_PTT_BTN_PIN             39          // pin for ptt button
 #endif
 
+// display
+#ifndef CFG_DISPLAY_I2C_CLOCK
+#define CFG_DISPLAY_I2C_CLOCK       400000      // display i2c bus clock, ssd1306 usually works up to 1MHz
+#endif
+
+// serial control protocol
+#ifndef CFG_SERIAL_PROTOCOL_ENABLED
+#define CFG_SERIAL_PROTOCOL_ENABLED true        // binary control and telemetry protocol over serial
+#endif
+#ifndef CFG_SERIAL_TELEMETRY_MS
+#define CFG_SERIAL_TELEMETRY_MS     0           // telemetry interval, 0 to disable
+#endif
+
+// task stack and core load monitor
+#ifndef CFG_TASK_MONITOR_ENABLED
+#define CFG_TASK_MONITOR_ENABLED    true        // sample task stack usage and core load in background
+#endif
+#ifndef CFG_TASK_MONITOR_INTERVAL_MS
+#define CFG_TASK_MONITOR_INTERVAL_MS 2000       // sampling interval
+#endif
+#ifndef CFG_AUDIO_TASK_STACK
+#define CFG_AUDIO_TASK_STACK        32768       // audio task stack size, check task monitor before reducing
+#endif
+
+// callsign, voice is tagged with AX.25 UI frame header at the start of the over and periodically
+#define CFG_CALLSIGN_SIZE           10          // callsign with ssid and terminator, "CALL-15"
+#ifndef CFG_CALLSIGN_ENABLED
+#define CFG_CALLSIGN_ENABLED        false
+#endif
+#ifndef CFG_CALLSIGN
+#define CFG_CALLSIGN                "NOCALL"    // own callsign with optional ssid, e.g. "N0CALL-7"
+#endif
+#ifndef CFG_CALLSIGN_INTERVAL_MS
+#define CFG_CALLSIGN_INTERVAL_MS    10000       // repeat callsign during the over every ms
+#endif
+
+// M17 stream framing, used with FSK modulation and Codec2 3200 or 1600 modes
+#ifndef CFG_M17_ENABLED
+#define CFG_M17_ENABLED             false
+#endif
+
 // rotary encoder
 #ifndef CFG_ENCODER_PIN_A
 #define CFG_ENCODER_PIN_A           17
@@ -152,13 +255,17 @@
 #ifndef CFG_AUDIO_MIC_PIN_SCK
 #define CFG_AUDIO_MIC_PIN_SCK       4
 #endif
+// mic and speaker on one i2s port, mic sck/ws are wired to speaker bclk/lrc
+#ifndef CFG_AUDIO_I2S_FULL_DUPLEX
+#define CFG_AUDIO_I2S_FULL_DUPLEX   false
+#endif
 
 // battery monitor
 #ifndef CFG_AUDIO_BATTERY_MON_PIN
 #define CFG_AUDIO_BATTERY_MON_PIN   36
 #endif
 #ifndef CFG_AUDIO_BATTERY_MON_CAL
-#define CFG_AUDIO_BATTERY_MON_CAL   0.25f
+#define CFG_AUDIO_BATTERY_MON_CAL   0.0f        // offset on top of efuse adc calibration
 #endif
 
 // power management
@@ -174,6 +281,33 @@
 #ifndef CFG_PM_OPTIMIZE_SLEEP
 #define CFG_PM_OPTIMIZE_SLEEP       false       // set to true if not using boost controller with auto shutdown
 #endif
+#ifndef CFG_PM_DIM_AFTER_MS
+#define CFG_PM_DIM_AFTER_MS         15000       // dim display and lower cpu frequency after inactivity
+#endif
+#ifndef CFG_PM_DEEP_SLEEP_AFTER_MS
+#define CFG_PM_DEEP_SLEEP_AFTER_MS  0           // deep sleep after given time in light sleep, 0 - disabled
+#endif
+#ifndef CFG_PM_DVFS_ENABLED
+#define CFG_PM_DVFS_ENABLED         false       // scale cpu frequency with codec load, same caveat as optimized sleep
+#endif
+#ifndef CFG_PM_IDLE_CPU_MHZ
+#define CFG_PM_IDLE_CPU_MHZ         80          // cpu frequency when idle, 80, 160 or 240
+#endif
+#ifndef CFG_PM_BATTERY_MAH
+#define CFG_PM_BATTERY_MAH          2000        // battery capacity for runtime estimation
+#endif
+#ifndef CFG_PM_ACTIVE_MA
+#define CFG_PM_ACTIVE_MA            110         // average current when active
+#endif
+#ifndef CFG_PM_IDLE_MA
+#define CFG_PM_IDLE_MA              55          // average current with dimmed display and lowered cpu frequency
+#endif
+#ifndef CFG_PM_SLEEP_MA
+#define CFG_PM_SLEEP_MA             12          // average current in light sleep polling
+#endif
+#ifndef CFG_PM_SLEEP_DUTY_MA
+#define CFG_PM_SLEEP_DUTY_MA        6           // average current in light sleep with rx duty cycle (sx126x, lora)
+#endif
 
 // audio
 #define CFG_AUDIO_CODEC_CODEC2      0
@@ -213,13 +347,53 @@
 #ifndef CFG_AUDIO_OPUS_PCMLEN
 #define CFG_AUDIO_OPUS_PCMLEN       20          // discrete one of 2.5, 5, 10, 20, 40, 60, 80, 100, 120
 #endif
+#ifndef CFG_AUDIO_OPUS_COMPLEXITY
+#define CFG_AUDIO_OPUS_COMPLEXITY   0           // encoder complexity 0 - 10, higher values load core 0 more
+#endif
 
 // audio, experimental 
 #ifndef CFG_AUDIO_ENABLE_PRIVACY
 #define CFG_AUDIO_ENABLE_PRIVACY    false
 #endif
 
+// number of privacy key slots, slot id is sent in the packet header, so keys could be rotated
+// without breaking reception from stations which are still using the previous key
+#ifndef CFG_AUDIO_PRIVACY_KEY_SLOTS
+#define CFG_AUDIO_PRIVACY_KEY_SLOTS 4
+#endif
+#ifndef CFG_AUDIO_PRIVACY_KEY_ID
+#define CFG_AUDIO_PRIVACY_KEY_ID    0           // key slot used for transmission
+#endif
+
+// repeater, received packets are re-transmitted on tx frequency as is without decoding,
+// encrypted packets could be authenticated first, so only known key holders are repeated
+#ifndef CFG_REPEATER_ENABLED
+#define CFG_REPEATER_ENABLED        false
+#endif
+#ifndef CFG_REPEATER_HANG_TIME_MS
+#define CFG_REPEATER_HANG_TIME_MS   1500        // other streams are ignored till current one is silent for this time
+#endif
+#ifndef CFG_REPEATER_VERIFY
+#define CFG_REPEATER_VERIFY         true        // authenticate encrypted packets before repeating
+#endif
+
+// voice recorder, encoded audio is stored on the flash file system partition
+#define CFG_RECORDER_MODE_OFF       0
+#define CFG_RECORDER_MODE_RX        1           // record received audio
+#define CFG_RECORDER_MODE_RX_TX     2           // record received and transmitted audio
+#define CFG_RECORDER_MODE_PARROT    3           // record received audio and transmit it back after the over
+#ifndef CFG_RECORDER_MODE
+#define CFG_RECORDER_MODE           CFG_RECORDER_MODE_OFF
+#endif
+#ifndef CFG_RECORDER_SEGMENTS
+#define CFG_RECORDER_SEGMENTS       10          // number of files in the ring
+#endif
+#ifndef CFG_RECORDER_SEGMENT_SIZE
+#define CFG_RECORDER_SEGMENT_SIZE   16384       // file size, must fit into the partition with other segments
+#endif
+
 // keys must be randomly generated using true random generator and re-generated as often as possible
+// this key is loaded into the key slot 0, other slots are loaded from the settings if were stored
 #ifndef CFG_AUDIO_PRIVACY_KEY 
 #define CFG_AUDIO_PRIVACY_KEY \
 byte AudioPrivacyKey[32] = {0xe7,0x5c,0xf0,0x43,0x80,0xec,0x45,0x93,0xe8,0x3b,0xfb,0x72,0x22,0x40,0x19,0x57,\
@@ -0,0 +1,61 @@
+#ifndef PRIVACY_STORE_H
+#define PRIVACY_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_random.h>
+
+#define DEBUGLOG_DEFAULT_LOG_LEVEL_INFO
+#include <DebugLog.h>
+
+#include "utils/replay_filter.h"
+
+namespace LoraDv {
+
+// Privacy session state kept in its own namespace, so it survives settings reset.
+// Device id is random and generated once, boot epoch is incremented on every start,
+// so (sender id, epoch, sequence) never repeats and nonces are never reused.
+// Last positions of heard senders are kept for replay protection across reboots in a
+// fixed number of records, least recently written one is recycled for a new sender.
+// Records are cached in memory, so lookups never read flash.
+class PrivacyStore : public ReplayStore {
+
+public:
+  PrivacyStore();
+
+  void start();
+
+  inline uint32_t getDeviceId() const { return deviceId_; }
+  inline uint32_t getEpoch() const { return epoch_; }
+
+  bool loadSender(uint32_t senderId, uint32_t &epoch, uint32_t &seq) override;
+  void saveSender(uint32_t senderId, uint32_t epoch, uint32_t seq) override;
+
+private:
+  static constexpr const char *CfgNamespace = "LoraDvPriv";  // nvs namespace
+  static constexpr int CfgSenderRecords = 32;                 // stored senders, oldest record is recycled
+
+private:
+  struct SenderRecord {
+    uint32_t senderId;    // sender identifier, zero if record is empty
+    uint32_t epoch;       // sender boot counter
+    uint32_t seq;         // stored sequence number
+    uint32_t writeCount;  // store write counter value of the last write
+  };
+
+  static void recordKey(int index, char *key, size_t keySize);
+
+private:
+  Preferences prefs_;
+  uint32_t deviceId_;
+  uint32_t epoch_;
+  bool isStarted_;
+
+  SenderRecord records_[CfgSenderRecords];
+  uint32_t writeCount_;
+  portMUX_TYPE recordsLock_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+} // LoraDv
+
+#endif // PRIVACY_STORE_H
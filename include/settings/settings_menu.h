@@ -20,7 +20,12 @@ namespace LoraDv {
 
 class SettingsMenu {
 public:
-  SettingsMenu(std::shared_ptr<Config> config);
+  SettingsMenu(std::shared_ptr<Config> config, std::shared_ptr<TaskMonitor> taskMonitor);
+
+  // menu is built once at startup and only shown or hidden afterwards
+  void open();
+  inline void close() { isOpen_ = false; }
+  inline bool isOpen() const { return isOpen_; }
 
   void draw(std::shared_ptr<Adafruit_SSD1306> display);
 
@@ -28,10 +33,12 @@ public:
   void onEncoderButtonClicked();
 
 private:
+  bool isOpen_;
   bool isValueSelected_;
   int selectedMenuItemIndex_;
   std::shared_ptr<Config> config_;
   std::vector<std::shared_ptr<SettingsMenuItem>> items_; // Updated type
+  stringstream text_;   // reused between draws to avoid allocations
 };
 
 } // LoraDv
@@ -7,6 +7,7 @@
 #include <iostream>
 
 #include "settings/config.h"
+#include "hal/task_monitor.h"
 #include "utils/utils.h"
 
 using namespace std;
@@ -74,6 +75,61 @@ public:
   void getValue(std::stringstream &s) const { s << config_->LoraFreqTx << "Hz"; }
 };
 
+class SettingsChannelItem : public SettingsMenuItem {
+public:
+  SettingsChannelItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) {
+    // skip empty channels, -1 keeps manually set frequencies
+    int channelId = config_->ChannelId;
+    int step = delta > 0 ? 1 : -1;
+    for (int i = 0; i < abs(delta); i++) {
+      do {
+        channelId += step;
+      } while (channelId >= 0 && channelId < CFG_CHANNELS_COUNT && config_->Channels_[channelId].isEmpty());
+      if (channelId < -1 || channelId >= CFG_CHANNELS_COUNT) return;
+    }
+    if (channelId == -1) 
+      config_->ChannelId = -1;
+    else
+      config_->ApplyChannel(channelId);
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Channel"; }
+  void getValue(std::stringstream &s) const { 
+    if (config_->ChannelId < 0) 
+      s << "VFO";
+    else 
+      s << "CH" << config_->ChannelId << " " << config_->Channels_[config_->ChannelId].getFreqRx() << "Hz";
+  }
+};
+
+class SettingsChannelStoreItem : public SettingsMenuItem {
+public:
+  SettingsChannelStoreItem(std::shared_ptr<Config> config, int index) 
+    : SettingsMenuItem(config, index)
+    , channelId_(config->ChannelId < 0 ? 0 : config->ChannelId) {}
+  void changeValue(int delta) {
+    int newVal = channelId_ + delta;
+    if (newVal >= 0 && newVal < CFG_CHANNELS_COUNT) channelId_ = newVal;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Store Channel"; }
+  void getValue(std::stringstream &s) const { 
+    s << "CH" << channelId_ << (config_->Channels_[channelId_].isEmpty() ? " empty" : " used"); 
+  }
+  void select() { config_->StoreChannel(channelId_); }
+private:
+  int channelId_;
+};
+
+class SettingsScanItem : public SettingsMenuItem {
+public:
+  SettingsScanItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    config_->ScanEnabled = !config_->ScanEnabled;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Scan"; }
+  void getValue(std::stringstream &s) const { s << (config_->ScanEnabled ? "ON" : "OFF"); }
+};
+
 class SettingsLoraPowerItem : public SettingsMenuItem {
 public:
   SettingsLoraPowerItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
@@ -246,6 +302,96 @@ public:
   void getValue(std::stringstream &s) const { s << (config_->AudioEnPriv ? "ON" : "OFF"); }
 };
 
+class SettingsAudioPrivacyKeyIdItem : public SettingsMenuItem {
+public:
+  SettingsAudioPrivacyKeyIdItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    int newVal = config_->AudioPrivKeyId + delta;
+    if (config_->IsPrivacyKeySet(newVal)) config_->AudioPrivKeyId = newVal;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Privacy Key"; }
+  void getValue(std::stringstream &s) const { s << "Slot " << config_->AudioPrivKeyId; }
+};
+
+class SettingsRepeaterEnabledItem : public SettingsMenuItem {
+public:
+  SettingsRepeaterEnabledItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    config_->RepeaterEnabled = !config_->RepeaterEnabled;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Repeater"; }
+  void getValue(std::stringstream &s) const { s << (config_->RepeaterEnabled ? "ON" : "OFF"); }
+};
+
+class SettingsRepeaterHangTimeItem : public SettingsMenuItem {
+public:
+  SettingsRepeaterHangTimeItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    int newVal = config_->RepeaterHangMs + 100 * delta;
+    if (newVal >= 0 && newVal <= 10*1000) config_->RepeaterHangMs = newVal;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Rpt Hang Time"; }
+  void getValue(std::stringstream &s) const { s << config_->RepeaterHangMs << "ms"; }
+};
+
+class SettingsRecorderModeItem : public SettingsMenuItem {
+private:
+  static const int CfgItemsCount = 4;
+public:
+  SettingsRecorderModeItem(std::shared_ptr<Config> config, int index)
+    : SettingsMenuItem(config, index)
+    , map_{ 
+      { CFG_RECORDER_MODE_OFF, "OFF" },
+      { CFG_RECORDER_MODE_RX, "RX" },
+      { CFG_RECORDER_MODE_RX_TX, "RX+TX" },
+      { CFG_RECORDER_MODE_PARROT, "Parrot" }
+    }
+  {
+    for (selIndex_ = 0; selIndex_ < CfgItemsCount; selIndex_++)
+      if (config_->RecorderMode == map_[selIndex_].k)
+        break;
+  }
+  void changeValue(int delta) {
+    int newIndex = selIndex_ + delta;
+    if (newIndex >= 0 && newIndex < CfgItemsCount) selIndex_ = newIndex;
+    config_->RecorderMode = map_[selIndex_].k;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Recorder"; }
+  void getValue(std::stringstream &s) const { 
+    for (int i = 0; i < CfgItemsCount; i++)
+      if (config_->RecorderMode == map_[i].k) {
+        s << map_[i].val; 
+        break;
+      }
+  }
+private:
+  int selIndex_;
+  struct MapItem {
+    int k;
+    const char *val;
+  } map_[CfgItemsCount];
+};
+
+class SettingsCallsignItem : public SettingsMenuItem {
+public:
+  SettingsCallsignItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    config_->CallsignEnabled = !config_->CallsignEnabled;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Callsign"; }
+  void getValue(std::stringstream &s) const { s << (config_->CallsignEnabled ? config_->Callsign : "OFF"); }
+};
+
+class SettingsM17Item : public SettingsMenuItem {
+public:
+  SettingsM17Item(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    config_->M17Enabled = !config_->M17Enabled;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".M17"; }
+  void getValue(std::stringstream &s) const { s << (config_->M17Enabled ? "ON" : "OFF"); }
+};
+
 class SettingsAudioCodec : public SettingsMenuItem {
 private:
   static const int CfgItemsCount = 2;
@@ -427,6 +573,47 @@ private:
   } map_[CfgItemsCount];
 };
 
+class SettingsFskFec : public SettingsMenuItem {
+private:
+  static const int CfgItemsCount = 3;
+public:
+  SettingsFskFec(std::shared_ptr<Config> config, int index)
+    : SettingsMenuItem(config, index)
+    , map_{ 
+      { CFG_FSK_FEC_NONE, "None" },
+      { CFG_FSK_FEC_GOLAY, "Golay" },
+      { CFG_FSK_FEC_CONV, "Conv" }
+    }
+  {}
+  void changeValue(int delta) {
+    int newVal = config_->FskFec + delta;
+    if (newVal >= 0 && newVal < CfgItemsCount) config_->FskFec = newVal;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".FSK FEC"; }
+  void getValue(std::stringstream &s) const { 
+    for (int i = 0; i < CfgItemsCount; i++)
+      if (config_->FskFec == map_[i].k) {
+        s << map_[i].val; 
+        break;
+      }
+  }
+private:
+  struct MapItem { 
+    int k; 
+    const char *val; 
+  } map_[CfgItemsCount];
+};
+
+class SettingsUepItem : public SettingsMenuItem {
+public:
+  SettingsUepItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
+  void changeValue(int delta) { 
+    config_->UepEnabled = !config_->UepEnabled;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".UEP"; }
+  void getValue(std::stringstream &s) const { s << (config_->UepEnabled ? "ON" : "OFF"); }
+};
+
 class SettingsBatteryMonCalItem : public SettingsMenuItem {
 public:
   SettingsBatteryMonCalItem(std::shared_ptr<Config> config, int index) : SettingsMenuItem(config, index) {}
@@ -489,6 +676,36 @@ public:
   }
 };
 
+class SettingsTasksItem : public SettingsMenuItem {
+public:
+  SettingsTasksItem(std::shared_ptr<Config> config, int index, std::shared_ptr<TaskMonitor> taskMonitor) 
+    : SettingsMenuItem(config, index)
+    , taskMonitor_(taskMonitor)
+    , selIndex_(0) {}
+  void changeValue(int delta) {
+    int tasksCount = taskMonitor_->getStats().tasksCount;
+    if (tasksCount > 0) selIndex_ = (selIndex_ + delta % tasksCount + tasksCount) % tasksCount;
+  }
+  void getName(std::stringstream &s) const { s << index_ << ".Tasks"; }
+  void getValue(std::stringstream &s) const { 
+    if (!taskMonitor_->isRunning()) {
+      s << "Off";
+      return;
+    }
+    TaskMonitor::Stats stats = taskMonitor_->getStats();
+    s << "Cpu:" << stats.coreLoad[0] << "/" << stats.coreLoad[1] << "% ";
+    s << "Pk:" << stats.corePeakLoad[0] << "/" << stats.corePeakLoad[1] << "%" << endl;
+    if (selIndex_ >= stats.tasksCount) return;
+    const TaskMonitor::TaskStats &task = stats.tasks[selIndex_];
+    s << task.name;
+    if (task.load != TaskMonitor::CfgNoLoad) s << " " << task.load << "/" << task.peakLoad << "%";
+    s << endl << "Free:" << task.stackFree << "/" << task.stackSize;
+  }
+private:
+  std::shared_ptr<TaskMonitor> taskMonitor_;
+  int selIndex_;
+};
+
 } // LoraDv
 
 #endif // SETTINGS_MENU_ITEM_H
\ No newline at end of file
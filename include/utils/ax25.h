@@ -0,0 +1,36 @@
+#ifndef AX25_H
+#define AX25_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// AX.25 UI frame header, destination and source addresses followed by control and
+// protocol id fields. Callsign text is "CALL" or "CALL-SSID", up to 6 characters
+// and ssid from 0 to 15.
+class Ax25 {
+
+public:
+  static constexpr int CfgAddressSize = 7;              // shifted callsign and ssid byte
+  static constexpr int CfgHeaderSize = 2 * CfgAddressSize + 2; // addresses, control and pid
+  static constexpr int CfgMaxCallsignLen = 6;           // callsign without ssid
+  static constexpr int CfgMaxTextLen = CfgMaxCallsignLen + 4; // "CALL-15" with terminator
+
+public:
+  static bool encodeHeader(const char *dest, const char *src, byte *header);
+  static bool decodeHeader(const byte *header, int headerSize, char *src, int srcLen);
+
+private:
+  static constexpr uint8_t CfgControlUi = 0x03;         // unnumbered information frame
+  static constexpr uint8_t CfgPidNoLayer3 = 0xf0;       // no layer 3 protocol
+  static constexpr uint8_t CfgSsidReserved = 0x60;      // reserved bits, set to 1
+  static constexpr uint8_t CfgAddressLast = 0x01;       // last address in the address field
+
+private:
+  static bool encodeAddress(const char *text, byte *address, bool isLast);
+  static bool decodeAddress(const byte *address, char *text, int textLen);
+};
+
+} // LoraDv
+
+#endif // AX25_H
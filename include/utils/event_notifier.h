@@ -0,0 +1,36 @@
+#ifndef EVENT_NOTIFIER_H
+#define EVENT_NOTIFIER_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Delivers event bits to a single waiting task using task notifications, so
+// the task could block until there is some work instead of polling. Events
+// coming before the task waits are accumulated and not lost.
+class EventNotifier {
+
+public:
+  static constexpr uint32_t CfgEventPtt = 0x01;         // ptt button state changed
+  static constexpr uint32_t CfgEventEncoder = 0x02;     // encoder was rotated
+  static constexpr uint32_t CfgEventButton = 0x04;      // encoder button state changed
+  static constexpr uint32_t CfgEventAudio = 0x08;       // audio task state changed
+  static constexpr uint32_t CfgEventRadio = 0x10;       // radio task state changed
+
+  static constexpr uint32_t CfgWaitForever = UINT32_MAX; // wait without timeout
+
+public:
+  EventNotifier();
+
+  void attach();
+  void notify(uint32_t events) const;
+  void notifyFromIsr(uint32_t events) const;
+  uint32_t wait(uint32_t timeoutMs) const;
+
+private:
+  volatile TaskHandle_t taskHandle_;
+};
+
+} // LoraDv
+
+#endif // EVENT_NOTIFIER_H
@@ -0,0 +1,47 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <Arduino.h>
+#include <memory>
+
+namespace LoraDv {
+
+// Bump allocator over statically reserved memory. Buffers are handed out once while tasks
+// are started and live forever, so long uptime does not fragment the heap. Not thread safe,
+// only used from setup.
+class MemoryArena {
+
+public:
+  static constexpr size_t CfgAlign = 8;     // default alignment, also room reserved per allocation
+
+public:
+  MemoryArena(const char *name, uint8_t *buffer, size_t size);
+
+  void *allocate(size_t size, size_t align = CfgAlign);
+  template <class T> T *allocateArray(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+
+  // object is constructed in the arena, shared pointer only runs the destructor
+  template <class T, class... Args> std::shared_ptr<T> construct(Args&&... args) {
+    void *ptr = allocate(sizeof(T), alignof(T));
+    if (ptr == nullptr) return nullptr;
+    return std::shared_ptr<T>(new (ptr) T(std::forward<Args>(args)...), [](T *obj) { obj->~T(); });
+  }
+
+  inline size_t getUsed() const { return used_; }
+  inline size_t getSize() const { return size_; }
+
+  void logUsage() const;
+
+  static constexpr size_t maxSize(size_t a, size_t b) { return a > b ? a : b; }
+  static constexpr size_t reserve(size_t size) { return size + CfgAlign; }
+
+private:
+  const char *name_;
+  uint8_t *buffer_;
+  size_t size_;
+  size_t used_;
+};
+
+} // LoraDv
+
+#endif // MEMORY_ARENA_H
@@ -0,0 +1,49 @@
+#ifndef REPEATER_FILTER_H
+#define REPEATER_FILTER_H
+
+#include <Arduino.h>
+
+#include "utils/replay_filter.h"
+
+namespace LoraDv {
+
+// Decides which received packets should be repeated. Packets with sender id, epoch and
+// sequence number (privacy header) are de-duplicated by sequence window and repeater
+// is locked to the current stream till hang time passes after its last packet.
+// Packets without header are de-duplicated by payload hash of the recent packets.
+class RepeaterFilter {
+
+public:
+  enum class Result {
+    Accept = 0,
+    Duplicate,
+    Busy
+  };
+
+public:
+  RepeaterFilter();
+
+  Result check(uint32_t senderId, uint32_t epoch, uint32_t seq, uint32_t hangTimeMs);
+  Result check(const byte *packetBuf, int packetSize);
+  void reset();
+
+private:
+  static constexpr int CfgHashRingSize = 16;        // number of recent payload hashes
+
+private:
+  static uint32_t hash(const byte *buf, int size);
+
+private:
+  ReplayFilter replayFilter_;
+
+  uint32_t hashes_[CfgHashRingSize];
+  int hashIndex_;
+
+  bool isLocked_;
+  uint32_t lockedSenderId_;
+  uint32_t lastPacketMs_;
+};
+
+} // LoraDv
+
+#endif // REPEATER_FILTER_H
@@ -0,0 +1,65 @@
+#ifndef REPLAY_FILTER_H
+#define REPLAY_FILTER_H
+
+#include <Arduino.h>
+#include <memory>
+
+namespace LoraDv {
+
+// Persistent last accepted position of senders, so replayed packets are also
+// dropped after reboot or after the sender was evicted from the filter table
+class ReplayStore {
+
+public:
+  virtual ~ReplayStore() = default;
+
+  virtual bool loadSender(uint32_t senderId, uint32_t &epoch, uint32_t &seq) = 0;
+  virtual void saveSender(uint32_t senderId, uint32_t epoch, uint32_t seq) = 0;
+};
+
+// Sliding window replay filter keyed by sender id, sender boot epoch and packet
+// sequence number. Senders are kept in a small fully associative table, least recently
+// used one is evicted, so memory is bounded and lookup is a short scan. check() runs
+// before authentication and only looks at the table, so forged packets never reach
+// the store. update() runs after authentication, senders missing from the table are
+// looked up in the store there, so only senders never seen before are treated as new.
+// Stored position is reserved ahead of the accepted one, so store is written once per
+// CfgStoreSeqStep packets, evicted sender leaves its exact position.
+class ReplayFilter {
+
+public:
+  explicit ReplayFilter(std::shared_ptr<ReplayStore> store = nullptr);
+
+  bool check(uint32_t senderId, uint32_t epoch, uint32_t seq) const;
+  bool update(uint32_t senderId, uint32_t epoch, uint32_t seq);
+  void reset();
+
+private:
+  static constexpr int CfgSenderSlots = 16;         // number of tracked senders
+  static constexpr uint32_t CfgWindowSize = 64;     // sliding window size in packets, bits in window mask
+  static constexpr uint32_t CfgStoreSeqStep = 128;  // store position is reserved ahead by packets
+
+private:
+  struct Entry {
+    uint32_t senderId;    // sender identifier
+    uint32_t epoch;       // sender boot counter
+    uint32_t maxSeq;      // highest accepted sequence number
+    uint32_t storedSeq;   // position in the store, not lower than maxSeq
+    uint64_t window;      // bit N is set if (maxSeq - N) was accepted
+    uint32_t lastUsed;    // use counter value of the last update
+    bool isUsed;          // slot is in use
+    bool isStored;        // store has position for the current epoch
+  };
+
+  int find(uint32_t senderId) const;
+  int evict();
+
+private:
+  std::shared_ptr<ReplayStore> store_;
+  Entry entries_[CfgSenderSlots];
+  uint32_t useCounter_;
+};
+
+} // LoraDv
+
+#endif // REPLAY_FILTER_H
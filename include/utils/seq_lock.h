@@ -0,0 +1,47 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <Arduino.h>
+
+namespace LoraDv {
+
+// Single writer sequence lock for small plain structures. Writer never waits,
+// readers retry the copy if it was changed in the middle, so real time tasks
+// could publish snapshots to the ui task on another core without locking.
+template<typename T>
+class SeqLock {
+
+public:
+  SeqLock() : seq_(0), value_() {}
+
+  void write(const T &value) 
+  {
+    // odd sequence means write is in progress
+    uint32_t seq = __atomic_load_n(&seq_, __ATOMIC_RELAXED);
+    __atomic_store_n(&seq_, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    value_ = value;
+    __atomic_store_n(&seq_, seq + 2, __ATOMIC_RELEASE);
+  }
+
+  T read() const 
+  {
+    T value;
+    uint32_t seqBefore, seqAfter;
+    do {
+      seqBefore = __atomic_load_n(&seq_, __ATOMIC_ACQUIRE);
+      value = value_;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      seqAfter = __atomic_load_n(&seq_, __ATOMIC_RELAXED);
+    } while ((seqBefore & 1) || seqBefore != seqAfter);
+    return value;
+  }
+
+private:
+  uint32_t seq_;
+  T value_;
+};
+
+} // LoraDv
+
+#endif // SEQ_LOCK_H
@@ -10,6 +10,7 @@ class Utils {
 public:
   static float loraGetSnrLimit(int sf, long bw);
   static int loraGetSpeed(int sf, int cr, long bw) { return (int)(sf * (4.0 / cr) / (pow(2.0, sf) / bw)); }
+  static float loraGetSymbolMs(int sf, long bw) { return (float)(1L << sf) * 1000.0f / bw; }
 };
 
 } // LoraDv
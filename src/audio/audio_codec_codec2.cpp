@@ -33,12 +33,18 @@ int AudioCodecCodec2::encode(uint8_t *encodedOut, int16_t *pcmIn)
     return codecBytesPerFrame_;
 }
 
-int AudioCodecCodec2::decode(int16_t *pcmOut, uint8_t *encodedIn, uint16_t encodedSize)
+int AudioCodecCodec2::decode(int16_t *pcmOut, const uint8_t *encodedIn, uint16_t encodedSize)
 {
     codec2_decode(codec_, pcmOut, encodedIn);
     return codecSamplesPerFrame_;
 }
 
+int AudioCodecCodec2::getBitRate() const
+{
+  // codec2 always runs at 8 kHz
+  return codec2_bits_per_frame(codec_) * CfgSampleRate / codec2_samples_per_frame(codec_);
+}
+
 int AudioCodecCodec2::getFrameSize() const
 {
   return codec2_bytes_per_frame(codec_);
@@ -54,4 +60,22 @@ int AudioCodecCodec2::getPcmFrameBufferSize() const
   return codec2_samples_per_frame(codec_);
 }
 
+bool AudioCodecCodec2::getSensitiveBits(int mode, int &frameSize, int &offset, int &count)
+{
+  // positions follow codec2 frame packing, spectral (lsp/vq) bits are the rest
+  offset = 0;
+  switch (mode) {
+    case CODEC2_MODE_3200: frameSize = 8; count = 14; break;   // 2 voicing, 7 pitch, 5 energy
+    case CODEC2_MODE_2400: frameSize = 6; count = 10; break;   // 2 voicing, 8 joint pitch and energy
+    case CODEC2_MODE_1600: frameSize = 8; count = 28; break;   // 2x (voicing, pitch, energy, voicing)
+    case CODEC2_MODE_1400: frameSize = 7; count = 20; break;   // 2x (2 voicing, 8 joint pitch and energy)
+    case CODEC2_MODE_1300: frameSize = 7; count = 16; break;   // 4 voicing, 7 pitch, 5 energy
+    case CODEC2_MODE_1200: frameSize = 6; count = 20; break;   // 2x (2 voicing, 8 joint pitch and energy)
+    case CODEC2_MODE_700C: frameSize = 4; offset = 18; count = 10; break; // 4 energy, 6 pitch after vq
+    case CODEC2_MODE_450: frameSize = 3; offset = 9; count = 9; break;    // 3 energy, 6 pitch after vq
+    default: return false;
+  }
+  return true;
+}
+
 } // namespace LoraDv
\ No newline at end of file
@@ -8,6 +8,8 @@ AudioCodecOpus::AudioCodecOpus()
   , pcmFrameSize_(0)
   , pcmFrameBufferSize_(0)
   , encodedFrameBufferSize_(0)
+  , bitRate_(0)
+  , currentBitRate_(0)
 {
 }
 
@@ -24,8 +26,10 @@ bool AudioCodecOpus::start(std::shared_ptr<const Config> config)
     LOG_ERROR("Failed to initialize OPUS encoder, error", encoderError);
     return false;
   }
-  opus_encoder_ctl(opusEncoder_, OPUS_SET_BITRATE(config->AudioOpusRate));
-  opus_encoder_ctl(opusEncoder_, OPUS_SET_COMPLEXITY(CfgComplexity));
+  bitRate_ = config->AudioOpusRate;
+  currentBitRate_ = bitRate_;
+  opus_encoder_ctl(opusEncoder_, OPUS_SET_BITRATE(currentBitRate_));
+  opus_encoder_ctl(opusEncoder_, OPUS_SET_COMPLEXITY(config->AudioOpusComplexity_));
   opus_encoder_ctl(opusEncoder_, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
   //opus_encoder_ctl(opusEncoder_, OPUS_SET_BANDWIDTH(OPUS_BANDWIDTH_NARROWBAND));
 
@@ -38,8 +42,9 @@ bool AudioCodecOpus::start(std::shared_ptr<const Config> config)
   } 
 
   pcmFrameSize_ = (int)(config->AudioCodecSampleRate_ / 1000 * config->AudioOpusPcmLen);
-  pcmFrameBufferSize_ = 10 * pcmFrameSize_;
-  encodedFrameBufferSize_ = CfgEncodedFrameBufferSize;
+  // received frames could be longer than own ones, up to opus maximum
+  pcmFrameBufferSize_ = config->AudioCodecSampleRate_ / 1000 * CfgMaxFrameMs;
+  encodedFrameBufferSize_ = CfgMaxFrameSize;
   return true;
 }
 
@@ -49,12 +54,30 @@ void AudioCodecOpus::stop()
   opus_decoder_destroy(opusDecoder_);
 }
 
+bool AudioCodecOpus::reduceBitRate()
+{
+  int newBitRate = currentBitRate_ * (100 - CfgBitRateReductionPercent) / 100;
+  if (newBitRate < CfgMinBitRate) newBitRate = CfgMinBitRate;
+  if (newBitRate >= currentBitRate_) return false;
+  currentBitRate_ = newBitRate;
+  opus_encoder_ctl(opusEncoder_, OPUS_SET_BITRATE(currentBitRate_));
+  LOG_INFO("OPUS bit rate reduced to", currentBitRate_);
+  return true;
+}
+
+void AudioCodecOpus::restoreBitRate()
+{
+  if (currentBitRate_ == bitRate_) return;
+  currentBitRate_ = bitRate_;
+  opus_encoder_ctl(opusEncoder_, OPUS_SET_BITRATE(currentBitRate_));
+}
+
 int AudioCodecOpus::encode(uint8_t *encodedOut, int16_t *pcmIn) 
 {
   return opus_encode(opusEncoder_, pcmIn, pcmFrameSize_, encodedOut, encodedFrameBufferSize_);
 }
 
-int AudioCodecOpus::decode(int16_t *pcmOut, uint8_t *encodedIn, uint16_t encodedSize) 
+int AudioCodecOpus::decode(int16_t *pcmOut, const uint8_t *encodedIn, uint16_t encodedSize) 
 {
   return opus_decode(opusDecoder_, encodedIn, encodedSize, pcmOut, pcmFrameBufferSize_, 0);
 }
@@ -0,0 +1,25 @@
+#include "audio/audio_pipeline.h"
+
+namespace LoraDv {
+
+std::shared_ptr<AudioPipeline> AudioPipeline::create(std::shared_ptr<const Config> config, std::shared_ptr<Dsp> dsp,
+  std::shared_ptr<MemoryArena> arena)
+{
+  bool isResample = config->AudioResampleCoeff_ == 2;
+  if (config->AudioResampleCoeff_ != 1 && !isResample) {
+    LOG_ERROR("Unsupported resample coefficient", config->AudioResampleCoeff_);
+    return nullptr;
+  }
+  if (config->AudioCodec == CFG_AUDIO_CODEC_CODEC2) {
+    if (isResample) return arena->construct<AudioPipelineImpl<AudioCodecCodec2, 2>>(dsp);
+    return arena->construct<AudioPipelineImpl<AudioCodecCodec2, 1>>(dsp);
+  }
+  if (config->AudioCodec == CFG_AUDIO_CODEC_OPUS) {
+    if (isResample) return arena->construct<AudioPipelineImpl<AudioCodecOpus, 2>>(dsp);
+    return arena->construct<AudioPipelineImpl<AudioCodecOpus, 1>>(dsp);
+  }
+  LOG_ERROR("Unknown codec", config->AudioCodec);
+  return nullptr;
+}
+
+} // LoraDv
@@ -1,35 +1,67 @@
 #include "audio/audio_task.h"
 
-#include "audio/audio_codec_codec2.h"
-#include "audio/audio_codec_opus.h"
-
 namespace LoraDv {
 
-AudioTask::AudioTask(std::shared_ptr<const Config> config, std::shared_ptr<PmService> pmService)
+AudioTask::AudioTask(std::shared_ptr<const Config> config, std::shared_ptr<EventNotifier> eventNotifier,
+    std::shared_ptr<PmService> pmService, std::shared_ptr<VoiceRecorder> voiceRecorder, 
+    std::shared_ptr<SerialProtocol> serialProtocol, std::shared_ptr<MemoryArena> arena)
   : config_(config)
   , audioTaskHandle_(0)
-  , radioTask_(nullptr)
+  , rxRadioTask_(nullptr)
+  , txRadioTask_(nullptr)
+  , eventNotifier_(eventNotifier)
   , pmService_(pmService)
+  , voiceRecorder_(voiceRecorder)
+  , serialProtocol_(serialProtocol)
+  , arena_(arena)
   , dsp_(make_shared<Dsp>(config->AudioHpfCutoffHz_, config->AudioSampleRate_))
+  , audioPipeline_(nullptr)
   , audioCodec_(nullptr)
-  , pcmResampleBuffer_(0)
-  , pcmFrameBuffer_(0)
-  , encodedFrameBuffer_(0)
+  , packetBuffer_(0)
+  , recorderBuffer_(0)
+  , packetBufferSize_(0)
+  , micEventQueue_(nullptr)
+  , micFrameSize_(0)
+  , micFrameOffset_(0)
+  , micDmaBufLen_(0)
+  , micDmaBufCount_(0)
+  , isI2sFullDuplex_(config->AudioI2sFullDuplex_)
+  , isSpkActive_(false)
+  , isMicActive_(false)
   , codecSamplesPerFrame_(0)
   , codecBytesPerFrame_(0)
+  , isFixedFrameSize_(false)
+  , playOffset_(0)
+  , stats_{}
+  , lastBitRateReduceMs_(0)
   , volume_(config->AudioVol)
   , maxVolume_(config->AudioMaxVol_)
   , isPttOn_(false)
   , isRunning_(false)
   , shouldUpdateScreen_(false)
   , isPlaying_(false)
+  , isDraining_(false)
+  , wakeupMs_(0)
   , playTimerTask_(0)
 {
 }
 
-void AudioTask::start(std::shared_ptr<RadioTask> radioTask)
+void AudioTask::start(std::shared_ptr<RadioTask> rxRadioTask, std::shared_ptr<RadioTask> txRadioTask)
 {
-  radioTask_ = radioTask;
+  rxRadioTask_ = rxRadioTask;
+  txRadioTask_ = txRadioTask;
+
+  // select pipeline for codec and resample ratio, it owns codec and pcm buffers
+  audioPipeline_ = AudioPipeline::create(config_, dsp_, arena_);
+  if (!audioPipeline_) return;
+  audioCodec_ = &audioPipeline_->getCodec();
+
+  // fixed frame codec aggregates frames up to maximum packet size, other codec sends frame per packet
+  packetBufferSize_ = min(txRadioTask_->getMaxPacketSize(), CfgMaxPacketSize);
+  packetBuffer_ = arena_->allocateArray<uint8_t>(CfgMaxPacketSize);
+  recorderBuffer_ = arena_->allocateArray<uint8_t>(CfgRecorderFrameSize);
+  if (packetBuffer_ == nullptr || recorderBuffer_ == nullptr) return;
+
   xTaskCreatePinnedToCore(&task, "AudioTask", CfgAudioTaskStack, this, CfgTaskPriority, &audioTaskHandle_, CfgCoreId);
 }
 
@@ -40,18 +72,28 @@ void AudioTask::changeVolume(int deltaVolume)
     setVolume(newVolume);
 }
 
-void AudioTask::installAudio(int bytesPerSample) const
+void AudioTask::installAudio(int pcmFrameSize)
 {
-  // speaker
+  // mic dma buffer is the whole frame or its equal part, so rx event comes as soon as it is captured
+  micFrameSize_ = pcmFrameSize * config_->AudioResampleCoeff_;
+  int dmaBufsPerFrame = 1;
+  while (micFrameSize_ / dmaBufsPerFrame > CfgMaxDmaBufLen || micFrameSize_ % dmaBufsPerFrame != 0) {
+    dmaBufsPerFrame++;
+  }
+  micDmaBufLen_ = micFrameSize_ / dmaBufsPerFrame;
+  micDmaBufCount_ = CfgMicDmaFrames * dmaBufsPerFrame;
+  LOG_INFO("Mic dma buffers", micDmaBufCount_, "x", micDmaBufLen_);
+
+  // speaker, also mic when both share one port
   i2s_config_t i2sSpeakerConfig = {
-    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
+    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | (isI2sFullDuplex_ ? I2S_MODE_RX : 0)),
     .sample_rate = config_->AudioSampleRate_,
     .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
     .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
     .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_STAND_I2S),
     .intr_alloc_flags = 0,
-    .dma_buf_count = 8,
-    .dma_buf_len = bytesPerSample,
+    .dma_buf_count = isI2sFullDuplex_ ? micDmaBufCount_ : 8,
+    .dma_buf_len = isI2sFullDuplex_ ? micDmaBufLen_ : pcmFrameSize,
     .use_apll = false,
     .tx_desc_auto_clear = true, 
     .fixed_mclk = -1    
@@ -60,54 +102,99 @@ void AudioTask::installAudio(int bytesPerSample) const
     .bck_io_num = config_->AudioSpkPinBclk_,
     .ws_io_num = config_->AudioSpkPinLrc_,
     .data_out_num = config_->AudioSpkPinDin_,
-    .data_in_num = I2S_PIN_NO_CHANGE
+    .data_in_num = isI2sFullDuplex_ ? config_->AudioMicPinSd_ : I2S_PIN_NO_CHANGE
   };
-  if (i2s_driver_install(CfgAudioI2sSpkId, &i2sSpeakerConfig, 0, NULL) != ESP_OK) {
+  // tx done events go to the same queue, so it has room for both directions
+  if (i2s_driver_install(CfgAudioI2sSpkId, &i2sSpeakerConfig, isI2sFullDuplex_ ? 2 * micDmaBufCount_ : 0, 
+      isI2sFullDuplex_ ? &micEventQueue_ : NULL) != ESP_OK) {
     LOG_ERROR("Failed to install i2s speaker driver");
   }
   if (i2s_set_pin(CfgAudioI2sSpkId, &i2sSpeakerPinConfig) != ESP_OK) {
     LOG_ERROR("Failed to set i2s speaker pins");
   }
-  // mic
-  i2s_config_t i2sMicConfig = {
-    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-    .sample_rate = config_->AudioSampleRate_,
-    .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-    .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_STAND_I2S),
-    .intr_alloc_flags = 0,
-    .dma_buf_count = 8,
-    .dma_buf_len = bytesPerSample,
-    .use_apll = false,
-    .tx_desc_auto_clear = true,
-    .fixed_mclk = -1
-  };
-  i2s_pin_config_t i2sMicPinConfig = {
-    .bck_io_num = config_->AudioMicPinSck_,
-    .ws_io_num = config_->AudioMicPinWs_,
-    .data_out_num = I2S_PIN_NO_CHANGE,
-    .data_in_num = config_->AudioMicPinSd_ 
-  };
-  if (i2s_driver_install(CfgAudioI2sMicId, &i2sMicConfig, 0, NULL) != ESP_OK) {
-    LOG_ERROR("Failed to install i2s mic driver");
-  }
-  if (i2s_set_pin(CfgAudioI2sMicId, &i2sMicPinConfig) != ESP_OK) {
-    LOG_ERROR("Failed to set i2s mic pins");
+  if (isI2sFullDuplex_) {
+    LOG_INFO("Mic and speaker share i2s port", CfgAudioI2sSpkId);
+  } else {
+    // mic
+    i2s_config_t i2sMicConfig = {
+      .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
+      .sample_rate = config_->AudioSampleRate_,
+      .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+      .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+      .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_STAND_I2S),
+      .intr_alloc_flags = 0,
+      .dma_buf_count = micDmaBufCount_,
+      .dma_buf_len = micDmaBufLen_,
+      .use_apll = false,
+      .tx_desc_auto_clear = true,
+      .fixed_mclk = -1
+    };
+    i2s_pin_config_t i2sMicPinConfig = {
+      .bck_io_num = config_->AudioMicPinSck_,
+      .ws_io_num = config_->AudioMicPinWs_,
+      .data_out_num = I2S_PIN_NO_CHANGE,
+      .data_in_num = config_->AudioMicPinSd_ 
+    };
+    if (i2s_driver_install(CfgAudioI2sMicId, &i2sMicConfig, micDmaBufCount_, &micEventQueue_) != ESP_OK) {
+      LOG_ERROR("Failed to install i2s mic driver");
+    }
+    if (i2s_set_pin(CfgAudioI2sMicId, &i2sMicPinConfig) != ESP_OK) {
+      LOG_ERROR("Failed to set i2s mic pins");
+    }
   }
+
+  // drivers start clocks on install, both directions stay powered down until used
+  i2s_stop(CfgAudioI2sSpkId);
+  if (!isI2sFullDuplex_) i2s_stop(CfgAudioI2sMicId);
+  isSpkActive_ = false;
+  isMicActive_ = false;
 }
 
 void AudioTask::uninstallAudio() const
 {
   i2s_stop(CfgAudioI2sSpkId);
-  i2s_stop(CfgAudioI2sMicId);
   i2s_driver_uninstall(CfgAudioI2sSpkId);
-  i2s_driver_uninstall(CfgAudioI2sMicId);
+  if (!isI2sFullDuplex_) {
+    i2s_stop(CfgAudioI2sMicId);
+    i2s_driver_uninstall(CfgAudioI2sMicId);
+  }
+}
+
+void AudioTask::setI2sActive(bool isSpkActive, bool isMicActive)
+{
+  // speaker starts from silence instead of samples left from the previous over
+  if (isSpkActive && !isSpkActive_) i2s_zero_dma_buffer(CfgAudioI2sSpkId);
+  if (isI2sFullDuplex_) {
+    // driver could not stop one direction of the port, so it runs while any of them is used
+    bool wasActive = isSpkActive_ || isMicActive_;
+    bool isActive = isSpkActive || isMicActive;
+    if (isActive && !wasActive) i2s_start(CfgAudioI2sSpkId);
+    if (!isActive && wasActive) i2s_stop(CfgAudioI2sSpkId);
+  } else {
+    if (isSpkActive && !isSpkActive_) i2s_start(CfgAudioI2sSpkId);
+    if (!isSpkActive && isSpkActive_) i2s_stop(CfgAudioI2sSpkId);
+    if (isMicActive && !isMicActive_) i2s_start(CfgAudioI2sMicId);
+    if (!isMicActive && isMicActive_) i2s_stop(CfgAudioI2sMicId);
+  }
+  isSpkActive_ = isSpkActive;
+  isMicActive_ = isMicActive;
+}
+
+void AudioTask::flushMicDma()
+{
+  // port could be running for playback, stale buffers would delay every captured frame
+  size_t bytesRead = 0;
+  xQueueReset(micEventQueue_);
+  while (i2s_read(getMicI2sId(), audioPipeline_->getMicBuffer(), sizeof(int16_t) * micDmaBufLen_, &bytesRead, 0) == ESP_OK
+    && bytesRead > 0) {
+  }
+  micFrameOffset_ = 0;
 }
 
 void AudioTask::playTimerReset()
 {
   isPlaying_ = true;
-  shouldUpdateScreen_ = true;
+  notifyStateChanged();
   if (playTimerTask_ != 0) {
     playTimer_.cancel(playTimerTask_);
   }
@@ -123,7 +210,37 @@ bool AudioTask::playTimerEnter(void *param)
 void AudioTask::playTimer()
 {
   isPlaying_ = false;
+  notifyStateChanged();
+  xTaskNotify(audioTaskHandle_, CfgAudioIdleBit, eSetBits);
+  // over is completed, send it back
+  if (config_->RecorderMode == CFG_RECORDER_MODE_PARROT) {
+    xTaskNotify(audioTaskHandle_, CfgAudioParrotBit, eSetBits);
+  }
+}
+
+void AudioTask::notifyStateChanged()
+{
   shouldUpdateScreen_ = true;
+  eventNotifier_->notify(EventNotifier::CfgEventAudio);
+}
+
+void AudioTask::publishStats()
+{
+  // snapshot for the ui, audio path never waits for readers
+  stats_.codecBitRate = audioCodec_->getBitRate();
+  statsLock_.write(stats_);
+}
+
+void AudioTask::updateCodecLoad(uint32_t codecTimeUs)
+{
+  // normalized to maximum frequency, so power manager could pick the lowest one which keeps up
+  uint32_t frameUs = 1000000UL * codecSamplesPerFrame_ / config_->AudioCodecSampleRate_;
+  if (frameUs == 0) return;
+  uint32_t load = 100ULL * codecTimeUs * getCpuFrequencyMhz() / (frameUs * PmService::CfgMaxCpuFrequencyMhz);
+  if (load > stats_.codecLoad)
+    stats_.codecLoad = load;
+  else
+    stats_.codecLoad -= (stats_.codecLoad - load + CfgCodecLoadDecay - 1) / CfgCodecLoadDecay;
 }
 
 bool AudioTask::loop() 
@@ -134,22 +251,42 @@ bool AudioTask::loop()
   return shouldUpdateScreen;
 }
 
+uint32_t AudioTask::getLoopTimeoutMs() const
+{
+  // playback status timer is the only periodic work
+  return playTimer_.empty() ? EventNotifier::CfgWaitForever : playTimer_.ticks();
+}
+
 void AudioTask::setPtt(bool isPttOn) 
 {
   isPttOn_ = isPttOn;
 }
 
-void AudioTask::play() const
+bool AudioTask::play() const
 {
+  // task is draining rx queue and will pick up new packets without notification
+  if (isDraining_) return false;
   xTaskNotify(audioTaskHandle_, CfgAudioPlayBit, eSetBits);
+  return true;
+}
+
+void AudioTask::wakeup()
+{
+  wakeupMs_ = millis();
+  xTaskNotify(audioTaskHandle_, CfgAudioWakeupBit, eSetBits);
 }
 
 void AudioTask::record() const
 {
-  radioTask_->startTransmit();
+  txRadioTask_->startTransmit();
   xTaskNotify(audioTaskHandle_, CfgAudioRecBit, eSetBits);
 }
 
+void AudioTask::replay() const
+{
+  xTaskNotify(audioTaskHandle_, CfgAudioReplayBit, eSetBits);
+}
+
 void AudioTask::task(void *param) {
   static_cast<AudioTask*>(param)->audioTask();
 }
@@ -157,26 +294,18 @@ void AudioTask::task(void *param) {
 void AudioTask::audioTask()
 {
   LOG_INFO("Audio task started");
-  isRunning_ = true;
-
-  // select and codec
-  if (config_->AudioCodec == CFG_AUDIO_CODEC_CODEC2)
-    audioCodec_.reset(new AudioCodecCodec2());
-  else if (config_->AudioCodec == CFG_AUDIO_CODEC_OPUS)
-    audioCodec_.reset(new AudioCodecOpus());
-  else {
-    LOG_ERROR("Unknown codec", config_->AudioCodec);
+  if (!audioPipeline_->start(config_)) {
+    LOG_ERROR("Failed to start audio pipeline");
+    vTaskDelete(NULL);
     return;
   }
+  isRunning_ = true;
 
-  audioCodec_->start(config_);
-
-  // construct buffers
   codecSamplesPerFrame_ = audioCodec_->getPcmFrameSize();
   codecBytesPerFrame_ = audioCodec_->getFrameSize();
-  pcmFrameBuffer_ = new int16_t[audioCodec_->getPcmFrameBufferSize()];
-  pcmResampleBuffer_ = new int16_t[audioCodec_->getPcmFrameBufferSize() * config_->AudioResampleCoeff_];
-  encodedFrameBuffer_ = new uint8_t[codecBytesPerFrame_];
+  isFixedFrameSize_ = audioCodec_->isFixedFrameSize();
+  if (isFixedFrameSize_ && config_->AudioMaxPktSize < packetBufferSize_)
+    packetBufferSize_ = config_->AudioMaxPktSize;
 
   delay(CfgStartupDelayMs);
   installAudio(codecSamplesPerFrame_);
@@ -186,17 +315,26 @@ void AudioTask::audioTask()
     xTaskNotifyWaitIndexed(0, 0x00, ULONG_MAX, &audioBits, portMAX_DELAY);
 
     LOG_DEBUG("Audio task command bits", audioBits);
+    if (audioBits & CfgAudioWakeupBit) {
+      audioTaskWakeup();
+    }
+    // playback tail is drained by now, speaker is powered down until the next over
+    if ((audioBits & CfgAudioIdleBit) && !isPlaying_) {
+      setI2sActive(false, isMicActive_);
+    }
     if (audioBits & CfgAudioPlayBit) {
       audioTaskPlay();
     } else if (audioBits & CfgAudioRecBit) {
       audioTaskRecord();
+    } else if (audioBits & CfgAudioReplayBit) {
+      audioTaskReplay();
+    } else if (audioBits & CfgAudioParrotBit) {
+      audioTaskParrot();
     }
+    publishStats();
   }
 
-  delete encodedFrameBuffer_;
-  delete pcmResampleBuffer_;
-  delete pcmFrameBuffer_;
-  audioCodec_->stop();
+  audioPipeline_->stop();
 
   uninstallAudio();
 
@@ -204,6 +342,12 @@ void AudioTask::audioTask()
   vTaskDelete(NULL);
 }
 
+void AudioTask::audioTaskWakeup()
+{
+  // speaker starts from silence instead of samples left before sleep, first frame goes out immediately
+  if (isSpkActive_) i2s_zero_dma_buffer(CfgAudioI2sSpkId);
+}
+
 void AudioTask::audioTaskPlay()
 {
   LOG_DEBUG("Playing audio");
@@ -213,72 +357,154 @@ void AudioTask::audioTaskPlay()
   LOG_DEBUG("Target level is", targetLevel);
 
   // run till ptt is not pressed and radio has data
-  while (!isPttOn_ && radioTask_->hasData()) {
-    byte packetSize;
-    if (!radioTask_->readPacketSize(packetSize)) {
-      LOG_ERROR("Failed to read packet size");
-      vTaskDelay(1);
+  isDraining_ = true;
+  while (!isPttOn_) {
+    if (!playNextFrame(targetLevel)) {
+      // packet could be queued after the check, while notification was suppressed
+      isDraining_ = false;
+      if (!rxRadioTask_->hasData()) break;
+      isDraining_ = true;
       continue;
     }
+    vTaskDelay(1);
+  } // while rx data available
+  isDraining_ = false;
+}
+
+bool AudioTask::playNextFrame(int16_t targetLevel)
+{
+  RadioQueue::Packet packet;
+  const byte *packetData = rxRadioTask_->readPacket(packet);
+  if (packetData == nullptr) return false;
+
+  if (playOffset_ == 0) {
+    pmService_->lightSleepReset();
+    playTimerReset();
+    LOG_DEBUG("Playing packet", packet.size);
+    if (config_->RecorderMode != CFG_RECORDER_MODE_OFF) {
+      voiceRecorder_->write(packetData, packet.size, false);
+    }
+    serialProtocol_->sendVoice(packetData, packet.size, packet.rssi, packet.snr);
+  }
+
+  // split only if codec has fixed frame size, otherwise just process complete packet,
+  // frames are decoded directly from the queue memory
+  int frameSize = isFixedFrameSize_ ? codecBytesPerFrame_ : packet.size;
+  if (playOffset_ + frameSize <= packet.size) {
+    // decode to pcm, adjust agc, upsample, and send for playback
+    decodeAndPlay(packetData + playOffset_, frameSize, targetLevel);
+  }
+  playOffset_ += frameSize;
+
+  // no more complete frames in the packet
+  if (playOffset_ + frameSize > packet.size) {
+    rxRadioTask_->releasePacket();
+    playOffset_ = 0;
+  }
+  return true;
+}
+
+void AudioTask::audioTaskReplay()
+{
+  LOG_DEBUG("Playing recorded over");
+  voiceRecorder_->flush(CfgRecorderFlushTimeoutMs);
+  if (!voiceRecorder_->openLastOver()) {
+    LOG_INFO("No recorded over");
+    return;
+  }
+  int16_t targetLevel = dsp_->audioVolumeToLogPcm(volume_, maxVolume_, maxVolume_ * CfgAudioMaxVolumePcmMultiplier);
+
+  // stop if user starts transmitting
+  VoiceRecorder::Frame frame;
+  int packetSize;
+  while (!isPttOn_ && (packetSize = voiceRecorder_->readNext(recorderBuffer_, CfgRecorderFrameSize, frame)) > 0) {
     pmService_->lightSleepReset();
-    LOG_DEBUG("Playing packet", packetSize);
-
-    // split by frame, decode and play
-    for (int i = 0; i < packetSize; i++) {
-
-      // read byte by byte from radio task
-      byte b;
-      if (!radioTask_->readNextByte(b)) {
-        LOG_ERROR("Failed to read next byte");
-        vTaskDelay(1);
-        continue;
-      }
-
-      // split only if codec has fixed frame size, otherwise just process complete packet
-      int subFrameSize = audioCodec_->isFixedFrameSize() ? codecBytesPerFrame_ : packetSize;
-      encodedFrameBuffer_[i % subFrameSize] = b;
-
-      // one encoded audio frame is read, decode and process
-      if (i % subFrameSize == subFrameSize - 1) {
-
-        // decode to pcm, adjust agc, upsample, and send for playback
-        decodeAndPlay(subFrameSize, targetLevel);
-        vTaskDelay(1);
-      }
+    int frameSize = isFixedFrameSize_ ? codecBytesPerFrame_ : packetSize;
+    for (int i = 0; i + frameSize <= packetSize; i += frameSize) {
+      decodeAndPlay(recorderBuffer_ + i, frameSize, targetLevel);
+      vTaskDelay(1);
     }
-  } // while rx data available
+  }
+  voiceRecorder_->close();
 }
 
-void AudioTask::decodeAndPlay(int frameSize, int16_t targetLevel)
+void AudioTask::audioTaskParrot()
 {
-  // decode in current codec
-  int pcmFrameSize = audioCodec_->decode(pcmFrameBuffer_, encodedFrameBuffer_, frameSize);
-
-  // adjust volume
-  dsp_->audioAdjustGainAgc(pcmFrameBuffer_, pcmFrameSize, targetLevel);
-
-  // upsample if codec rate is lower than speaker rate
-  int writeDataSize = pcmFrameSize;
-  int16_t* pcmBuffer = pcmFrameBuffer_;
-  if (config_->AudioResampleCoeff_ == 2) {
-    writeDataSize = dsp_->audioUpsample2x(pcmFrameBuffer_, pcmResampleBuffer_, pcmFrameSize);
-    pcmBuffer = pcmResampleBuffer_;
+  LOG_DEBUG("Transmitting recorded over");
+  voiceRecorder_->flush(CfgRecorderFlushTimeoutMs);
+  if (!voiceRecorder_->openLastOver()) {
+    LOG_INFO("No recorded over");
+    return;
   }
+  txRadioTask_->startTransmit();
+
+  // encoded packets are sent as is, waiting for the radio when tx queue is full
+  VoiceRecorder::Frame frame;
+  int packetSize;
+  int maxPacketSize = txRadioTask_->getMaxPacketSize();
+  while (!isPttOn_ && (packetSize = voiceRecorder_->readNext(recorderBuffer_, CfgRecorderFrameSize, frame)) > 0) {
+    if (packetSize > maxPacketSize) {
+      LOG_ERROR("Recorded packet is too large", packetSize);
+      continue;
+    }
+    while (!isPttOn_ && !txRadioTask_->writePacket(recorderBuffer_, packetSize)) {
+      txRadioTask_->transmit();
+      vTaskDelay(CfgParrotQueueWaitMs);
+    }
+    txRadioTask_->transmit();
+    pmService_->lightSleepReset();
+  }
+  voiceRecorder_->close();
 
-  // write to i2s speaker
+  vTaskDelay(1);
+  txRadioTask_->startReceive();
+}
+
+void AudioTask::decodeAndPlay(const uint8_t *encodedFrame, int frameSize, int16_t targetLevel)
+{
+  // decode in current codec, adjust volume and upsample if codec rate is lower than speaker rate
+  const int16_t *pcmBuffer;
+  uint32_t codecStartUs = micros();
+  int writeDataSize = audioPipeline_->decode(encodedFrame, frameSize, targetLevel, pcmBuffer);
+  updateCodecLoad(micros() - codecStartUs);
+  if (writeDataSize <= 0) {
+    LOG_ERROR("Failed to decode frame", writeDataSize);
+    return;
+  }
+
+  // write to i2s speaker, it is powered down between overs
+  if (!isSpkActive_) setI2sActive(true, isMicActive_);
   size_t bytesWritten;
   if (i2s_write(CfgAudioI2sSpkId, pcmBuffer, sizeof(int16_t) * writeDataSize, &bytesWritten, portMAX_DELAY) != ESP_OK) {
     LOG_ERROR("Failed to write to I2S speaker");
   }
+  if (wakeupMs_ != 0) {
+    uint32_t latencyMs = millis() - wakeupMs_;
+    wakeupMs_ = 0;
+    if (latencyMs < CfgWakeupLatencyMaxMs) {
+      LOG_INFO("Wakeup to first sample", latencyMs, "ms");
+      stats_.wakeupLatencyMs = latencyMs;
+    }
+  }
+  stats_.rxFrames++;
+  publishStats();
 }
 
 void AudioTask::audioTaskRecord()
 {      
   LOG_DEBUG("Recording audio");
 
-  size_t bytesRead;
   int packetSize = 0;
-  i2s_start(CfgAudioI2sMicId);
+  uint32_t micOverruns = stats_.micOverruns;
+  stats_.txOverDropped = 0;
+  audioCodec_->restoreBitRate();
+  flushMicDma();
+  setI2sActive(isSpkActive_, true);
+
+  // with dedicated rx module keep playing received audio, one frame per recorded frame
+  bool isFullDuplex = this->isFullDuplex();
+  int16_t targetLevel = dsp_->audioVolumeToLogPcm(volume_, maxVolume_, maxVolume_ * CfgAudioMaxVolumePcmMultiplier);
+  if (isFullDuplex) isDraining_ = true;
 
   // record while ptt button is pressed
   while (isPttOn_) {
@@ -286,74 +512,135 @@ void AudioTask::audioTaskRecord()
     // transmit if enough audio frames aggregated for fixed frame codec (e.g. codec2)
     // or transmit immediately if variable size frame is read (e.g. OPUS)
     bool shouldTransmit = 
-         (audioCodec_->isFixedFrameSize() && packetSize + codecBytesPerFrame_ > config_->AudioMaxPktSize) ||
-         (!audioCodec_->isFixedFrameSize() && packetSize > 0);
+         (isFixedFrameSize_ && packetSize + codecBytesPerFrame_ > packetBufferSize_) ||
+         (!isFixedFrameSize_ && packetSize > 0);
 
     // perform packet transmission to radio
     if (shouldTransmit) {
       LOG_DEBUG("Recorded packet", packetSize);
-      if (!radioTask_->writePacketSize(packetSize)) {
-        LOG_ERROR("Failed to write packet size");
-        vTaskDelay(1);
-        continue;
-      }
-      radioTask_->transmit();
-      pmService_->lightSleepReset();
+      transmitPacket(packetSize);
       packetSize = 0;
     }
 
-    // read one pcm sample from i2s microphone
-    int readDataSize = codecSamplesPerFrame_ * config_->AudioResampleCoeff_;
-    if (i2s_read(CfgAudioI2sMicId, pcmResampleBuffer_, sizeof(uint16_t) * readDataSize, &bytesRead, portMAX_DELAY) != ESP_OK) {
-      LOG_ERROR("Failed to read from I2S microphone");
-      continue;
-    }
+    // wait for the next frame, dma kept capturing it while the previous one was encoded
+    if (!captureMicFrame()) continue;
 
-    // process pcm frame, apply filter, downsample and encode in selected codec, queue for transmission
-    int encodedFrameSize = encodeAndQueue(readDataSize);
-    packetSize += encodedFrameSize;
+    // process pcm frame, apply filter, downsample and encode in selected codec, append to the packet
+    packetSize += encodeAndQueue(micFrameSize_, packetSize);
 
-    vTaskDelay(1);
+    if (isFullDuplex) playNextFrame(targetLevel);
   } // while ptt pressed
 
   // send remaining tail audio encoded samples if any
   if (packetSize > 0) {
       LOG_DEBUG("Recorded packet tail", packetSize);
-      if (radioTask_->writePacketSize(packetSize)) {
-        radioTask_->transmit();
-        pmService_->lightSleepReset();
-      } else {
-        LOG_ERROR("Failed to write byte");
-      }
+      transmitPacket(packetSize);
       packetSize = 0;
   }
 
+  if (stats_.txOverDropped > 0) {
+    LOG_WARN("Radio could not keep up, dropped", stats_.txOverDropped, "bit rate reductions", stats_.txBitRateReductions);
+  }
+  if (stats_.micOverruns != micOverruns) {
+    LOG_WARN("Microphone overruns", stats_.micOverruns - micOverruns);
+  }
+
   // stop mic and tell radio to switch to receive
   vTaskDelay(1);
-  i2s_stop(CfgAudioI2sMicId);
-  radioTask_->startReceive();
+  setI2sActive(isSpkActive_, false);
+  txRadioTask_->startReceive();
+
+  // play the rest of the packets received during transmission
+  if (isFullDuplex) {
+    isDraining_ = false;
+    if (rxRadioTask_->hasData()) audioTaskPlay();
+  }
 }
 
-int AudioTask::encodeAndQueue(int pcmFrameSize)
+bool AudioTask::transmitPacket(int packetSize)
 {
-  int16_t *pcmReadBuffer = pcmResampleBuffer_;
+  // radio is falling behind, reduce codec bit rate if codec supports it
+  uint32_t nowMs = millis();
+  if (txRadioTask_->getTxQueueLoad() >= CfgTxQueueHighLoad && nowMs - lastBitRateReduceMs_ > CfgBitRateReduceIntervalMs) {
+    lastBitRateReduceMs_ = nowMs;
+    if (audioCodec_->reduceBitRate()) {
+      stats_.txBitRateReductions++;
+    }
+  }
 
-  // apply high pass filter
-  dsp_->audioFilterHpf(pcmReadBuffer, pcmFrameSize);
+  // queue is full, drop oldest whole packets to keep latency bounded and stream consistent
+  while (!txRadioTask_->writePacket(packetBuffer_, packetSize)) {
+    stats_.txDropped++;
+    stats_.txOverDropped++;
+    notifyStateChanged();
+    if (!txRadioTask_->dropOldestTxPacket()) {
+      LOG_ERROR("Failed to write packet", packetSize);
+      return false;
+    }
+    LOG_DEBUG("TX queue is full, dropped oldest packet");
+  }
+  stats_.txPackets++;
+  if (config_->RecorderMode == CFG_RECORDER_MODE_RX_TX) {
+    voiceRecorder_->write(packetBuffer_, packetSize, true);
+  }
+  txRadioTask_->transmit();
+  pmService_->lightSleepReset();
+  publishStats();
+  return true;
+}
 
-  // downsample if mic sample rate is higher than codec rate
-  if (config_->AudioResampleCoeff_ == 2) {
-    dsp_->audioDownsample2x(pcmReadBuffer, pcmFrameBuffer_, pcmFrameSize);
-    pcmReadBuffer = pcmFrameBuffer_;
+bool AudioTask::captureMicFrame()
+{
+  // every rx event is one filled dma buffer, read it right away without blocking
+  while (micFrameOffset_ < micFrameSize_) {
+    i2s_event_t event;
+    if (xQueueReceive(micEventQueue_, &event, pdMS_TO_TICKS(CfgMicEventTimeoutMs)) != pdTRUE) {
+      LOG_ERROR("I2S microphone timeout");
+      return false;
+    }
+    if (event.type == I2S_EVENT_RX_Q_OVF) {
+      stats_.micOverruns++;
+      continue;
+    }
+    if (event.type != I2S_EVENT_RX_DONE) continue;
+    size_t bytesRead = 0;
+    int readSize = min(micDmaBufLen_, micFrameSize_ - micFrameOffset_);
+    if (i2s_read(getMicI2sId(), audioPipeline_->getMicBuffer() + micFrameOffset_, 
+        sizeof(int16_t) * readSize, &bytesRead, 0) != ESP_OK) {
+      LOG_ERROR("Failed to read from I2S microphone");
+      return false;
+    }
+    micFrameOffset_ += bytesRead / sizeof(int16_t);
   }
+  // captured frame goes to the encoder, next one is captured into the other buffer
+  micFrameOffset_ = 0;
+  audioPipeline_->swapMicBuffers();
+  return true;
+}
 
-  // encode in selected codec
-  int encodedFrameSize = audioCodec_->encode(encodedFrameBuffer_, pcmReadBuffer);
-  
-  // transfer data to the radio packet queue without actual transmission
-  for (int i = 0; i < encodedFrameSize; i++) {
-    radioTask_->writeNextByte(encodedFrameBuffer_[i]);
+int AudioTask::encodeAndQueue(int pcmFrameSize, int packetSize)
+{
+  // apply high pass filter, downsample if mic sample rate is higher than codec rate and encode
+  const uint8_t *encodedFrame;
+  uint32_t codecStartUs = micros();
+  int encodedFrameSize = audioPipeline_->encode(pcmFrameSize, encodedFrame);
+  updateCodecLoad(micros() - codecStartUs);
+  if (encodedFrameSize <= 0) {
+    LOG_ERROR("Failed to encode frame", encodedFrameSize);
+    return 0;
+  }
+  stats_.txFrames++;
+
+  // frame does not fit into the packet, drop it instead of truncating
+  if (packetSize + encodedFrameSize > packetBufferSize_) {
+    LOG_ERROR("Encoded frame is too large", encodedFrameSize);
+    stats_.txDropped++;
+    stats_.txOverDropped++;
+    return 0;
   }
+
+  // append to the packet without actual transmission
+  memcpy(packetBuffer_ + packetSize, encodedFrame, encodedFrameSize);
   return encodedFrameSize;
 }
 
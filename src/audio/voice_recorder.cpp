@@ -0,0 +1,333 @@
+#include "audio/voice_recorder.h"
+
+namespace LoraDv {
+
+static void writeUint32(byte *buf, uint32_t value)
+{
+  buf[0] = value & 0xff;
+  buf[1] = (value >> 8) & 0xff;
+  buf[2] = (value >> 16) & 0xff;
+  buf[3] = (value >> 24) & 0xff;
+}
+
+static uint32_t readUint32(const byte *buf)
+{
+  return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+VoiceRecorder::VoiceRecorder(std::shared_ptr<const Config> config)
+  : config_(config)
+  , recorderTaskHandle_(0)
+  , batchSize_(0)
+  , batchStartMs_(0)
+  , segmentId_(0)
+  , segmentSeq_(0)
+  , segmentOffset_(0)
+  , lastRxFrameMs_(0)
+  , lastTxFrameMs_(0)
+  , lastOverSegmentId_(-1)
+  , lastOverOffset_(0)
+  , readSegmentId_(0)
+  , readSegmentsLeft_(0)
+  , isReadingOver_(false)
+  , isReadStarted_(false)
+  , isMounted_(false)
+  , isFlushRequested_(false)
+  , isRunning_(false)
+{
+}
+
+void VoiceRecorder::start()
+{
+  if (!LittleFS.begin(true)) {
+    LOG_ERROR("Failed to mount file system, recorder is disabled");
+    return;
+  }
+  if (!LittleFS.exists("/rec")) LittleFS.mkdir("/rec");
+  if (!loadSegments()) {
+    LOG_ERROR("Failed to open recorder segment, recorder is disabled");
+    return;
+  }
+  isMounted_ = true;
+  xTaskCreatePinnedToCore(&task, "RecorderTask", CfgTaskStack, this, CfgTaskPriority, &recorderTaskHandle_, CfgCoreId);
+}
+
+bool VoiceRecorder::write(const byte *frameBuf, int frameSize, bool isTx)
+{
+  if (!isMounted_ || frameSize <= 0 || frameSize > 255) return false;
+
+  // stage with timestamp, so flash latency does not affect timing
+  byte *staged = stagingQueue_.reserve(CfgStagedHeaderSize + frameSize);
+  if (staged == nullptr) return false;
+  writeUint32(staged, millis());
+  staged[4] = isTx ? CfgFlagTx : 0;
+  memcpy(staged + CfgStagedHeaderSize, frameBuf, frameSize);
+  stagingQueue_.commit(CfgStagedHeaderSize + frameSize);
+
+  xTaskNotify(recorderTaskHandle_, CfgStoreBit, eSetBits);
+  return true;
+}
+
+bool VoiceRecorder::flush(uint32_t timeoutMs)
+{
+  if (!isMounted_) return false;
+  isFlushRequested_ = true;
+  xTaskNotify(recorderTaskHandle_, CfgFlushBit, eSetBits);
+  uint32_t startMs = millis();
+  while (isFlushRequested_ && millis() - startMs < timeoutMs) {
+    vTaskDelay(1);
+  }
+  return !isFlushRequested_;
+}
+
+void VoiceRecorder::task(void *param)
+{
+  static_cast<VoiceRecorder*>(param)->recorderTask();
+}
+
+void VoiceRecorder::recorderTask()
+{
+  LOG_INFO("Recorder task started");
+  isRunning_ = true;
+
+  while (isRunning_) {
+    uint32_t cmdBits = 0;
+    TickType_t waitTicks = batchSize_ > 0 ? pdMS_TO_TICKS(CfgBatchTimeoutMs) : portMAX_DELAY;
+    xTaskNotifyWaitIndexed(0, 0x00, ULONG_MAX, &cmdBits, waitTicks);
+
+    storeStagedFrames();
+
+    // incomplete batch is written on request or when it is getting old
+    if ((cmdBits & CfgFlushBit) || (batchSize_ > 0 && millis() - batchStartMs_ >= CfgBatchTimeoutMs)) {
+      writeBatch();
+    }
+    if (cmdBits & CfgFlushBit) {
+      isFlushRequested_ = false;
+    }
+  }
+
+  writeBatch();
+  segmentFile_.close();
+  LOG_INFO("Recorder task stopped");
+  vTaskDelete(NULL);
+}
+
+void VoiceRecorder::storeStagedFrames()
+{
+  RadioQueue::Packet packet;
+  const byte *staged;
+  while ((staged = stagingQueue_.peek(packet)) != nullptr) {
+    if (packet.size > CfgStagedHeaderSize) {
+      appendFrame(staged + CfgStagedHeaderSize, packet.size - CfgStagedHeaderSize, readUint32(staged), staged[4]);
+    }
+    stagingQueue_.release();
+  }
+}
+
+void VoiceRecorder::appendFrame(const byte *frameBuf, int frameSize, uint32_t timestampMs, uint8_t flags)
+{
+  int entrySize = CfgFrameHeaderSize + frameSize;
+
+  // long enough silence in the same direction starts new over
+  bool isTx = flags & CfgFlagTx;
+  uint32_t &lastFrameMs = isTx ? lastTxFrameMs_ : lastRxFrameMs_;
+  if (lastFrameMs == 0 || timestampMs - lastFrameMs > CfgOverGapMs) {
+    flags |= CfgFlagOverStart;
+  }
+  lastFrameMs = timestampMs;
+
+  // segment is full, continue in the next one, overwriting the oldest
+  if (segmentOffset_ + batchSize_ + entrySize > CfgSegmentSize) {
+    writeBatch();
+    openSegment((segmentId_ + 1) % CfgSegmentsCount, segmentSeq_ + 1);
+  }
+  if (batchSize_ + entrySize > CfgBatchSize) {
+    writeBatch();
+  }
+  if (!isTx && (flags & CfgFlagOverStart)) {
+    lastOverSegmentId_ = segmentId_;
+    lastOverOffset_ = segmentOffset_ + batchSize_;
+  }
+  if (batchSize_ == 0) {
+    batchStartMs_ = millis();
+  }
+
+  byte *entry = batch_ + batchSize_;
+  writeUint32(entry, timestampMs);
+  entry[4] = flags;
+  entry[5] = frameSize;
+  memcpy(entry + CfgFrameHeaderSize, frameBuf, frameSize);
+  batchSize_ += entrySize;
+}
+
+void VoiceRecorder::writeBatch()
+{
+  if (batchSize_ == 0 || !segmentFile_) return;
+  size_t bytesWritten = segmentFile_.write(batch_, batchSize_);
+  segmentFile_.flush();
+  if (bytesWritten != batchSize_) {
+    LOG_ERROR("Failed to write recorder batch", bytesWritten, batchSize_);
+  }
+  segmentOffset_ += bytesWritten;
+  batchSize_ = 0;
+  LOG_DEBUG("Recorder segment", segmentId_, "offset", segmentOffset_);
+}
+
+bool VoiceRecorder::openSegment(int segmentId, uint32_t segmentSeq)
+{
+  char path[16];
+  segmentPath(path, sizeof(path), segmentId);
+  if (segmentFile_) segmentFile_.close();
+
+  segmentFile_ = LittleFS.open(path, "w");
+  if (!segmentFile_) {
+    LOG_ERROR("Failed to open recorder segment", path);
+    return false;
+  }
+  byte header[CfgSegmentHeaderSize];
+  writeUint32(header, CfgSegmentMagic);
+  writeUint32(header + 4, segmentSeq);
+  segmentFile_.write(header, sizeof(header));
+  segmentFile_.flush();
+
+  // last over is overwritten
+  if (lastOverSegmentId_ == segmentId) lastOverSegmentId_ = -1;
+
+  segmentId_ = segmentId;
+  segmentSeq_ = segmentSeq;
+  segmentOffset_ = CfgSegmentHeaderSize;
+  return true;
+}
+
+bool VoiceRecorder::loadSegments()
+{
+  // continue writing into the segment with the highest sequence number
+  int newestSegmentId = -1;
+  uint32_t newestSegmentSeq = 0;
+  for (int segmentId = 0; segmentId < CfgSegmentsCount; segmentId++) {
+    char path[16];
+    segmentPath(path, sizeof(path), segmentId);
+    if (!LittleFS.exists(path)) continue;
+    File file = LittleFS.open(path, "r");
+    byte header[CfgSegmentHeaderSize];
+    bool isValid = file && file.read(header, sizeof(header)) == sizeof(header) && readUint32(header) == CfgSegmentMagic;
+    file.close();
+    if (isValid && (newestSegmentId < 0 || readUint32(header + 4) > newestSegmentSeq)) {
+      newestSegmentId = segmentId;
+      newestSegmentSeq = readUint32(header + 4);
+    }
+  }
+  if (newestSegmentId < 0) {
+    return openSegment(0, 1);
+  }
+
+  char path[16];
+  segmentPath(path, sizeof(path), newestSegmentId);
+  segmentFile_ = LittleFS.open(path, "a");
+  if (!segmentFile_) return false;
+  segmentId_ = newestSegmentId;
+  segmentSeq_ = newestSegmentSeq;
+  segmentOffset_ = segmentFile_.size();
+  LOG_INFO("Recorder segment", segmentId_, "seq", segmentSeq_, "offset", segmentOffset_);
+  if (segmentOffset_ >= CfgSegmentSize) {
+    return openSegment((segmentId_ + 1) % CfgSegmentsCount, segmentSeq_ + 1);
+  }
+  return true;
+}
+
+bool VoiceRecorder::openLastOver()
+{
+  close();
+  int lastOverSegmentId = lastOverSegmentId_;
+  if (!isMounted_ || lastOverSegmentId < 0) return false;
+  readSegmentId_ = lastOverSegmentId;
+  readSegmentsLeft_ = (segmentId_ - lastOverSegmentId + CfgSegmentsCount) % CfgSegmentsCount + 1;
+  isReadingOver_ = true;
+  isReadStarted_ = false;
+  return true;
+}
+
+bool VoiceRecorder::openHistory()
+{
+  close();
+  if (!isMounted_) return false;
+  // from the oldest to the newest segment
+  readSegmentId_ = (segmentId_ + 1) % CfgSegmentsCount;
+  readSegmentsLeft_ = CfgSegmentsCount;
+  isReadingOver_ = false;
+  isReadStarted_ = false;
+  return true;
+}
+
+bool VoiceRecorder::openReadSegment()
+{
+  while (readSegmentsLeft_ > 0) {
+    int segmentId = readSegmentId_;
+    readSegmentId_ = (segmentId + 1) % CfgSegmentsCount;
+    readSegmentsLeft_--;
+
+    char path[16];
+    segmentPath(path, sizeof(path), segmentId);
+    if (!LittleFS.exists(path)) continue;
+    readFile_ = LittleFS.open(path, "r");
+    if (!readFile_) continue;
+
+    // over starts in the middle of the segment
+    if (isReadingOver_ && !isReadStarted_ && segmentId == lastOverSegmentId_) {
+      readFile_.seek(lastOverOffset_);
+      return true;
+    }
+    byte header[CfgSegmentHeaderSize];
+    if (readFile_.read(header, sizeof(header)) == sizeof(header) && readUint32(header) == CfgSegmentMagic) {
+      return true;
+    }
+    readFile_.close();
+  }
+  return false;
+}
+
+int VoiceRecorder::readNext(byte *frameBuf, int maxFrameSize, Frame &frame)
+{
+  while (true) {
+    if (!readFile_ && !openReadSegment()) return 0;
+
+    byte header[CfgFrameHeaderSize];
+    if (readFile_.read(header, sizeof(header)) != sizeof(header)) {
+      readFile_.close();
+      continue;
+    }
+    frame.timestampMs = readUint32(header);
+    frame.flags = header[4];
+    frame.size = header[5];
+
+    // partially written or corrupted, skip the rest of the segment
+    if (frame.size == 0 || frame.size > maxFrameSize || readFile_.read(frameBuf, frame.size) != frame.size) {
+      readFile_.close();
+      continue;
+    }
+
+    // only received frames of the same over
+    if (isReadingOver_) {
+      if (frame.flags & CfgFlagTx) continue;
+      if ((frame.flags & CfgFlagOverStart) && isReadStarted_) {
+        close();
+        return 0;
+      }
+      isReadStarted_ = true;
+    }
+    return frame.size;
+  }
+}
+
+void VoiceRecorder::close()
+{
+  if (readFile_) readFile_.close();
+  readSegmentsLeft_ = 0;
+}
+
+void VoiceRecorder::segmentPath(char *path, int pathLen, int segmentId)
+{
+  snprintf(path, pathLen, "/rec/%d.bin", segmentId);
+}
+
+} // LoraDv
@@ -0,0 +1,110 @@
+#include "fec/conv_code.h"
+
+namespace LoraDv {
+
+ConvCode::ConvCode(int maxDataBits)
+  : maxDataBits_(maxDataBits)
+  , decisions_(new uint16_t[maxDataBits + CfgFlushBits])
+{
+  // register is input bit followed by state, state holds previous bits, newest first
+  for (int reg = 0; reg < 2 * CfgStates; reg++) {
+    uint8_t g1 = __builtin_parity(reg & CfgPolyG1);
+    uint8_t g2 = __builtin_parity(reg & CfgPolyG2);
+    outputs_[reg] = (g1 << 1) | g2;
+  }
+}
+
+ConvCode::~ConvCode()
+{
+  delete[] decisions_;
+}
+
+int ConvCode::getEncodedBits(int dataBits, const uint8_t *puncture, int punctureLen)
+{
+  int encodedBits = 2 * (dataBits + CfgFlushBits);
+  if (puncture == nullptr) return encodedBits;
+  int count = 0;
+  for (int i = 0; i < encodedBits; i++) {
+    if (puncture[i % punctureLen]) count++;
+  }
+  return count;
+}
+
+int ConvCode::encode(const byte *data, int dataBits, const uint8_t *puncture, int punctureLen, uint8_t *encodedBits) const
+{
+  int state = 0;
+  int outCount = 0;
+  int pos = 0;
+  for (int i = 0; i < dataBits + CfgFlushBits; i++) {
+    int bit = i < dataBits ? (data[i >> 3] >> (7 - (i & 7))) & 1 : 0;
+    int reg = (bit << CfgFlushBits) | state;
+    uint8_t out = outputs_[reg];
+    state = reg >> 1;
+    for (int j = 1; j >= 0; j--, pos++) {
+      if (puncture == nullptr || puncture[pos % punctureLen]) {
+        encodedBits[outCount++] = (out >> j) & 1;
+      }
+    }
+  }
+  return outCount;
+}
+
+int ConvCode::decode(const uint8_t *softBits, int softBitsCount, const uint8_t *puncture, int punctureLen, 
+  byte *data, int dataBits)
+{
+  if (dataBits > maxDataBits_) return -1;
+  int steps = dataBits + CfgFlushBits;
+
+  // encoder starts in zero state
+  uint32_t metrics[CfgStates];
+  uint32_t nextMetrics[CfgStates];
+  for (int s = 0; s < CfgStates; s++) {
+    metrics[s] = s == 0 ? 0 : UINT16_MAX;
+  }
+
+  int inPos = 0;
+  int pos = 0;
+  for (int t = 0; t < steps; t++) {
+    // depuncture, missing bits are erasures
+    uint8_t soft[2];
+    for (int j = 0; j < 2; j++, pos++) {
+      bool isPresent = puncture == nullptr || puncture[pos % punctureLen];
+      soft[j] = isPresent && inPos < softBitsCount ? softBits[inPos++] : CfgSoftErasure;
+    }
+    // cost of each possible output pair
+    uint32_t cost[4];
+    for (int out = 0; out < 4; out++) {
+      cost[out] = ((out & 2) ? CfgSoftOne - soft[0] : soft[0]) + ((out & 1) ? CfgSoftOne - soft[1] : soft[1]);
+    }
+    // new state is input bit followed by three newest state bits, oldest bit is the decision
+    uint16_t decision = 0;
+    for (int ns = 0; ns < CfgStates; ns++) {
+      int bit = ns >> (CfgFlushBits - 1);
+      int prev = (ns << 1) & (CfgStates - 1);
+      int reg0 = (bit << CfgFlushBits) | prev;
+      int reg1 = reg0 | 1;
+      uint32_t m0 = metrics[prev] + cost[outputs_[reg0]];
+      uint32_t m1 = metrics[prev | 1] + cost[outputs_[reg1]];
+      if (m1 < m0) {
+        nextMetrics[ns] = m1;
+        decision |= 1 << ns;
+      } else {
+        nextMetrics[ns] = m0;
+      }
+    }
+    decisions_[t] = decision;
+    memcpy(metrics, nextMetrics, sizeof(metrics));
+  }
+
+  // flush bits bring encoder back to zero state, trace back from it
+  memset(data, 0, (dataBits + 7) / 8);
+  int state = 0;
+  for (int t = steps - 1; t >= 0; t--) {
+    int bit = state >> (CfgFlushBits - 1);
+    if (t < dataBits && bit) data[t >> 3] |= 0x80 >> (t & 7);
+    state = ((state << 1) & (CfgStates - 1)) | ((decisions_[t] >> state) & 1);
+  }
+  return metrics[0];
+}
+
+} // LoraDv
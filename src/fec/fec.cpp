@@ -0,0 +1,44 @@
+#include "fec/fec.h"
+
+namespace LoraDv {
+
+void Fec::unpackBits(const byte *data, int bitsCount, uint8_t *bits)
+{
+  for (int i = 0; i < bitsCount; i++) {
+    bits[i] = (data[i >> 3] >> (7 - (i & 7))) & 1;
+  }
+}
+
+void Fec::packBits(const uint8_t *bits, int bitsCount, byte *data)
+{
+  memset(data, 0, (bitsCount + 7) / 8);
+  for (int i = 0; i < bitsCount; i++) {
+    if (bits[i]) data[i >> 3] |= 0x80 >> (i & 7);
+  }
+}
+
+void Fec::interleave(const uint8_t *bits, int bitsCount, int rowBits, uint8_t *out)
+{
+  int rows = (bitsCount + rowBits - 1) / rowBits;
+  int pos = 0;
+  for (int col = 0; col < rowBits; col++) {
+    for (int row = 0; row < rows; row++) {
+      int i = row * rowBits + col;
+      if (i < bitsCount) out[pos++] = bits[i];
+    }
+  }
+}
+
+void Fec::deinterleave(const uint8_t *bits, int bitsCount, int rowBits, uint8_t *out)
+{
+  int rows = (bitsCount + rowBits - 1) / rowBits;
+  int pos = 0;
+  for (int col = 0; col < rowBits; col++) {
+    for (int row = 0; row < rows; row++) {
+      int i = row * rowBits + col;
+      if (i < bitsCount) out[i] = bits[pos++];
+    }
+  }
+}
+
+} // LoraDv
@@ -0,0 +1,48 @@
+#include "fec/fec_conv.h"
+
+namespace LoraDv {
+
+FecConv::FecConv()
+  : convCode_(8 * CfgMaxDataSize)
+{
+}
+
+int FecConv::getEncodedSize(int dataSize) const
+{
+  return (ConvCode::getEncodedBits(8 * dataSize, nullptr, 0) + 7) / 8;
+}
+
+int FecConv::getMaxDataSize(int encodedSize) const
+{
+  return min((encodedSize - 1) / 2, (int)CfgMaxDataSize);
+}
+
+int FecConv::encode(const byte *data, int dataSize, byte *encoded)
+{
+  if (dataSize <= 0 || dataSize > CfgMaxDataSize) return 0;
+  int bitsCount = convCode_.encode(data, 8 * dataSize, nullptr, 0, bits_);
+  interleave(bits_, bitsCount, CfgRowBits, interleavedBits_);
+  packBits(interleavedBits_, bitsCount, encoded);
+  return (bitsCount + 7) / 8;
+}
+
+int FecConv::decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits)
+{
+  int dataSize = getMaxDataSize(encodedSize);
+  if (dataSize <= 0 || getEncodedSize(dataSize) != encodedSize) return -1;
+
+  int bitsCount = ConvCode::getEncodedBits(8 * dataSize, nullptr, 0);
+  unpackBits(encoded, bitsCount, interleavedBits_);
+  deinterleave(interleavedBits_, bitsCount, CfgRowBits, bits_);
+  for (int i = 0; i < bitsCount; i++) {
+    bits_[i] = bits_[i] ? ConvCode::CfgSoftOne : ConvCode::CfgSoftZero;
+  }
+  // hard decisions, so path metric is the number of corrected bits
+  int metric = convCode_.decode(bits_, bitsCount, nullptr, 0, data, 8 * dataSize);
+  int corrected = metric / ConvCode::CfgSoftOne;
+  if (metric < 0 || corrected * CfgMaxErrorRatio > bitsCount) return -1;
+  if (correctedBits != nullptr) *correctedBits = corrected;
+  return dataSize;
+}
+
+} // LoraDv
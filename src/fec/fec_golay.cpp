@@ -0,0 +1,83 @@
+#include "fec/fec_golay.h"
+
+namespace LoraDv {
+
+FecGolay::FecGolay()
+{
+}
+
+int FecGolay::getEncodedSize(int dataSize) const
+{
+  int codewords = 1 + (2 * dataSize + 2) / 3;
+  return codewords * CfgCodewordBits / 8;
+}
+
+int FecGolay::getMaxDataSize(int encodedSize) const
+{
+  int codewords = min(encodedSize * 8 / CfgCodewordBits, (int)CfgMaxCodewords);
+  return codewords > 1 ? (codewords - 1) * 12 / 8 : 0;
+}
+
+int FecGolay::encode(const byte *data, int dataSize, byte *encoded)
+{
+  int encodedSize = getEncodedSize(dataSize);
+  if (dataSize <= 0 || dataSize > 0xff || encodedSize * 8 / CfgCodewordBits > CfgMaxCodewords) return 0;
+
+  // size header, then 12 bit words, 3 bytes give two words
+  int codewords = encodedSize * 8 / CfgCodewordBits;
+  words_[0] = CfgFormatId | dataSize;
+  for (int i = 1; i < codewords; i++) {
+    int offset = 3 * ((i - 1) / 2);
+    byte b0 = data[offset];
+    byte b1 = offset + 1 < dataSize ? data[offset + 1] : 0;
+    byte b2 = offset + 2 < dataSize ? data[offset + 2] : 0;
+    words_[i] = (i & 1) ? (b0 << 4) | (b1 >> 4) : ((b1 & 0x0f) << 8) | b2;
+  }
+  for (int i = 0; i < codewords; i++) {
+    uint32_t codeword = golay_.encode(words_[i]);
+    for (int bit = 0; bit < CfgCodewordBits; bit++) {
+      bits_[i * CfgCodewordBits + bit] = (codeword >> (CfgCodewordBits - 1 - bit)) & 1;
+    }
+  }
+  int bitsCount = codewords * CfgCodewordBits;
+  interleave(bits_, bitsCount, CfgCodewordBits, interleavedBits_);
+  packBits(interleavedBits_, bitsCount, encoded);
+  return encodedSize;
+}
+
+int FecGolay::decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits)
+{
+  int codewords = encodedSize * 8 / CfgCodewordBits;
+  if (codewords < 2 || codewords > CfgMaxCodewords) return -1;
+
+  int bitsCount = codewords * CfgCodewordBits;
+  unpackBits(encoded, bitsCount, interleavedBits_);
+  deinterleave(interleavedBits_, bitsCount, CfgCodewordBits, bits_);
+  int corrected = 0;
+  for (int i = 0; i < codewords; i++) {
+    uint32_t codeword = 0;
+    for (int bit = 0; bit < CfgCodewordBits; bit++) {
+      codeword = (codeword << 1) | bits_[i * CfgCodewordBits + bit];
+    }
+    if (!golay_.decode(codeword, words_[i])) return -1;
+    corrected += __builtin_popcount(codeword ^ golay_.encode(words_[i]));
+  }
+
+  // size must match the packet, otherwise it is not ours or header was miscorrected
+  int dataSize = words_[0] & 0xff;
+  if ((words_[0] & 0xf00) != CfgFormatId || dataSize == 0 || getEncodedSize(dataSize) != encodedSize) return -1;
+  for (int i = 1; i < codewords; i++) {
+    int offset = 3 * ((i - 1) / 2);
+    if (i & 1) {
+      data[offset] = words_[i] >> 4;
+      if (offset + 1 < dataSize) data[offset + 1] = (words_[i] & 0x0f) << 4;
+    } else {
+      if (offset + 1 < dataSize) data[offset + 1] |= words_[i] >> 8;
+      if (offset + 2 < dataSize) data[offset + 2] = words_[i] & 0xff;
+    }
+  }
+  if (correctedBits != nullptr) *correctedBits = corrected;
+  return dataSize;
+}
+
+} // LoraDv
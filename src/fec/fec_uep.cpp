@@ -0,0 +1,176 @@
+#include "fec/fec_uep.h"
+
+namespace LoraDv {
+
+const uint8_t FecUep::Puncture[FecUep::CfgPunctureLen] = { 1, 1, 0, 1, 1, 0 };
+
+FecUep::FecUep(int frameSize, int sensitiveOffset, int sensitiveBits, HeaderSizeFn getHeaderSize)
+  : frameSize_(frameSize)
+  , maxDataSize_(0)
+  , sensitiveOffset_(sensitiveOffset)
+  , sensitiveBits_(sensitiveBits)
+  , getHeaderSize_(getHeaderSize)
+  , convCode_(CfgMaxBits)
+{
+  // fully protected packet is the largest encoding, it must fit into bit buffers
+  maxDataSize_ = getMaxDataSize(CfgMaxBits / 8);
+}
+
+int FecUep::getProtectedBits(int protectedSize, int frames) const
+{
+  return 8 * protectedSize + frames * sensitiveBits_ + CfgCrcBits;
+}
+
+int FecUep::getUnprotectedBits(int frames) const
+{
+  return frames * (8 * frameSize_ - sensitiveBits_);
+}
+
+int FecUep::getCodedBits(int protectedSize, int frames) const
+{
+  int unprotectedBits = getUnprotectedBits(frames);
+  return CfgDescriptorBits + ConvCode::getEncodedBits(getProtectedBits(protectedSize, frames), nullptr, 0)
+    + (unprotectedBits > 0 ? ConvCode::getEncodedBits(unprotectedBits, Puncture, CfgPunctureLen) : 0);
+}
+
+int FecUep::getEncodedSize(int dataSize) const
+{
+  // worst case is the packet without frames, which is fully protected
+  return (getCodedBits(dataSize, 0) + 7) / 8;
+}
+
+int FecUep::getMaxDataSize(int encodedSize) const
+{
+  // smallest data size for the encoded size, packets with frames decode into more data
+  int dataSize = min(encodedSize, (int)CfgMaxProtected);
+  while (dataSize > 0 && getEncodedSize(dataSize) > encodedSize) dataSize--;
+  return dataSize;
+}
+
+int FecUep::encode(const byte *data, int dataSize, byte *encoded)
+{
+  if (dataSize <= 0 || dataSize > maxDataSize_) return 0;
+
+  // header is protected as a whole, incomplete trailing frame makes the whole packet protected
+  int protectedSize = min(getHeaderSize_(data, dataSize), dataSize);
+  int frames = (dataSize - protectedSize) / frameSize_;
+  if ((dataSize - protectedSize) % frameSize_ != 0 || frames > CfgMaxFrames) {
+    protectedSize = dataSize;
+    frames = 0;
+  }
+
+  // split frame bits into sections
+  unpackBits(data, 8 * protectedSize, protectedBits_);
+  int protectedCount = 8 * protectedSize;
+  int unprotectedCount = 0;
+  for (int frame = 0; frame < frames; frame++) {
+    unpackBits(data + protectedSize + frame * frameSize_, 8 * frameSize_, bits_);
+    for (int bit = 0; bit < 8 * frameSize_; bit++) {
+      if (isSensitive(bit))
+        protectedBits_[protectedCount++] = bits_[bit];
+      else
+        unprotectedBits_[unprotectedCount++] = bits_[bit];
+    }
+  }
+  uint16_t crc = crc16(protectedBits_, protectedCount);
+  for (int bit = 0; bit < CfgCrcBits; bit++) {
+    protectedBits_[protectedCount++] = (crc >> (CfgCrcBits - 1 - bit)) & 1;
+  }
+
+  // descriptor, protected and unprotected sections, sections are interleaved separately
+  uint32_t descriptor = golay_.encode((protectedSize << 5) | frames);
+  for (int bit = 0; bit < CfgDescriptorBits; bit++) {
+    interleavedBits_[bit] = (descriptor >> (CfgDescriptorBits - 1 - bit)) & 1;
+  }
+  int pos = CfgDescriptorBits;
+  packBits(protectedBits_, protectedCount, packed_);
+  int codedCount = convCode_.encode(packed_, protectedCount, nullptr, 0, bits_);
+  interleave(bits_, codedCount, CfgRowBits, interleavedBits_ + pos);
+  pos += codedCount;
+  if (unprotectedCount > 0) {
+    packBits(unprotectedBits_, unprotectedCount, packed_);
+    codedCount = convCode_.encode(packed_, unprotectedCount, Puncture, CfgPunctureLen, bits_);
+    interleave(bits_, codedCount, CfgRowBits, interleavedBits_ + pos);
+    pos += codedCount;
+  }
+  packBits(interleavedBits_, pos, encoded);
+  return (pos + 7) / 8;
+}
+
+int FecUep::decode(const byte *encoded, int encodedSize, byte *data, int *correctedBits)
+{
+  if (encodedSize <= CfgDescriptorBits / 8 || 8 * encodedSize > CfgMaxBits) return -1;
+  unpackBits(encoded, 8 * encodedSize, interleavedBits_);
+
+  // section sizes must match the packet size
+  uint32_t descriptor = 0;
+  for (int bit = 0; bit < CfgDescriptorBits; bit++) {
+    descriptor = (descriptor << 1) | interleavedBits_[bit];
+  }
+  uint16_t value;
+  if (!golay_.decode(descriptor, value)) return -1;
+  int corrected = __builtin_popcount(descriptor ^ golay_.encode(value));
+  int protectedSize = value >> 5;
+  int frames = value & CfgMaxFrames;
+  int dataSize = protectedSize + frames * frameSize_;
+  if (dataSize == 0 || (getCodedBits(protectedSize, frames) + 7) / 8 != encodedSize) return -1;
+
+  // protected section must pass crc, otherwise frames could not be trusted
+  int pos = CfgDescriptorBits;
+  int protectedCount = getProtectedBits(protectedSize, frames);
+  int codedCount = ConvCode::getEncodedBits(protectedCount, nullptr, 0);
+  deinterleave(interleavedBits_ + pos, codedCount, CfgRowBits, bits_);
+  for (int i = 0; i < codedCount; i++) {
+    bits_[i] = bits_[i] ? ConvCode::CfgSoftOne : ConvCode::CfgSoftZero;
+  }
+  int metric = convCode_.decode(bits_, codedCount, nullptr, 0, packed_, protectedCount);
+  if (metric < 0 || (metric / ConvCode::CfgSoftOne) * CfgMaxErrorRatio > codedCount) return -1;
+  corrected += metric / ConvCode::CfgSoftOne;
+  pos += codedCount;
+  unpackBits(packed_, protectedCount, protectedBits_);
+  uint16_t crc = 0;
+  for (int bit = 0; bit < CfgCrcBits; bit++) {
+    crc = (crc << 1) | protectedBits_[protectedCount - CfgCrcBits + bit];
+  }
+  if (crc != crc16(protectedBits_, protectedCount - CfgCrcBits)) return -1;
+
+  // unprotected bits are taken as decoded, errors only affect spectral details
+  int unprotectedCount = getUnprotectedBits(frames);
+  if (unprotectedCount > 0) {
+    codedCount = ConvCode::getEncodedBits(unprotectedCount, Puncture, CfgPunctureLen);
+    deinterleave(interleavedBits_ + pos, codedCount, CfgRowBits, bits_);
+    for (int i = 0; i < codedCount; i++) {
+      bits_[i] = bits_[i] ? ConvCode::CfgSoftOne : ConvCode::CfgSoftZero;
+    }
+    metric = convCode_.decode(bits_, codedCount, Puncture, CfgPunctureLen, packed_, unprotectedCount);
+    corrected += metric / ConvCode::CfgSoftOne;
+    unpackBits(packed_, unprotectedCount, unprotectedBits_);
+  }
+
+  // reassemble frames from both sections
+  packBits(protectedBits_, 8 * protectedSize, data);
+  int protectedPos = 8 * protectedSize;
+  int unprotectedPos = 0;
+  for (int frame = 0; frame < frames; frame++) {
+    for (int bit = 0; bit < 8 * frameSize_; bit++) {
+      bits_[bit] = isSensitive(bit) ? protectedBits_[protectedPos++] : unprotectedBits_[unprotectedPos++];
+    }
+    packBits(bits_, 8 * frameSize_, data + protectedSize + frame * frameSize_);
+  }
+  if (correctedBits != nullptr) *correctedBits = corrected;
+  return dataSize;
+}
+
+uint16_t FecUep::crc16(const uint8_t *bits, int bitsCount)
+{
+  // crc-16/ccitt over unpacked bits
+  uint16_t crc = 0xffff;
+  for (int i = 0; i < bitsCount; i++) {
+    bool isSet = ((crc >> 15) & 1) ^ bits[i];
+    crc <<= 1;
+    if (isSet) crc ^= 0x1021;
+  }
+  return crc;
+}
+
+} // LoraDv
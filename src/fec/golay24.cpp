@@ -0,0 +1,75 @@
+#include "fec/golay24.h"
+
+namespace LoraDv {
+
+// parity contribution of each data bit, same generator as used by M17
+const uint16_t Golay24::EncodeMatrix[12] = {
+  0x8eb, 0x93e, 0xa97, 0xdc6, 0x367, 0x6cd,
+  0xd99, 0x3da, 0x7b4, 0xf68, 0x63b, 0xc75
+};
+
+Golay24::Golay24()
+  : syndromeTable_(getSyndromeTable())
+{
+  for (int nibble = 0; nibble < 3; nibble++) {
+    for (int value = 0; value < 16; value++) {
+      uint16_t parity = 0;
+      for (int bit = 0; bit < 4; bit++) {
+        if (value & (1 << bit)) parity ^= EncodeMatrix[4 * nibble + bit];
+      }
+      parityTable_[nibble][value] = parity;
+    }
+  }
+}
+
+const uint32_t *Golay24::getSyndromeTable()
+{
+  // static initialization is thread safe, so instances created from different tasks share one table
+  static const uint32_t *syndromeTable = buildSyndromeTable();
+  return syndromeTable;
+}
+
+uint32_t *Golay24::buildSyndromeTable()
+{
+  uint32_t *syndromeTable = new uint32_t[CfgSyndromes];
+  for (int i = 0; i < CfgSyndromes; i++) {
+    syndromeTable[i] = CfgNoPattern;
+  }
+  // all error patterns up to weight 3 have distinct syndromes
+  syndromeTable[0] = 0;
+  for (int i = 0; i < 24; i++) {
+    for (int j = i; j < 24; j++) {
+      for (int k = j; k < 24; k++) {
+        uint32_t pattern = (1UL << i) | (1UL << j) | (1UL << k);
+        uint16_t syndrome = pattern & 0xfff;
+        for (int bit = 0; bit < 12; bit++) {
+          if (pattern & (1UL << (12 + bit))) syndrome ^= EncodeMatrix[bit];
+        }
+        syndromeTable[syndrome] = pattern;
+      }
+    }
+  }
+  return syndromeTable;
+}
+
+uint16_t Golay24::getParity(uint16_t data) const
+{
+  return parityTable_[0][data & 0xf] ^ parityTable_[1][(data >> 4) & 0xf] ^ parityTable_[2][(data >> 8) & 0xf];
+}
+
+uint32_t Golay24::encode(uint16_t data) const
+{
+  data &= 0xfff;
+  return ((uint32_t)data << 12) | getParity(data);
+}
+
+bool Golay24::decode(uint32_t codeword, uint16_t &data) const
+{
+  uint16_t syndrome = getParity((codeword >> 12) & 0xfff) ^ (codeword & 0xfff);
+  uint32_t pattern = syndromeTable_[syndrome];
+  if (pattern == CfgNoPattern) return false;
+  data = ((codeword ^ pattern) >> 12) & 0xfff;
+  return true;
+}
+
+} // LoraDv
@@ -0,0 +1,109 @@
+#include "hal/data_link.h"
+
+namespace LoraDv {
+
+DataLink::DataLink()
+  : onReceive_(nullptr)
+  , txMessageSize_(0)
+  , txOffset_(0)
+  , txFragmentSize_(0)
+  , txMessageId_(0)
+  , txFragmentIndex_(0)
+  , txFragmentsCount_(0)
+  , rxMessageSize_(0)
+  , rxNextIndex_(-1)
+  , rxMessageId_(0)
+{
+}
+
+bool DataLink::send(const byte *dataBuf, int dataSize)
+{
+  // whole message is queued, so it is never sent partially
+  if (dataSize <= 0 || dataSize > CfgMaxMessageSize) return false;
+  return txQueue_.push(dataBuf, dataSize);
+}
+
+int DataLink::receive(byte *dataBuf, int maxDataSize, float *rssi, float *snr)
+{
+  RadioQueue::Packet packet = {};
+  int dataSize = rxQueue_.pop(dataBuf, maxDataSize, &packet);
+  if (dataSize <= 0) return dataSize;
+  if (rssi != nullptr) *rssi = packet.rssi;
+  if (snr != nullptr) *snr = packet.snr;
+  return dataSize;
+}
+
+bool DataLink::hasFragments() const
+{
+  return txOffset_ < txMessageSize_ || txQueue_.hasData();
+}
+
+int DataLink::peekFragment(byte *fragmentBuf, int maxFragmentSize)
+{
+  if (maxFragmentSize <= CfgFragmentHeaderSize) return 0;
+
+  // next message is split into equal fragments, last one could be shorter
+  if (txOffset_ >= txMessageSize_) {
+    int messageSize = txQueue_.pop(txMessage_, sizeof(txMessage_));
+    if (messageSize <= 0) {
+      txMessageSize_ = txOffset_ = 0;
+      return 0;
+    }
+    txMessageSize_ = messageSize;
+    txOffset_ = 0;
+    txFragmentSize_ = maxFragmentSize - CfgFragmentHeaderSize;
+    txMessageId_++;
+    txFragmentIndex_ = 0;
+    txFragmentsCount_ = (messageSize + txFragmentSize_ - 1) / txFragmentSize_;
+  }
+
+  int payloadSize = min(txFragmentSize_, txMessageSize_ - txOffset_);
+  fragmentBuf[0] = txMessageId_;
+  fragmentBuf[1] = txFragmentIndex_;
+  fragmentBuf[2] = txFragmentsCount_;
+  memcpy(fragmentBuf + CfgFragmentHeaderSize, txMessage_ + txOffset_, payloadSize);
+  return CfgFragmentHeaderSize + payloadSize;
+}
+
+void DataLink::releaseFragment()
+{
+  if (txOffset_ >= txMessageSize_) return;
+  txOffset_ += txFragmentSize_;
+  txFragmentIndex_++;
+}
+
+bool DataLink::onFragment(const byte *fragmentBuf, int fragmentSize, float rssi, float snr)
+{
+  if (fragmentSize <= CfgFragmentHeaderSize) return false;
+  uint8_t messageId = fragmentBuf[0];
+  int fragmentIndex = fragmentBuf[1];
+  int fragmentsCount = fragmentBuf[2];
+  int payloadSize = fragmentSize - CfgFragmentHeaderSize;
+
+  if (fragmentIndex == 0) {
+    rxMessageId_ = messageId;
+    rxMessageSize_ = 0;
+    rxNextIndex_ = 0;
+  }
+  // missing or out of order fragment, rest of the message is dropped
+  if (rxNextIndex_ < 0 || messageId != rxMessageId_ || fragmentIndex != rxNextIndex_
+    || fragmentIndex >= fragmentsCount || rxMessageSize_ + payloadSize > CfgMaxMessageSize) {
+    LOG_DEBUG("Data fragment is out of order", messageId, fragmentIndex, fragmentsCount);
+    rxNextIndex_ = -1;
+    return false;
+  }
+  memcpy(rxMessage_ + rxMessageSize_, fragmentBuf + CfgFragmentHeaderSize, payloadSize);
+  rxMessageSize_ += payloadSize;
+  if (++rxNextIndex_ < fragmentsCount) return true;
+
+  rxNextIndex_ = -1;
+  if (!rxQueue_.push(rxMessage_, rxMessageSize_, rssi, snr)) {
+    LOG_ERROR("Data queue is full, message dropped", rxMessageSize_);
+    return false;
+  }
+  LOG_DEBUG("Received data message, size", rxMessageSize_);
+  if (onReceive_) onReceive_();
+  return true;
+}
+
+} // LoraDv
@@ -1,16 +1,134 @@
 #include "hal/hw_monitor.h"
+#include "hal/radio_task.h"
 
 namespace LoraDv {
 
-HwMonitor::HwMonitor(std::shared_ptr<const Config> config) 
+HwMonitor::HwMonitor(std::shared_ptr<const Config> config)
   : config_(config)
+  , hwMonitorTaskHandle_(0)
+  , adcChars_{}
+  , restingVoltage_(0)
+  , loadVoltage_(0)
+  , lastTxMs_(0)
+  , isRunning_(false)
 {
 }
 
+void HwMonitor::start(std::shared_ptr<RadioTask> txRadioTask)
+{
+  txRadioTask_ = txRadioTask;
+  setupAdc();
+  // first value is available right away
+  restingVoltage_ = sampleVoltage();
+  LOG_INFO("Battery voltage", getBatteryVoltage());
+  isRunning_ = true;
+  xTaskCreatePinnedToCore(&task, "HwMonitorTask", CfgTaskStack, this, CfgTaskPriority, &hwMonitorTaskHandle_, CfgCoreId);
+}
+
+void HwMonitor::setupAdc()
+{
+  int channel = digitalPinToAnalogChannel(config_->BatteryMonPin_);
+  adc_unit_t unit = channel >= 10 ? ADC_UNIT_2 : ADC_UNIT_1;
+  analogSetPinAttenuation(config_->BatteryMonPin_, ADC_11db);
+  esp_adc_cal_value_t calType = esp_adc_cal_characterize(unit, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+    CfgDefaultVrefMv, &adcChars_);
+  if (calType == ESP_ADC_CAL_VAL_EFUSE_TP) {
+    LOG_INFO("ADC calibrated from efuse two point values");
+  } else if (calType == ESP_ADC_CAL_VAL_EFUSE_VREF) {
+    LOG_INFO("ADC calibrated from efuse reference voltage");
+  } else {
+    LOG_INFO("ADC is not calibrated, using default reference voltage");
+  }
+}
+
+void HwMonitor::task(void *param)
+{
+  static_cast<HwMonitor*>(param)->hwMonitorTask();
+}
+
+void HwMonitor::hwMonitorTask()
+{
+  LOG_INFO("Hardware monitor task started");
+  while (isRunning_) {
+    bool isTx = isTransmitting();
+    float voltage = sampleVoltage();
+    // transmission started or stopped while sampling, value is neither resting nor under load
+    if (isTx != isTransmitting()) continue;
+
+    uint32_t nowMs = millis();
+    if (isTx) {
+      lastTxMs_ = nowMs;
+      loadVoltage_ = loadVoltage_ == 0 ? voltage : loadVoltage_ + CfgFilterAlpha * (voltage - loadVoltage_);
+    } else if (lastTxMs_ == 0 || nowMs - lastTxMs_ >= CfgTxRecoveryMs) {
+      restingVoltage_ += CfgFilterAlpha * (voltage - restingVoltage_);
+    }
+    vTaskDelay(pdMS_TO_TICKS(isTx ? CfgTxSampleIntervalMs : CfgSampleIntervalMs));
+  }
+  LOG_INFO("Hardware monitor task stopped");
+  vTaskDelete(NULL);
+}
+
+bool HwMonitor::isTransmitting() const
+{
+  return txRadioTask_ && txRadioTask_->isTransmitting();
+}
+
+float HwMonitor::sampleVoltage() const
+{
+  // oversample in groups, median of group averages
+  uint32_t groupMv[CfgMedianGroups];
+  for (int group = 0; group < CfgMedianGroups; group++) {
+    uint32_t rawSum = 0;
+    for (int i = 0; i < CfgOversampleCount; i++) {
+      rawSum += analogRead(config_->BatteryMonPin_);
+    }
+    uint32_t mv = esp_adc_cal_raw_to_voltage(rawSum / CfgOversampleCount, &adcChars_);
+    int pos = group;
+    while (pos > 0 && groupMv[pos - 1] > mv) {
+      groupMv[pos] = groupMv[pos - 1];
+      pos--;
+    }
+    groupMv[pos] = mv;
+  }
+  return CfgDividerRatio * groupMv[CfgMedianGroups / 2] / 1000.0f;
+}
+
 float HwMonitor::getBatteryVoltage() const
 {
-  int bat_value = analogRead(config_->BatteryMonPin_);
-  return 2 * bat_value * (3.3 / 4096.0) + config_->BatteryMonCal;
+  return restingVoltage_ + config_->BatteryMonCal;
+}
+
+float HwMonitor::getLoadVoltage() const
+{
+  return loadVoltage_ == 0 ? getBatteryVoltage() : loadVoltage_ + config_->BatteryMonCal;
+}
+
+float HwMonitor::getSagVoltage() const
+{
+  return loadVoltage_ == 0 ? 0 : restingVoltage_ - loadVoltage_;
+}
+
+float HwMonitor::getBatteryPercent() const
+{
+  return getVoltagePercent(getBatteryVoltage());
+}
+
+float HwMonitor::getVoltagePercent(float voltage)
+{
+  // typical li-ion discharge curve at low current
+  static const float curve[][2] = {
+    { 3.30f, 0 }, { 3.60f, 5 }, { 3.70f, 12 }, { 3.75f, 25 }, { 3.80f, 40 }, { 3.85f, 55 },
+    { 3.90f, 65 }, { 3.95f, 72 }, { 4.00f, 80 }, { 4.10f, 90 }, { 4.20f, 100 }
+  };
+  static const int points = sizeof(curve) / sizeof(curve[0]);
+  if (voltage <= curve[0][0]) return 0;
+  for (int i = 1; i < points; i++) {
+    if (voltage < curve[i][0]) {
+      float k = (voltage - curve[i - 1][0]) / (curve[i][0] - curve[i - 1][0]);
+      return curve[i - 1][1] + k * (curve[i][1] - curve[i - 1][1]);
+    }
+  }
+  return 100;
 }
 
-} // LoraDv
\ No newline at end of file
+} // LoraDv
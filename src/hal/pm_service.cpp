@@ -1,32 +1,72 @@
 #include "hal/pm_service.h"
+#include "hal/hw_monitor.h"
+#include "hal/radio_task.h"
+#include "audio/audio_task.h"
 
 namespace LoraDv {
 
-PmService::PmService(std::shared_ptr<const Config> config, std::shared_ptr<Adafruit_SSD1306> display) 
+PmService::PmService(std::shared_ptr<const Config> config, std::shared_ptr<Adafruit_SSD1306> display)
   : config_(config)
   , display_(display)
-  , lightSleepTimerTask_(0)
-  , isExitFromSleep_(false)
+  , state_(State::Active)
+  , stateSinceMs_(0)
+  , lastActivityMs_(0)
+  , startMs_(0)
+  , nextEstimateMs_(0)
+  , residencyMs_{}
+  , estimate_{}
 {
   lightSleepReset();
-}   
+}
+
+void PmService::start(std::shared_ptr<AudioTask> audioTask, std::shared_ptr<RadioTask> rxRadioTask,
+  std::shared_ptr<HwMonitor> hwMonitor)
+{
+  audioTask_ = audioTask;
+  rxRadioTask_ = rxRadioTask;
+  hwMonitor_ = hwMonitor;
+
+  // coulomb count starts from the resting voltage
+  startMs_ = millis();
+  stateSinceMs_ = startMs_;
+  nextEstimateMs_ = startMs_ + CfgEstimateIntervalMs;
+  estimate_.voltage = hwMonitor_->getBatteryVoltage();
+  estimate_.percent = estimate_.voltage < CfgMinBatteryVoltage ? 100.0f : hwMonitor_->getBatteryPercent();
+  LOG_INFO("Battery", estimate_.voltage, "V", estimate_.percent, "%");
+  updateCpuFrequency();
+}
 
-void PmService::lightSleepReset() 
+void PmService::lightSleepReset()
 {
   LOG_DEBUG("Reset light sleep");
-  if (lightSleepTimerTask_ != 0) {
-    lightSleepTimer_.cancel(lightSleepTimerTask_);
-  }
-  lightSleepTimerTask_ = lightSleepTimer_.in(config_->PmSleepAfterMs, lightSleepEnterTimer, this);
+  lastActivityMs_ = millis();
 }
 
-bool PmService::lightSleepEnterTimer(void *param) 
+void PmService::setState(State state)
 {
-  static_cast<PmService*>(param)->lightSleepEnter();
-  return false;
+  if (state == state_) return;
+  accountResidency(millis());
+  LOG_INFO("Power state", (int)state_, "->", (int)state);
+  state_ = state;
+
+  switch (state) {
+    case State::Active:
+      if (rxRadioTask_) rxRadioTask_->setRxDutyCycle(false);
+      display_->dim(false);
+      break;
+    case State::Idle:
+      display_->dim(true);
+      break;
+    case State::Sleep:
+      if (rxRadioTask_ && isRxDutyCycleSupported()) rxRadioTask_->setRxDutyCycle(true);
+      break;
+    case State::DeepSleep:
+      break;
+  }
+  updateCpuFrequency();
 }
 
-void PmService::lightSleepEnter(void) 
+void PmService::lightSleepEnter(void)
 {
   LOG_INFO("Entering light sleep");
 
@@ -43,47 +83,199 @@ void PmService::lightSleepEnter(void)
   setCpuFrequencyMhz(CfgMinCpuFrequencyMhz);
 #endif
   // enter polling sleep with periodic wakeup to avoid battery boost controller going into off mode
+  uint32_t sleepStartMs = millis();
+  uint32_t sleepActivityMs = lastActivityMs_;
   esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
   while (true) {
     wakeupCause = lightSleepWait(config_->PmLightSleepDurationMs_ * 1000UL);
     if (wakeupCause != ESP_SLEEP_WAKEUP_TIMER) break;
+    if (config_->PmDeepSleepAfterMs_ > 0 && millis() - sleepStartMs >= (uint32_t)config_->PmDeepSleepAfterMs_) {
+      setState(State::DeepSleep);
+      deepSleepEnter();
+    }
     delay(config_->PmLightSleepAwakeMs_);
+    // packet arrived and started playing while awake between sleeps
+    if (lastActivityMs_ != sleepActivityMs) break;
   }
 
 #if CFG_PM_OPTIMIZE_SLEEP == true
   // restore frequency
   setCpuFrequencyMhz(savedCpuFrequencyMhz);
-
+#endif
+  // radio and audio are served first, ui is restored afterwards
+  if (wakeupCause == ESP_SLEEP_WAKEUP_EXT1) {
+    rxRadioTask_->wakeup();
+    audioTask_->wakeup();
+  }
+#if CFG_PM_OPTIMIZE_SLEEP == true
   // start display
   display_->display();
   display_->ssd1306_command(SSD1306_DISPLAYON);
 #endif
-  LOG_INFO("Exiting light sleep");
-  isExitFromSleep_ = true;
+  LOG_INFO("Exiting light sleep, cause", (int)wakeupCause);
 }
 
-esp_sleep_wakeup_cause_t PmService::lightSleepWait(uint64_t sleepTimeUs) const
+void PmService::deepSleepEnter()
+{
+  LOG_INFO("Entering deep sleep");
+  display_->ssd1306_command(SSD1306_DISPLAYOFF);
+
+  // radio stays in receive, keep its control pins, board reboots on wakeup
+  gpio_deep_sleep_hold_en();
+  setupWakeup();
+  esp_deep_sleep_start();
+}
+
+void PmService::setupWakeup() const
 {
   esp_sleep_enable_ext0_wakeup((gpio_num_t)config_->PttBtnPin_, LOW);
-  uint64_t bitMask = (uint64_t)(1 << config_->LoraPinA_);
+  uint64_t bitMask = (uint64_t)1 << config_->LoraPinA_;
+  if (config_->Lora2Mode_ != CFG_LORA2_MODE_NONE)
+    bitMask |= (uint64_t)1 << config_->Lora2PinA_;
 #ifdef USE_SX126X
   // NOTE, not needed, but could be useful to wakeup and indicate activity on the band
-  //bitMask |= (int64_t)(1 << config_->LoraPinB_);
+  //bitMask |= (uint64_t)1 << config_->LoraPinB_;
 #endif
   esp_sleep_enable_ext1_wakeup(bitMask, ESP_EXT1_WAKEUP_ANY_HIGH);
+}
+
+void PmService::restoreWakeupPins() const
+{
+  // wakeup sources are switched to rtc io, move them back to gpio, so interrupts work again
+  rtc_gpio_deinit((gpio_num_t)config_->PttBtnPin_);
+  rtc_gpio_deinit((gpio_num_t)config_->LoraPinA_);
+  if (config_->Lora2Mode_ != CFG_LORA2_MODE_NONE)
+    rtc_gpio_deinit((gpio_num_t)config_->Lora2PinA_);
+}
+
+esp_sleep_wakeup_cause_t PmService::lightSleepWait(uint64_t sleepTimeUs) const
+{
+  setupWakeup();
   esp_sleep_enable_timer_wakeup(sleepTimeUs);
   esp_light_sleep_start();
+  restoreWakeupPins();
   return esp_sleep_get_wakeup_cause();
 }
 
+bool PmService::isRxDutyCycleSupported() const
+{
+#ifdef USE_SX126X
+  return config_->ModType == CFG_MOD_TYPE_LORA && !config_->ScanEnabled;
+#else
+  return false;
+#endif
+}
+
+uint32_t PmService::getTargetCpuFrequencyMhz() const
+{
+  if (state_ != State::Active) return config_->PmIdleCpuMhz_;
+  // not measured yet, stay at maximum until codec runs
+  uint32_t codecLoad = audioTask_ ? audioTask_->getStats().codecLoad : 0;
+  if (codecLoad == 0) return CfgMaxCpuFrequencyMhz;
+  if (codecLoad * CfgMaxCpuFrequencyMhz <= CfgMaxCodecLoad * CfgMinCpuFrequencyMhz) return CfgMinCpuFrequencyMhz;
+  if (codecLoad * CfgMaxCpuFrequencyMhz <= CfgMaxCodecLoad * CfgMidCpuFrequencyMhz) return CfgMidCpuFrequencyMhz;
+  return CfgMaxCpuFrequencyMhz;
+}
+
+void PmService::updateCpuFrequency()
+{
+  if (!config_->PmDvfsEnabled_ || state_ == State::Sleep || state_ == State::DeepSleep) return;
+  uint32_t cpuFrequencyMhz = getTargetCpuFrequencyMhz();
+  if (cpuFrequencyMhz == getCpuFrequencyMhz()) return;
+  LOG_INFO("Cpu frequency", cpuFrequencyMhz, "MHz");
+  setCpuFrequencyMhz(cpuFrequencyMhz);
+}
+
+int PmService::getStateCurrentMa(State state) const
+{
+  switch (state) {
+    case State::Active: return config_->PmActiveMa_;
+    case State::Idle: return config_->PmIdleMa_;
+    default: return isRxDutyCycleSupported() ? config_->PmSleepDutyMa_ : config_->PmSleepMa_;
+  }
+}
+
+void PmService::accountResidency(uint32_t nowMs)
+{
+  uint32_t durationMs = nowMs - stateSinceMs_;
+  stateSinceMs_ = nowMs;
+  residencyMs_[(int)state_] += durationMs;
+
+  // coulomb count from modelled current of the state
+  float usedMah = getStateCurrentMa(state_) * durationMs / 3600000.0f;
+  estimate_.usedMah += usedMah;
+  estimate_.percent -= 100.0f * usedMah / config_->PmBatteryMah_;
+}
+
+void PmService::updateEstimate(uint32_t nowMs)
+{
+  accountResidency(nowMs);
+
+  // resting voltage is still affected by load, only trust it when idle and only correct the count slowly
+  estimate_.voltage = hwMonitor_->getBatteryVoltage();
+  if (state_ != State::Active && estimate_.voltage >= CfgMinBatteryVoltage) {
+    estimate_.percent += CfgVoltageWeight * (hwMonitor_->getBatteryPercent() - estimate_.percent);
+  }
+  estimate_.percent = constrain(estimate_.percent, 0.0f, 100.0f);
+
+  float remainingMah = estimate_.percent * config_->PmBatteryMah_ / 100.0f;
+  uint32_t elapsedMs = nowMs - startMs_;
+  estimate_.averageMa = elapsedMs > 0 ? estimate_.usedMah * 3600000.0f / elapsedMs : config_->PmActiveMa_;
+  estimate_.remainingHours = estimate_.averageMa > 0 ? remainingMah / estimate_.averageMa : 0;
+  estimate_.standbyHours = remainingMah / getStateCurrentMa(State::Sleep);
+
+  float totalMs = max(elapsedMs, (uint32_t)1);
+  LOG_INFO("Battery", estimate_.voltage, "V", "tx sag", hwMonitor_->getSagVoltage(), "V",
+    estimate_.percent, "%", estimate_.averageMa, "mA",
+    "remaining", estimate_.remainingHours, "h", "standby", estimate_.standbyHours, "h");
+  LOG_INFO("Residency active", 100.0f * residencyMs_[(int)State::Active] / totalMs,
+    "idle", 100.0f * residencyMs_[(int)State::Idle] / totalMs,
+    "sleep", 100.0f * residencyMs_[(int)State::Sleep] / totalMs, "%");
+}
+
+uint32_t PmService::getLoopTimeoutMs() const
+{
+  if (!hwMonitor_) return EventNotifier::CfgWaitForever;
+  uint32_t nowMs = millis();
+  uint32_t idleMs = nowMs - lastActivityMs_;
+  uint32_t sleepAfterMs = config_->PmSleepAfterMs;
+  uint32_t timeoutMs = idleMs >= sleepAfterMs ? 0 : sleepAfterMs - idleMs;
+  if (state_ == State::Active && config_->PmDimAfterMs_ > 0) {
+    uint32_t dimAfterMs = config_->PmDimAfterMs_;
+    timeoutMs = min(timeoutMs, idleMs >= dimAfterMs ? 0 : dimAfterMs - idleMs);
+  }
+  uint32_t estimateMs = (int32_t)(nextEstimateMs_ - nowMs) <= 0 ? 0 : nextEstimateMs_ - nowMs;
+  return min(timeoutMs, estimateMs);
+}
+
 bool PmService::loop()
 {
-  lightSleepTimer_.tick();
-  bool isExitFromSleep = isExitFromSleep_;
-  isExitFromSleep_ = false;
-  if (isExitFromSleep)
+  // not started yet
+  if (!hwMonitor_) return false;
+
+  bool isExitFromSleep = false;
+  uint32_t idleMs = millis() - lastActivityMs_;
+  if (idleMs >= (uint32_t)config_->PmSleepAfterMs) {
+    setState(State::Sleep);
+    nextEstimateMs_ = millis() + CfgEstimateIntervalMs;
+    updateEstimate(millis());
+    lightSleepEnter();
     lightSleepReset();
+    setState(State::Active);
+    isExitFromSleep = true;
+  } else if (config_->PmDimAfterMs_ > 0 && idleMs >= (uint32_t)config_->PmDimAfterMs_) {
+    setState(State::Idle);
+  } else {
+    setState(State::Active);
+    updateCpuFrequency();
+  }
+
+  uint32_t nowMs = millis();
+  if ((int32_t)(nowMs - nextEstimateMs_) >= 0) {
+    nextEstimateMs_ = nowMs + CfgEstimateIntervalMs;
+    updateEstimate(nowMs);
+  }
   return isExitFromSleep;
 }
 
-} // LoraDv
\ No newline at end of file
+} // LoraDv
@@ -0,0 +1,182 @@
+#include "hal/radio_queue.h"
+
+namespace LoraDv {
+
+RadioQueue::RadioQueue()
+  : head_(0)
+  , tail_(0)
+  , count_(0)
+  , writeOffset_(0)
+  , usedBytes_(0)
+  , reservedOffset_(-1)
+  , reservedSize_(0)
+  , dropped_(0)
+{
+}
+
+int RadioQueue::findSpace(int packetSize) const
+{
+  if (packetSize <= 0 || packetSize > CfgDataLen || count_ == CfgSlotsLen) return -1;
+  if (count_ == 0) return 0;
+
+  int readOffset = slots_[tail_].offset;
+  if (writeOffset_ > readOffset) {
+    // not wrapped, use tail of the buffer or wrap to the beginning
+    if (CfgDataLen - writeOffset_ >= packetSize) return writeOffset_;
+    if (readOffset >= packetSize) return 0;
+  } else {
+    // wrapped, free space is between newest and oldest packet
+    if (readOffset - writeOffset_ >= packetSize) return writeOffset_;
+  }
+  return -1;
+}
+
+bool RadioQueue::push(const byte *packetBuf, int packetSize, float rssi, float snr, uint8_t flags)
+{
+  // space lookup, copy and commit are done at once, so concurrent producers do not overlap
+  portENTER_CRITICAL(&lock_);
+  int offset = findSpace(packetSize);
+  if (offset >= 0) {
+    memcpy(data_ + offset, packetBuf, packetSize);
+    slots_[head_] = { (uint16_t)offset, (uint16_t)packetSize, rssi, snr, flags };
+    head_ = (head_ + 1) % CfgSlotsLen;
+    count_++;
+    usedBytes_ += packetSize;
+    writeOffset_ = offset + packetSize;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return offset >= 0;
+}
+
+int RadioQueue::pop(byte *packetBuf, int maxPacketSize, Packet *packet)
+{
+  int packetSize = 0;
+  portENTER_CRITICAL(&lock_);
+  if (count_ > 0) {
+    const Packet &slot = slots_[tail_];
+    packetSize = slot.size;
+    if (packetSize <= maxPacketSize) {
+      memcpy(packetBuf, data_ + slot.offset, packetSize);
+    } else {
+      // too large packet is skipped, packet boundaries are always preserved
+      packetSize = -1;
+    }
+    if (packet != nullptr) *packet = slot;
+    usedBytes_ -= slot.size;
+    tail_ = (tail_ + 1) % CfgSlotsLen;
+    count_--;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return packetSize;
+}
+
+byte *RadioQueue::reserve(int packetSize)
+{
+  portENTER_CRITICAL(&lock_);
+  reservedOffset_ = findSpace(packetSize);
+  reservedSize_ = packetSize;
+  int offset = reservedOffset_;
+  portEXIT_CRITICAL(&lock_);
+  return offset < 0 ? nullptr : data_ + offset;
+}
+
+bool RadioQueue::commit(int packetSize, float rssi, float snr, uint8_t flags)
+{
+  bool isCommitted = false;
+  portENTER_CRITICAL(&lock_);
+  // larger packet than reserved could overwrite unread packets, it is dropped with the reservation
+  if (reservedOffset_ >= 0 && packetSize > 0 && packetSize <= reservedSize_) {
+    slots_[head_] = { (uint16_t)reservedOffset_, (uint16_t)packetSize, rssi, snr, flags };
+    head_ = (head_ + 1) % CfgSlotsLen;
+    count_++;
+    usedBytes_ += packetSize;
+    writeOffset_ = reservedOffset_ + packetSize;
+    isCommitted = true;
+  }
+  reservedOffset_ = -1;
+  portEXIT_CRITICAL(&lock_);
+  return isCommitted;
+}
+
+const byte *RadioQueue::peek(Packet &packet)
+{
+  const byte *packetData = nullptr;
+  portENTER_CRITICAL(&lock_);
+  if (count_ > 0) {
+    packet = slots_[tail_];
+    packetData = data_ + packet.offset;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return packetData;
+}
+
+void RadioQueue::release()
+{
+  portENTER_CRITICAL(&lock_);
+  if (count_ > 0) {
+    usedBytes_ -= slots_[tail_].size;
+    tail_ = (tail_ + 1) % CfgSlotsLen;
+    count_--;
+  }
+  portEXIT_CRITICAL(&lock_);
+}
+
+bool RadioQueue::dropOldest()
+{
+  bool isDropped = false;
+  portENTER_CRITICAL(&lock_);
+  if (count_ > 0) {
+    usedBytes_ -= slots_[tail_].size;
+    tail_ = (tail_ + 1) % CfgSlotsLen;
+    count_--;
+    dropped_++;
+    isDropped = true;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return isDropped;
+}
+
+void RadioQueue::countDropped()
+{
+  portENTER_CRITICAL(&lock_);
+  dropped_++;
+  portEXIT_CRITICAL(&lock_);
+}
+
+void RadioQueue::clear()
+{
+  portENTER_CRITICAL(&lock_);
+  head_ = tail_ = count_ = 0;
+  writeOffset_ = usedBytes_ = 0;
+  reservedOffset_ = -1;
+  portEXIT_CRITICAL(&lock_);
+}
+
+bool RadioQueue::hasData() const
+{
+  return count_ > 0;
+}
+
+int RadioQueue::size() const
+{
+  return count_;
+}
+
+uint32_t RadioQueue::getDroppedCount() const
+{
+  portENTER_CRITICAL(&lock_);
+  uint32_t dropped = dropped_;
+  portEXIT_CRITICAL(&lock_);
+  return dropped;
+}
+
+int RadioQueue::load() const
+{
+  portENTER_CRITICAL(&lock_);
+  int dataLoad = 100 * usedBytes_ / CfgDataLen;
+  int slotsLoad = 100 * count_ / CfgSlotsLen;
+  portEXIT_CRITICAL(&lock_);
+  return max(dataLoad, slotsLoad);
+}
+
+} // LoraDv
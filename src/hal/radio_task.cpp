@@ -2,32 +2,168 @@
 
 namespace LoraDv {
 
-volatile bool RadioTask::isIsrEnabled_ = true;
-TaskHandle_t RadioTask::loraTaskHandle_;
+RadioTask *RadioTask::instances_[RadioTask::CfgMaxModules] = { nullptr, nullptr };
+void (* const RadioTask::isrHandlers_[RadioTask::CfgMaxModules])() = {
+  &RadioTask::onRigIsrRxPacket<0>,
+  &RadioTask::onRigIsrRxPacket<1>
+};
 
-RadioTask::RadioTask(std::shared_ptr<const Config> config)
+RadioTask::RadioTask(std::shared_ptr<const Config> config, std::shared_ptr<EventNotifier> eventNotifier, 
+    std::shared_ptr<DataLink> dataLink, std::shared_ptr<PrivacyStore> privacyStore, std::shared_ptr<MemoryArena> arena, 
+    int moduleId, Role role)
   : config_(config)
+  , eventNotifier_(eventNotifier)
+  , dataLink_(dataLink)
+  , privacyStore_(privacyStore)
+  , arena_(arena)
+  , moduleId_(moduleId)
+  , role_(role)
   , radioModule_(nullptr)
+  , moduleStorage_(nullptr)
+  , radioStorage_(nullptr)
+  , packetBuf_(nullptr)
+  , tmpBuf_(nullptr)
   , audioTask_(nullptr)
+  , repeaterRadioTask_(nullptr)
   , cipher_(new ChaChaPoly())
+  , replayFilter_(privacyStore)
+  , privacyKeyId_(0)
+  , senderId_(0)
+  , txEpoch_(0)
+  , txSeq_(0)
+  , lastRxSenderId_(0)
+  , lastRxEpoch_(0)
+  , lastRxSeq_(0)
+  , isCallsignValid_(false)
+  , lastCallsignTxMs_(0)
+  , heardCallsign_{}
+  , fec_(nullptr)
+  , m17Framer_(nullptr)
+  , isM17StreamStarted_(false)
+  , rxFreq_(config->LoraFreqRx)
+  , txFreq_(config->LoraFreqTx)
+  , loraBw_(0)
+  , loraSf_(0)
+  , tunedFreq_(0)
+  , tunedBw_(0)
+  , tunedSf_(0)
+  , scanChannelId_(-1)
+  , scanHoldUntilMs_(0)
+  , isScanning_(false)
+  , isRxDutyCycle_(false)
+  , isRxDutyCycleActive_(false)
+  , isWakeupPending_(false)
+  , lastVoiceQueuedMs_(0)
+  , voicePeriodMs_(0)
+  , rxPendingPackets_(0)
+  , rxPendingSinceMs_(0)
+  , loraTaskHandle_(0)
   , isImplicitMode_(false)
   , isIsrInstalled_(false)
+  , isIsrEnabled_(false)
+  , isTransmitting_(false)
   , isRunning_(false)
   , shouldUpdateScreen_(false)
   , lastRssi_(0)
+  , lastSnr_(0)
+  , stats_{}
+  , lastLoggedStats_{}
+  , lastStatsLogMs_(0)
 {
+  setupPins();
+  if (isM17Mode()) {
+    m17Framer_ = std::make_shared<M17Framer>();
+  } else {
+    setupFec();
+  }
+}
+
+void RadioTask::setupPins()
+{
+  if (moduleId_ == 1) {
+    pins_ = { config_->Lora2PinSs_, config_->Lora2PinRst_, config_->Lora2PinA_, 
+      config_->Lora2PinB_, config_->Lora2PinSwitchRx_, config_->Lora2PinSwitchTx_ };
+  } else {
+    pins_ = { config_->LoraPinSs_, config_->LoraPinRst_, config_->LoraPinA_, 
+      config_->LoraPinB_, config_->LoraPinSwitchRx_, config_->LoraPinSwitchTx_ };
+  }
+}
+
+void RadioTask::setupFec()
+{
+  // frame bits could only be told apart in plain codec2 packets
+  int frameSize, sensitiveOffset, sensitiveBits;
+  if (config_->UepEnabled) {
+    if (config_->AudioCodec == CFG_AUDIO_CODEC_CODEC2 && !config_->AudioEnPriv
+      && AudioCodecCodec2::getSensitiveBits(config_->AudioCodec2Mode, frameSize, sensitiveOffset, sensitiveBits)) {
+      fec_ = std::make_shared<FecUep>(frameSize, sensitiveOffset, sensitiveBits, &RadioTask::getPacketHeaderSize);
+      return;
+    }
+    LOG_ERROR("UEP needs Codec2 without privacy, disabled");
+  }
+  if (config_->ModType != CFG_MOD_TYPE_FSK) return;
+  if (config_->FskFec == CFG_FSK_FEC_GOLAY)
+    fec_ = std::make_shared<FecGolay>();
+  else if (config_->FskFec == CFG_FSK_FEC_CONV)
+    fec_ = std::make_shared<FecConv>();
 }
 
-void RadioTask::start(std::shared_ptr<AudioTask> audioTask)
+int RadioTask::getPacketHeaderSize(const byte *packetBuf, int packetSize)
 {
+  // data packets have no codec frames, so they are protected as a whole
+  if ((packetBuf[0] & CfgPacketTypeMask) != CfgPacketTypeVoice) return packetSize;
+  return CfgPacketHeaderSize + ((packetBuf[0] & CfgPacketFlagAx25) ? Ax25::CfgHeaderSize : 0);
+}
+
+void RadioTask::start(std::shared_ptr<AudioTask> audioTask, std::shared_ptr<RadioTask> repeaterRadioTask)
+{
+  if (moduleId_ < 0 || moduleId_ >= CfgMaxModules || instances_[moduleId_] != nullptr) {
+    LOG_ERROR("Radio module id is invalid or already in use", moduleId_);
+    return;
+  }
+  // allocated here and not in the task, arena is only used from setup
+  moduleStorage_ = arena_->allocate(sizeof(Module), alignof(Module));
+  radioStorage_ = arena_->allocate(sizeof(MODULE_NAME), alignof(MODULE_NAME));
+  packetBuf_ = arena_->allocateArray<byte>(CfgPacketBufSize);
+  tmpBuf_ = arena_->allocateArray<byte>(CfgTmpBufSize);
+  if (!moduleStorage_ || !radioStorage_ || !packetBuf_ || !tmpBuf_) return;
+  instances_[moduleId_] = this;
   audioTask_ = audioTask;
-  cipher_->setKey(config_->AudioPrivacyKey_, sizeof(config_->AudioPrivacyKey_));
-  xTaskCreatePinnedToCore(&task, "RadioTask", CfgRadioTaskStack, this, CfgTaskPriority, &loraTaskHandle_, CfgCoreId);
+  if (repeaterRadioTask.get() != this) repeaterRadioTask_ = repeaterRadioTask;
+  for (int keyId = 0; keyId < CfgKeySlots; keyId++) {
+    isPrivacyKeySet_[keyId] = false;
+    if (config_->IsPrivacyKeySet(keyId)) {
+      byte key[sizeof(config_->AudioPrivacyKeys_[keyId])];
+      config_->GetPrivacyKey(keyId, key);
+      setPrivacyKey(keyId, key);
+    }
+  }
+  if (!setPrivacyKeyId(config_->AudioPrivKeyId)) {
+    LOG_ERROR("Privacy key slot is not set, using slot 0", config_->AudioPrivKeyId);
+    setPrivacyKeyId(0);
+  }
+  // sequence starts from 0 in every boot epoch, module id keeps second module nonces apart
+  senderId_ = privacyStore_->getDeviceId() + moduleId_;
+  txEpoch_ = privacyStore_->getEpoch();
+  txSeq_ = 0;
+  if (config_->CallsignEnabled && canTransmit()) {
+    isCallsignValid_ = Ax25::encodeHeader(CfgCallsignDest, config_->Callsign, callsignHeader_);
+    if (!isCallsignValid_) LOG_ERROR("Invalid callsign, transmissions are not tagged", config_->Callsign);
+  }
+  if (m17Framer_) {
+    uint16_t type = config_->AudioCodec2Mode == CODEC2_MODE_1600 ? M17Framer::CfgTypeVoiceData : M17Framer::CfgTypeVoice;
+    if (!m17Framer_->setLsf(CfgM17Dest, config_->Callsign, type)) {
+      LOG_ERROR("Invalid callsign for M17", config_->Callsign);
+    }
+  }
+  char taskName[configMAX_TASK_NAME_LEN];
+  snprintf(taskName, sizeof(taskName), "RadioTask%d", moduleId_);
+  xTaskCreatePinnedToCore(&task, taskName, CfgRadioTaskStack, this, CfgTaskPriority, &loraTaskHandle_, CfgCoreId);
 }
 
 void RadioTask::setupRig(long loraFreq, long bw, int sf, int cr, int pwr, int sync, int crcBytes)
 {
-  LOG_INFO("Initializing LoRa");
+  LOG_INFO("Initializing LoRa, module", moduleId_);
   LOG_INFO("Frequency:", loraFreq, "Hz");
   LOG_INFO("Bandwidth:", bw, "Hz");
   LOG_INFO("Spreading:", sf);
@@ -37,59 +173,80 @@ void RadioTask::setupRig(long loraFreq, long bw, int sf, int cr, int pwr, int sy
   LOG_INFO("CRC:", crcBytes);
   LOG_INFO("Speed:", Utils::loraGetSpeed(sf, cr, bw), "bps");
   LOG_INFO("Min level:", Utils::loraGetSnrLimit(sf, bw));
-  radioModule_ = std::make_shared<MODULE_NAME>(new Module(config_->LoraPinSs_, config_->LoraPinA_, config_->LoraPinRst_, config_->LoraPinB_));
+  // damaged packets are passed to fec instead of being dropped by the radio
+  if (fec_) LOG_INFO("FEC:", fec_->getName());
+  setupRigModule();
   int state = radioModule_->begin((float)loraFreq / 1e6, (float)bw / 1e3, sf, cr, sync, pwr);
   if (state != RADIOLIB_ERR_NONE) {
     LOG_ERROR("Radio start error:", state);
   }
   radioModule_->setCRC(crcBytes);
   radioModule_->setPreambleLength(config_->LoraPreambleLen_);
-#ifdef USE_SX126X
-    #pragma message("Using SX126X")
-    LOG_INFO("Using SX126X module");
-    radioModule_->setRfSwitchPins(config_->LoraPinSwitchRx_, config_->LoraPinSwitchTx_);
-    if (isIsrInstalled_) radioModule_->clearDio1Action();
-    radioModule_->setDio1Action(onRigIsrRxPacket);
-    isIsrInstalled_ = true;
-#else
-    #pragma message("Using SX127X")
-    LOG_INFO("Using SX127X module");
-    if (isIsrInstalled_) radioModule_->clearDio0Action();
-    radioModule_->setDio0Action(onRigIsrRxPacket, RISING);
-    isIsrInstalled_ = true;
-#endif
+  setupRigIsr();
   radioModule_->explicitHeader();
   LOG_INFO("LoRa initialized");
 }
 
+void RadioTask::setupRigModule()
+{
+  // driver objects live in the arena for the whole uptime, only destructor is run on release
+  Module *module = new (moduleStorage_) Module(pins_.ss, pins_.a, pins_.rst, pins_.b);
+  radioModule_ = std::shared_ptr<MODULE_NAME>(new (radioStorage_) MODULE_NAME(module),
+    [](MODULE_NAME *radio) { radio->~MODULE_NAME(); });
+}
+
 void RadioTask::setupRigFsk(long freq, float bitRate, float freqDev, float rxBw, int pwr, byte shaping)
 {
-  LOG_INFO("Initializing FSK");
+  LOG_INFO("Initializing FSK, module", moduleId_);
   LOG_INFO("Frequency:", freq, "Hz");
   LOG_INFO("Bit rate:", bitRate, "kbps");
   LOG_INFO("Deviation:", freqDev, "kHz");
   LOG_INFO("Bandwidth:", rxBw, "kHz");
   LOG_INFO("Power:", pwr, "dBm");
   LOG_INFO("Shaping:", shaping);
-  radioModule_ = make_shared<MODULE_NAME>(new Module(config_->LoraPinSs_, config_->LoraPinA_, config_->LoraPinRst_, config_->LoraPinB_));
+  setupRigModule();
   int state = radioModule_->beginFSK((float)freq / 1e6, bitRate, freqDev, rxBw, pwr);
   if (state != RADIOLIB_ERR_NONE) {
     LOG_ERROR("Radio start error:", state);
   }
   radioModule_->setDataShaping(shaping);
+  // damaged packets are passed to fec instead of being dropped by the radio
+  if (fec_) {
+    LOG_INFO("FEC:", fec_->getName());
+    radioModule_->setCRC(0);
+  }
+  setupRigIsr();
+  if (m17Framer_) {
+    // every frame must be on air before the next one is ready
+    float frameMs = radioModule_->getTimeOnAir(M17Framer::CfgFrameSize) / 1000.0f;
+    LOG_INFO("M17 frame airtime:", frameMs, "ms");
+    if (frameMs > M17Framer::CfgFrameMs) LOG_ERROR("Bit rate is too low for M17 stream", bitRate);
+  }
+  LOG_INFO("FSK initialized");
+}
+
+void RadioTask::setupRigIsr()
+{
 #ifdef USE_SX126X
+    #pragma message("Using SX126X")
     LOG_INFO("Using SX126X module");
-    radioModule_->setRfSwitchPins(config_->LoraPinSwitchRx_, config_->LoraPinSwitchTx_);
+    radioModule_->setRfSwitchPins(pins_.switchRx, pins_.switchTx);
     if (isIsrInstalled_) radioModule_->clearDio1Action();
-    radioModule_->setDio1Action(onRigIsrRxPacket);
+    radioModule_->setDio1Action(isrHandlers_[moduleId_]);
     isIsrInstalled_ = true;
 #else
+    #pragma message("Using SX127X")
     LOG_INFO("Using SX127X module");
     if (isIsrInstalled_) radioModule_->clearDio0Action();
-    radioModule_->setDio0Action(onRigIsrRxPacket, RISING);
+    radioModule_->setDio0Action(isrHandlers_[moduleId_], RISING);
     isIsrInstalled_ = true;
 #endif
-  LOG_INFO("FSK initialized");
+}
+
+long RadioTask::getFreq() const
+{
+  // dedicated tx module stays on tx frequency, others start on rx frequency
+  return role_ == Role::TxOnly ? config_->LoraFreqTx : config_->LoraFreqRx;
 }
 
 void RadioTask::setFreq(long loraFreq) const 
@@ -97,36 +254,128 @@ void RadioTask::setFreq(long loraFreq) const
   radioModule_->setFrequency((float)loraFreq / (float)1e6);
 }
 
-bool RadioTask::hasData() const 
+void RadioTask::tune(long freq, long bw, int sf)
 {
-  return radioRxQueue_.index.size() > 0;
+  // only changed parameters are sent to the module, so switching is cheap
+  if (freq != tunedFreq_) {
+    setFreq(freq);
+    tunedFreq_ = freq;
+  }
+  if (config_->ModType != CFG_MOD_TYPE_LORA) return;
+  if (bw != tunedBw_) {
+    radioModule_->setBandwidth((float)bw / 1e3);
+    tunedBw_ = bw;
+  }
+  if (sf != tunedSf_) {
+    radioModule_->setSpreadingFactor(sf);
+    tunedSf_ = sf;
+  }
 }
 
-bool RadioTask::readPacketSize(byte &packetSize)
+bool RadioTask::writePacket(const byte *packetBuf, int packetSize)
 {
-  if (!hasData()) return false;
-  packetSize = radioRxQueue_.index.shift();
+  if (packetSize <= 0 || packetSize > getMaxPacketSize()) return false;
+  if (!radioTxQueue_.push(packetBuf, packetSize)) return false;
+
+  // voice packets are queued at codec pace, so the next one could be predicted
+  uint32_t nowMs = millis();
+  uint32_t periodMs = nowMs - lastVoiceQueuedMs_;
+  if (isVoiceActive())
+    voicePeriodMs_ = voicePeriodMs_ == 0 ? periodMs : (3 * voicePeriodMs_ + periodMs) / 4;
+  else
+    voicePeriodMs_ = 0;
+  lastVoiceQueuedMs_ = nowMs;
   return true;
 }
 
-bool RadioTask::readNextByte(byte &b)
+const byte *RadioTask::readPacket(RadioQueue::Packet &packet)
+{
+  // only voice packets are queued, headers are not passed to audio, flags keep their size
+  const byte *packetData = radioRxQueue_.peek(packet);
+  if (packetData == nullptr) return nullptr;
+  packet.size -= packet.flags;
+  return packetData + packet.flags;
+}
+
+bool RadioTask::sendData(const byte *dataBuf, int dataSize)
 {
-  if (radioRxQueue_.data.size() == 0) return false;
-  b = radioRxQueue_.data.shift();
+  // M17 stream has no room for native data fragments
+  if (!canTransmit() || m17Framer_ || !dataLink_->send(dataBuf, dataSize)) return false;
+  transmit();
   return true;
 }
 
-bool RadioTask::writePacketSize(byte packetSize)
+bool RadioTask::dropOldestTxPacket()
 {
-  return radioTxQueue_.index.push(packetSize);
+  // called from producer tasks, drop is counted by the queue and picked up by this task
+  return radioTxQueue_.dropOldest();
 }
 
-bool RadioTask::writeNextByte(byte b) 
+bool RadioTask::repeatPacket(const byte *packetBuf, int packetSize)
 {
-  return radioTxQueue_.data.push(b);
+  // packet is already encrypted if privacy is enabled, so sent as is
+  if (packetSize <= 0 || packetSize > CfgRadioMaxPacketSize) return false;
+  if (!radioTxQueue_.push(packetBuf, packetSize, 0, 0, CfgPacketFlagRaw)) {
+    radioTxQueue_.countDropped();
+    return false;
+  }
+  transmit();
+  return true;
 }
 
+int RadioTask::getMaxPacketSize() const
+{
+  // one stream frame per packet, 1600 mode leaves half of the payload for data
+  if (m17Framer_) {
+    return config_->AudioCodec2Mode == CODEC2_MODE_1600 ? M17Framer::CfgPayloadSize / 2 : M17Framer::CfgPayloadSize;
+  }
+  // encrypted and fec encoded packet with type header must still fit into the radio packet
+  int maxPacketSize = fec_ ? fec_->getMaxDataSize(CfgRadioMaxPacketSize) : CfgRadioMaxPacketSize;
+  return config_->AudioEnPriv 
+    ? maxPacketSize - CfgPacketHeaderSize - CfgPrivacyOverhead 
+    : maxPacketSize - CfgPacketHeaderSize;
+}
+
+bool RadioTask::setPrivacyKey(int keyId, const byte *key)
+{
+  if (keyId < 0 || keyId >= CfgKeySlots) return false;
+  // all zero key clears the slot, same as Config::IsPrivacyKeySet
+  bool isSet = false;
+  for (size_t i = 0; i < CfgKeySize; i++) {
+    if (key[i] != 0) {
+      isSet = true;
+      break;
+    }
+  }
+  portENTER_CRITICAL(&privacyKeyLock_);
+  memcpy(privacyKeys_[keyId], key, CfgKeySize);
+  isPrivacyKeySet_[keyId] = isSet;
+  portEXIT_CRITICAL(&privacyKeyLock_);
+  if (isSet) {
+    LOG_INFO("Privacy key is set for slot", keyId);
+  } else {
+    LOG_INFO("Privacy key is cleared for slot", keyId);
+    if (privacyKeyId_ == keyId) setPrivacyKeyId(0);
+  }
+  return true;
+}
+
+bool RadioTask::setPrivacyKeyId(int keyId)
+{
+  if (keyId < 0 || keyId >= CfgKeySlots || !isPrivacyKeySet_[keyId]) return false;
+  privacyKeyId_ = keyId;
+  LOG_INFO("Privacy key slot for transmission", keyId);
+  return true;
+}
+
+template<int ModuleId>
 IRAM_ATTR void RadioTask::onRigIsrRxPacket() 
+{
+  RadioTask *radioTask = instances_[ModuleId];
+  if (radioTask != nullptr) radioTask->onRigIsr();
+}
+
+IRAM_ATTR void RadioTask::onRigIsr()
 {
   if (!isIsrEnabled_) return;
   BaseType_t xHigherPriorityTaskWoken;
@@ -148,6 +397,19 @@ void RadioTask::startReceive() const
   xTaskNotify(loraTaskHandle_, CfgRadioRxStartBit, eSetBits);
 }
 
+void RadioTask::setRxDutyCycle(bool isEnabled)
+{
+  if (isRxDutyCycle_ == isEnabled) return;
+  isRxDutyCycle_ = isEnabled;
+  xTaskNotify(loraTaskHandle_, CfgRadioRxDutyBit, eSetBits);
+}
+
+void RadioTask::wakeup()
+{
+  isWakeupPending_ = true;
+  xTaskNotify(loraTaskHandle_, CfgRadioWakeupBit, eSetBits);
+}
+
 void RadioTask::transmit() const
 {
   xTaskNotify(loraTaskHandle_, CfgRadioTxBit, eSetBits);
@@ -159,25 +421,55 @@ void RadioTask::rigTask()
   isRunning_ = true;
 
   if (config_->ModType == CFG_MOD_TYPE_LORA) {
-    setupRig(config_->LoraFreqRx, config_->LoraBw, config_->LoraSf, 
-      config_->LoraCodingRate, config_->LoraPower, config_->LoraSync_, config_->LoraCrc_);
+    setupRig(getFreq(), config_->LoraBw, config_->LoraSf, 
+      config_->LoraCodingRate, config_->LoraPower, config_->LoraSync_, fec_ ? 0 : config_->LoraCrc_);
   } else {
-    setupRigFsk(config_->LoraFreqRx, config_->FskBitRate, config_->FskFreqDev,
+    setupRigFsk(getFreq(), config_->FskBitRate, config_->FskFreqDev,
       config_->FskRxBw, config_->LoraPower, config_->FskShaping);
   }
 
+  rxFreq_ = config_->LoraFreqRx;
+  txFreq_ = config_->LoraFreqTx;
+  loraBw_ = tunedBw_ = config_->LoraBw;
+  loraSf_ = tunedSf_ = config_->LoraSf;
+  tunedFreq_ = getFreq();
+
+  // channel activity detection is lora only
+  isScanning_ = config_->ScanEnabled && canReceive() && config_->ModType == CFG_MOD_TYPE_LORA;
+  if (isScanning_) {
+    // packet start is caught if all channels are checked within the preamble
+    float cycleMs = 0;
+    for (int channelId = 0; channelId < CFG_CHANNELS_COUNT; channelId++) {
+      const Channel &channel = config_->Channels_[channelId];
+      if (channel.isEmpty() || !channel.isLora()) continue;
+      cycleMs += CfgScanCadSymbols * Utils::loraGetSymbolMs(channel.getLoraSf(), channel.getLoraBw());
+    }
+    float preambleMs = config_->LoraPreambleLen_ * Utils::loraGetSymbolMs(loraSf_, loraBw_);
+    LOG_INFO("Scan cycle:", cycleMs, "ms, preamble:", preambleMs, "ms");
+  }
+
   int32_t seed = radioModule_->random(0x7FFFFFFF);
   LOG_INFO("Random seed:", String(seed, HEX));
   randomSeed(seed);
 
   rigTaskStartReceive();
 
-  byte *packetBuf = new byte[CfgRadioPacketBufLen];
-  byte *tmpBuf = new byte[CfgRadioPacketBufLen + CfgIvSize + CfgAuthTagSize];
+  // room for callsign header in front of the payload
+  byte *packetBuf = packetBuf_;
+  byte *tmpBuf = tmpBuf_;
 
   while (isRunning_) {
     uint32_t cmdBits = 0;
-    xTaskNotifyWaitIndexed(0, 0x00, ULONG_MAX, &cmdBits, portMAX_DELAY);
+    if (xTaskNotifyWaitIndexed(0, 0x00, ULONG_MAX, &cmdBits, rigTaskWaitTicks()) != pdTRUE) {
+      // batch deadline is reached, wake up audio even if batch is not complete
+      rigTaskNotifyAudio();
+      // voice over is completed, send remaining data
+      if (canTransmit() && dataLink_->hasFragments() && !isVoiceActive()) rigTaskTransmit(packetBuf, tmpBuf);
+      // nothing to do, check next memory channel
+      if (isScanActive()) rigTaskScan();
+      publishStats();
+      continue;
+    }
 
     LOG_DEBUG("Radio task bits", cmdBits);
     if (cmdBits & CfgRadioRxBit) {
@@ -186,83 +478,219 @@ void RadioTask::rigTask()
     else if (cmdBits & CfgRadioTxBit) {
       rigTaskTransmit(packetBuf, tmpBuf);
     } 
+    else if (cmdBits & CfgRadioWakeupBit) {
+      rigTaskWakeup(packetBuf, tmpBuf);
+    }
     if (cmdBits & CfgRadioRxStartBit) {
       rigTaskStartReceive();
     }
     else if (cmdBits & CfgRadioTxStartBit) {
       rigTaskStartTransmit();
     }
+    else if ((cmdBits & CfgRadioRxDutyBit) && isRxDutyCycle_ != isRxDutyCycleActive_ && !isTransmitting_) {
+      rigTaskStartReceive();
+    }
+    publishStats();
   } 
 
-  delete tmpBuf;
-  delete packetBuf;
   LOG_INFO("Radio task stopped");
   vTaskDelete(NULL);
 }
 
 bool RadioTask::loop() 
 {
+#if CFG_RADIO_STATS_LOG == true
+  if (millis() - lastStatsLogMs_ > CfgStatsLogIntervalMs) {
+    logStats();
+  }
+#endif
   bool shouldUpdateScreen = shouldUpdateScreen_;
   shouldUpdateScreen_ = false;
   return shouldUpdateScreen;
 }
 
+uint32_t RadioTask::getLoopTimeoutMs() const
+{
+#if CFG_RADIO_STATS_LOG == true
+  uint32_t elapsedMs = millis() - lastStatsLogMs_;
+  return elapsedMs > CfgStatsLogIntervalMs ? 0 : CfgStatsLogIntervalMs - elapsedMs + 1;
+#else
+  // stats are only polled by the stats screen, nothing periodic to do
+  return EventNotifier::CfgWaitForever;
+#endif
+}
+
+void RadioTask::publishStats()
+{
+  // snapshot for other tasks, counters are only updated by this task
+  stats_.rxQueueDepth = radioRxQueue_.size();
+  stats_.txDropped = radioTxQueue_.getDroppedCount();
+  stats_.rssi = lastRssi_;
+  stats_.snr = lastSnr_;
+  statsLock_.write(stats_);
+}
+
+void RadioTask::logStats()
+{
+  uint32_t nowMs = millis();
+  float intervalSec = (nowMs - lastStatsLogMs_) / 1000.0f;
+  Stats stats = getStats();
+  uint32_t rxPackets = stats.rxPackets - lastLoggedStats_.rxPackets;
+  uint32_t txPackets = stats.txPackets - lastLoggedStats_.txPackets;
+  if (isScanning_) {
+    LOG_DEBUG("Scan ch/s:", (stats.scanChannels - lastLoggedStats_.scanChannels) / intervalSec, 
+      "detected:", stats.scanDetects - lastLoggedStats_.scanDetects);
+  }
+  if (rxPackets > 0 || txPackets > 0) {
+    LOG_DEBUG("RX pkt/s:", rxPackets / intervalSec, "B/s:", (stats.rxBytes - lastLoggedStats_.rxBytes) / intervalSec,
+      "err:", stats.rxErrors, "drop:", stats.rxDropped);
+    LOG_DEBUG("TX pkt/s:", txPackets / intervalSec, "B/s:", (stats.txBytes - lastLoggedStats_.txBytes) / intervalSec,
+      "err:", stats.txErrors, "drop:", stats.txDropped);
+    LOG_DEBUG("RX wakeups/s:", (stats.rxNotifies - lastLoggedStats_.rxNotifies) / intervalSec);
+    if (fec_) {
+      LOG_DEBUG("FEC corrected bits/s:", (stats.rxFecBits - lastLoggedStats_.rxFecBits) / intervalSec);
+    }
+    if (config_->RepeaterEnabled) {
+      LOG_DEBUG("Repeated:", stats.rptPackets, "dup:", stats.rptDuplicates, "busy:", stats.rptBusy);
+    }
+  }
+  lastLoggedStats_ = stats;
+  lastStatsLogMs_ = nowMs;
+}
+
 void RadioTask::rigTaskStartReceive() 
 {
-  LOG_INFO("Start receive");
-  if (isHalfDuplex()) setFreq(config_->LoraFreqRx);
-  int loraRadioState = radioModule_->startReceive();
+  // close the M17 stream, so receivers stop waiting for more frames
+  if (isM17StreamStarted_) rigTaskEndM17();
+  // dedicated tx module stays in standby between transmissions
+  if (!canReceive()) {
+    radioModule_->standby();
+    return;
+  }
+  LOG_INFO("Start receive, module", moduleId_);
+  // next over starts with callsign
+  lastCallsignTxMs_ = 0;
+  // replies are expected on the same channel
+  if (isScanning_ && isTransmitting_) scanHoldUntilMs_ = millis() + config_->ScanHoldMs_;
+  tune(rxFreq_, loraBw_, loraSf_);
+  int loraRadioState;
+#ifdef USE_SX126X
+  // receiver wakes up for preamble detection only, packet still wakes up the board
+  if (isRxDutyCycle_ && config_->ModType == CFG_MOD_TYPE_LORA && !isScanning_) {
+    LOG_INFO("Using rx duty cycle");
+    loraRadioState = radioModule_->startReceiveDutyCycleAuto(config_->LoraPreambleLen_);
+    isRxDutyCycleActive_ = true;
+  } else {
+    loraRadioState = radioModule_->startReceive();
+    isRxDutyCycleActive_ = false;
+  }
+#else
+  loraRadioState = radioModule_->startReceive();
+#endif
   if (loraRadioState != RADIOLIB_ERR_NONE) {
     LOG_ERROR("Start receive error:", loraRadioState);
   }
   vTaskDelay(1);
+  isTransmitting_ = false;
   isIsrEnabled_ = true;
 }
 
 void RadioTask::rigTaskStartTransmit() 
 {
-  LOG_INFO("Start transmit");
+  if (!canTransmit()) return;
+  LOG_INFO("Start transmit, module", moduleId_);
   isIsrEnabled_ = false;
-  if (isHalfDuplex()) setFreq(config_->LoraFreqTx);
+  isTransmitting_ = true;
+  tune(txFreq_, loraBw_, loraSf_);
 }
 
 void RadioTask::rigTaskReceive(byte *packetBuf, byte *tmpBuf) 
 {
+  // receive is restarted in continuous mode afterwards
+  isRxDutyCycleActive_ = false;
   int packetSize = radioModule_->getPacketLength();
-  bool isValidPacket = packetSize <= CfgRadioPacketBufLen;
+  if (m17Framer_) {
+    rigTaskReceiveM17(packetSize);
+    return;
+  }
+  // fec decoded packet is at least this large, exact size is known after decoding
+  int rawPacketSize = packetSize;
+  if (fec_) packetSize = fec_->getMaxDataSize(rawPacketSize);
+  bool isValidPacket = packetSize > 0 && packetSize <= CfgRadioMaxPacketSize;
 
-  // should be larger than iv and tag length if privacy enabled
+  // should be larger than type header, key id, iv and tag length if privacy enabled
   if (config_->AudioEnPriv)
-    isValidPacket &= packetSize > CfgIvSize + CfgAuthTagSize;
+    isValidPacket &= packetSize > CfgPrivacyOverhead + CfgPacketHeaderSize;
+  else
+    isValidPacket &= packetSize > CfgPacketHeaderSize;
 
-  if (isValidPacket) {
-    // receive packet
-    int state = radioModule_->readData(packetBuf, packetSize);
-    bool isValidPacket = true;
-    if (state == RADIOLIB_ERR_NONE) {
-      byte *receiveBuf = packetBuf;
-      // if privacy enabled
-      if (config_->AudioEnPriv) {
-        isValidPacket = decryptPacket(packetBuf, tmpBuf, packetSize, packetSize);
-        receiveBuf = tmpBuf;
-      }
-      // send packet to the RX queue
-      if (isValidPacket) {
-        LOG_DEBUG("Received packet, size", packetSize);
-        for (int i = 0; i < packetSize; i++) {
-          radioRxQueue_.data.push(receiveBuf[i]);
+  if (isValidPacket && config_->RepeaterEnabled) {
+    rigTaskRepeat(packetBuf, tmpBuf, rawPacketSize);
+  } else if (isValidPacket) {
+    // plain packets are read from radio directly into the rx queue, fec coded and encrypted
+    // packets are decoded into the packet buffer first, their size is only known afterwards
+    bool isBuffered = fec_ || config_->AudioEnPriv;
+    byte *queueBuf = nullptr;
+    int state = RADIOLIB_ERR_NONE;
+    if (isBuffered) {
+      state = rigTaskReadPacket(packetBuf, rawPacketSize, packetSize);
+    } else if ((queueBuf = radioRxQueue_.reserve(packetSize)) != nullptr) {
+      state = rigTaskReadPacket(queueBuf, rawPacketSize, packetSize);
+    }
+    int queuePacketSize = config_->AudioEnPriv ? packetSize - CfgPrivacyOverhead : packetSize;
+    if (isBuffered && state == RADIOLIB_ERR_NONE && queuePacketSize > 0 && packetSize <= CfgRadioMaxPacketSize) {
+      queueBuf = radioRxQueue_.reserve(queuePacketSize);
+      if (queueBuf != nullptr && !config_->AudioEnPriv) memcpy(queueBuf, packetBuf, packetSize);
+    }
+    if (state == RADIOLIB_ERR_NONE && queueBuf == nullptr) {
+      LOG_ERROR("RX queue is full or packet is too large, packet dropped", packetSize);
+      stats_.rxDropped++;
+    } else {
+      lastRssi_ = radioModule_->getRSSI();
+      lastSnr_ = radioModule_->getSNR();
+      if (state == RADIOLIB_ERR_NONE) {
+        isValidPacket = queuePacketSize > CfgPacketHeaderSize;
+        if (isValidPacket && config_->AudioEnPriv) {
+          isValidPacket = decryptPacket(packetBuf, queueBuf, packetSize, queuePacketSize);
+        }
+        // voice goes to audio, data fragments are reassembled directly from the queue memory
+        uint8_t packetType = isValidPacket ? queueBuf[0] & CfgPacketTypeMask : 0;
+        int headerSize = CfgPacketHeaderSize;
+        if (isValidPacket && (queueBuf[0] & CfgPacketFlagAx25)) {
+          rigTaskHeardCallsign(queueBuf + CfgPacketHeaderSize, queuePacketSize - CfgPacketHeaderSize);
+          headerSize += Ax25::CfgHeaderSize;
+        }
+        if (queuePacketSize <= headerSize) packetType = 0;
+        if (packetType == CfgPacketTypeVoice || packetType == CfgPacketTypeData) {
+          LOG_DEBUG("Received packet, type", packetType, "size", queuePacketSize);
+          stats_.rxPackets++;
+          stats_.rxBytes += queuePacketSize;
+          stats_.airtimeMs += radioModule_->getTimeOnAir(rawPacketSize) / 1000;
+          if (isScanning_) scanHoldUntilMs_ = millis() + config_->ScanHoldMs_;
+          if (packetType == CfgPacketTypeVoice) {
+            if (radioRxQueue_.commit(queuePacketSize, lastRssi_, lastSnr_, headerSize)) {
+              if (rxPendingPackets_++ == 0) rxPendingSinceMs_ = millis();
+              rigTaskNotifyAudio();
+            } else {
+              LOG_ERROR("Packet is larger than reserved, dropped", queuePacketSize);
+              stats_.rxDropped++;
+            }
+          } else {
+            stats_.rxDataPackets++;
+            dataLink_->onFragment(queueBuf + headerSize, queuePacketSize - headerSize, lastRssi_, lastSnr_);
+          }
+        } else {
+          LOG_ERROR("Invalid packet was received");
+          stats_.rxErrors++;
         }
-        radioRxQueue_.index.push(packetSize);
-        audioTask_->play();
       } else {
-        LOG_ERROR("Invalid packet was received");
+        LOG_ERROR("Read data error:", state);
+        stats_.rxErrors++;
       }
-    } else {
-      LOG_ERROR("Read data error:", state);
     }
-    lastRssi_ = radioModule_->getRSSI();
   } else {
     LOG_ERROR("Wrong incoming packet size:", packetSize);
+    stats_.rxErrors++;
   }
   // start receive next
   int state = radioModule_->startReceive();
@@ -271,51 +699,441 @@ void RadioTask::rigTaskReceive(byte *packetBuf, byte *tmpBuf)
   }
 }
 
-void RadioTask::rigTaskTransmit(byte *packetBuf, byte *tmpBuf) 
+void RadioTask::rigTaskRepeat(byte *packetBuf, byte *tmpBuf, int rawPacketSize)
 {
-  // while there are no more packets
-  while (radioTxQueue_.index.size() > 0) {
-    // fetch packet size
-    int txBytesCnt = radioTxQueue_.index.shift();
-    // ignore wrong too large packets
-    if (txBytesCnt > CfgRadioPacketBufLen) {
-      LOG_ERROR("Packet size is too large, not transmitting");
-      for (int i = 0; i < txBytesCnt; i++) {
-        radioTxQueue_.data.shift();
-      }
-      vTaskDelay(1);
-      continue;
+  int packetSize = 0;
+  int state = rigTaskReadPacket(packetBuf, rawPacketSize, packetSize);
+  lastRssi_ = radioModule_->getRSSI();
+  lastSnr_ = radioModule_->getSNR();
+  if (state != RADIOLIB_ERR_NONE || (config_->AudioEnPriv && packetSize <= CfgPrivacyOverhead + CfgPacketHeaderSize)) {
+    LOG_ERROR("Read data error:", state, packetSize);
+    stats_.rxErrors++;
+    return;
+  }
+  stats_.rxPackets++;
+  stats_.rxBytes += packetSize;
+  stats_.airtimeMs += radioModule_->getTimeOnAir(rawPacketSize) / 1000;
+  if (isScanning_) scanHoldUntilMs_ = millis() + config_->ScanHoldMs_;
+
+  // encrypted packets carry sender and sequence number, plain ones are checked by payload
+  RepeaterFilter::Result result;
+  if (config_->AudioEnPriv) {
+    // authenticate first, so forged packets could not take over the stream
+    int decryptedSize;
+    if (config_->RepeaterVerify_ && !decryptPacket(packetBuf, tmpBuf, packetSize, decryptedSize)) {
+      LOG_DEBUG("Packet is not authenticated, not repeated");
+      stats_.rxErrors++;
+      return;
     }
-    // read packet from the queue
-    for (int i = 0; i < txBytesCnt; i++) {
-        packetBuf[i] = radioTxQueue_.data.shift();
+    const byte *iv = packetBuf + CfgKeyIdSize;
+    result = repeaterFilter_.check(readUint32(iv), readUint32(iv + 4), readUint32(iv + 8), config_->RepeaterHangMs);
+  } else {
+    result = repeaterFilter_.check(packetBuf, packetSize);
+  }
+  if (result == RepeaterFilter::Result::Duplicate) {
+    stats_.rptDuplicates++;
+    return;
+  }
+  if (result == RepeaterFilter::Result::Busy) {
+    stats_.rptBusy++;
+    return;
+  }
+
+  // forward without decoding, on the other module or on this one after switching to tx
+  RadioTask *txRadioTask = repeaterRadioTask_ ? repeaterRadioTask_.get() : this;
+  if (txRadioTask->repeatPacket(packetBuf, packetSize)) {
+    LOG_DEBUG("Repeating packet, size", packetSize);
+    stats_.rptPackets++;
+  } else {
+    LOG_ERROR("TX queue is full, packet is not repeated", packetSize);
+  }
+}
+
+int RadioTask::rigTaskReadPacket(byte *packetBuf, int rawPacketSize, int &packetSize)
+{
+  if (!fec_) {
+    packetSize = rawPacketSize;
+    return radioModule_->readData(packetBuf, rawPacketSize);
+  }
+  int state = radioModule_->readData(fecBuf_, rawPacketSize);
+  if (state != RADIOLIB_ERR_NONE) return state;
+  int correctedBits = 0;
+  packetSize = fec_->decode(fecBuf_, rawPacketSize, packetBuf, &correctedBits);
+  if (packetSize < 0) {
+    LOG_DEBUG("FEC could not correct packet, size", rawPacketSize);
+    return RADIOLIB_ERR_CRC_MISMATCH;
+  }
+  stats_.rxFecBits += correctedBits;
+  return RADIOLIB_ERR_NONE;
+}
+
+bool RadioTask::isScanActive() const
+{
+  return isScanning_ && !isTransmitting_;
+}
+
+bool RadioTask::rigTaskScan()
+{
+  // stay on the channel while there is activity on it
+  if ((int32_t)(scanHoldUntilMs_ - millis()) > 0) return true;
+
+  // next memory channel, which could be decoded with current audio settings
+  const Channel *channel = nullptr;
+  int channelId = scanChannelId_;
+  for (int i = 0; i < CFG_CHANNELS_COUNT; i++) {
+    channelId = (channelId + 1) % CFG_CHANNELS_COUNT;
+    const Channel &candidate = config_->Channels_[channelId];
+    if (!candidate.isEmpty() && candidate.isLora() && candidate.getCodec() == config_->AudioCodec
+      && candidate.isPrivacy() == config_->AudioEnPriv) {
+      channel = &candidate;
+      break;
     }
-    byte *sendBuf = packetBuf;
-    // if privacy enabled
-    if (config_->AudioEnPriv) {
-      encryptPacket(packetBuf, tmpBuf, txBytesCnt, txBytesCnt);
-      sendBuf = tmpBuf;
+  }
+  if (channel == nullptr) {
+    LOG_ERROR("No memory channels to scan, scan is disabled");
+    isScanning_ = false;
+    return false;
+  }
+
+  isIsrEnabled_ = false;
+  scanChannelId_ = channelId;
+  rxFreq_ = channel->getFreqRx();
+  txFreq_ = channel->getFreqTx();
+  loraBw_ = channel->getLoraBw();
+  loraSf_ = channel->getLoraSf();
+  tune(rxFreq_, loraBw_, loraSf_);
+
+  // blocks for few symbols, module is in standby afterwards
+  int state = radioModule_->scanChannel();
+  stats_.scanChannels++;
+  if (state == RADIOLIB_LORA_DETECTED || state == RADIOLIB_PREAMBLE_DETECTED) {
+    // receive and stay at least until the longest packet could be received
+    LOG_DEBUG("Activity on channel", channelId);
+    stats_.scanDetects++;
+    scanHoldUntilMs_ = millis() + radioModule_->getTimeOnAir(CfgRadioMaxPacketSize) / 1000 + CfgScanDetectHoldMs;
+    state = radioModule_->startReceive();
+    if (state != RADIOLIB_ERR_NONE) {
+      LOG_ERROR("Start receive error:", state);
     }
-    // transmit
-    int loraRadioState = radioModule_->transmit(sendBuf, txBytesCnt);
-    if (loraRadioState != RADIOLIB_ERR_NONE) {
-      LOG_ERROR("Radio transmit failed:", loraRadioState, txBytesCnt);
+    isIsrEnabled_ = true;
+    shouldUpdateScreen_ = true;
+    eventNotifier_->notify(EventNotifier::CfgEventRadio);
+    return true;
+  }
+  if (state != RADIOLIB_CHANNEL_FREE) {
+    LOG_ERROR("Channel scan error:", state);
+  }
+  return false;
+}
+
+void RadioTask::rigTaskNotifyAudio()
+{
+  if (rxPendingPackets_ == 0) return;
+  // first packet after wakeup is not batched, start of the over would be lost otherwise
+  if (!isWakeupPending_ && rxPendingPackets_ < config_->RadioRxBatchPackets_ 
+    && millis() - rxPendingSinceMs_ < config_->RadioRxBatchDeadlineMs_) return;
+  isWakeupPending_ = false;
+  rxPendingPackets_ = 0;
+  // audio task drains whole queue once woken up, no need to wake it up again
+  if (audioTask_->play()) {
+    stats_.rxNotifies++;
+  }
+}
+
+void RadioTask::rigTaskWakeup(byte *packetBuf, byte *tmpBuf)
+{
+  // interrupt edge could be missed while the pin was a sleep wakeup source,
+  // packet is still waiting in the module if its irq line is high
+  if (!canReceive() || isTransmitting_) return;
+  stats_.rxWakeups++;
+  if (digitalRead(pins_.a) != HIGH) return;
+  LOG_DEBUG("Reading packet which woke up the board");
+  rigTaskReceive(packetBuf, tmpBuf);
+}
+
+TickType_t RadioTask::rigTaskWaitTicks() const
+{
+  TickType_t waitTicks = portMAX_DELAY;
+  if (rxPendingPackets_ > 0) {
+    uint32_t elapsedMs = millis() - rxPendingSinceMs_;
+    waitTicks = elapsedMs >= config_->RadioRxBatchDeadlineMs_ 
+      ? 0 : pdMS_TO_TICKS(config_->RadioRxBatchDeadlineMs_ - elapsedMs);
+  }
+  // next channel is checked as soon as the active one is quiet
+  if (isScanActive()) {
+    int32_t holdMs = (int32_t)(scanHoldUntilMs_ - millis());
+    TickType_t holdTicks = holdMs > 0 ? pdMS_TO_TICKS(holdMs) : 0;
+    if (holdTicks < waitTicks) waitTicks = holdTicks;
+  }
+  // data waiting for the voice over to complete
+  if (canTransmit() && dataLink_->hasFragments()) {
+    uint32_t idleMs = voicePeriodMs_ > 0 ? 2 * voicePeriodMs_ : CfgVoiceIdleMs;
+    uint32_t elapsedMs = millis() - lastVoiceQueuedMs_;
+    TickType_t dataTicks = elapsedMs >= idleMs ? 0 : pdMS_TO_TICKS(idleMs - elapsedMs);
+    if (dataTicks < waitTicks) waitTicks = dataTicks;
+  }
+  return waitTicks;
+}
+
+void RadioTask::rigTaskTransmit(byte *packetBuf, byte *tmpBuf) 
+{
+  int maxPacketSize = getMaxPacketSize();
+
+  // repeated packets could come while receiving, switch to tx and back
+  bool shouldSwitchMode = !isTransmitting_;
+  if (shouldSwitchMode) rigTaskStartTransmit();
+
+  // voice goes first, data fragments only fill gaps between voice packets
+  while (true) {
+    // payload is read after the headers, repeated packets already have them
+    byte *payloadBuf = packetBuf + CfgPacketHeaderSize + Ax25::CfgHeaderSize;
+    if (radioTxQueue_.hasData()) {
+      // read packet from the queue, wrong packets are skipped
+      RadioQueue::Packet packet = {};
+      int txBytesCnt = radioTxQueue_.pop(payloadBuf, CfgRadioMaxPacketSize, &packet);
+      bool isRaw = packet.flags & CfgPacketFlagRaw;
+      if (txBytesCnt <= 0 || (!isRaw && txBytesCnt > maxPacketSize)) {
+        LOG_ERROR("Wrong outgoing packet size, dropped");
+        stats_.txErrors++;
+        vTaskDelay(1);
+        continue;
+      }
+      if (isRaw) {
+        rigTaskTransmitPacket(payloadBuf, tmpBuf, txBytesCnt, true);
+      } else if (m17Framer_) {
+        rigTaskTransmitM17(payloadBuf, txBytesCnt, tmpBuf);
+      } else {
+        int headerSize = rigTaskTagVoice(payloadBuf, txBytesCnt, maxPacketSize);
+        rigTaskTransmitPacket(payloadBuf - headerSize, tmpBuf, txBytesCnt + headerSize, false);
+      }
+    } else if (canTransmit() && dataLink_->hasFragments() && !m17Framer_) {
+      int fragmentSize = dataLink_->peekFragment(payloadBuf, maxPacketSize);
+      if (fragmentSize <= 0 || !canSendData(fragmentSize)) break;
+      payloadBuf[-CfgPacketHeaderSize] = CfgPacketTypeData;
+      if (rigTaskTransmitPacket(payloadBuf - CfgPacketHeaderSize, tmpBuf, fragmentSize + CfgPacketHeaderSize, false)) {
+        stats_.txDataPackets++;
+      }
+      // failed fragment is not retried, receiver drops incomplete message
+      dataLink_->releaseFragment();
     } else {
-      LOG_DEBUG("Transmitted packet, size:", txBytesCnt);
+      break;
     }
     vTaskDelay(1);
   }
+
+  if (shouldSwitchMode) rigTaskStartReceive();
+}
+
+bool RadioTask::rigTaskTransmitPacket(byte *packetBuf, byte *tmpBuf, int packetSize, bool isRaw)
+{
+  byte *sendBuf = packetBuf;
+  int sendBytesCnt = packetSize;
+  // if privacy enabled, repeated packets are already encrypted
+  if (config_->AudioEnPriv && !isRaw) {
+    encryptPacket(packetBuf, tmpBuf, packetSize, sendBytesCnt);
+    sendBuf = tmpBuf;
+  }
+  // fec is applied to repeated packets as well, they are decoded on receive
+  if (fec_) {
+    sendBytesCnt = fec_->encode(sendBuf, sendBytesCnt, fecBuf_);
+    sendBuf = fecBuf_;
+    if (sendBytesCnt <= 0 || sendBytesCnt > CfgRadioMaxPacketSize) {
+      LOG_ERROR("FEC encode failed, packet dropped", packetSize);
+      stats_.txErrors++;
+      return false;
+    }
+  }
+  // transmit
+  int loraRadioState = radioModule_->transmit(sendBuf, sendBytesCnt);
+  if (loraRadioState != RADIOLIB_ERR_NONE) {
+    LOG_ERROR("Radio transmit failed:", loraRadioState, sendBytesCnt);
+    stats_.txErrors++;
+    return false;
+  }
+  LOG_DEBUG("Transmitted packet, size:", sendBytesCnt);
+  stats_.txPackets++;
+  stats_.txBytes += packetSize;
+  stats_.airtimeMs += radioModule_->getTimeOnAir(sendBytesCnt) / 1000;
+  return true;
+}
+
+int RadioTask::rigTaskTagVoice(byte *payloadBuf, int payloadSize, int maxPacketSize)
+{
+  // callsign is added to the first packet of the over and then periodically, 
+  // postponed if the packet is too large to fit it
+  uint32_t nowMs = millis();
+  bool isCallsignDue = isCallsignValid_ && (lastCallsignTxMs_ == 0 
+    || nowMs - lastCallsignTxMs_ >= (uint32_t)config_->CallsignIntervalMs_);
+  if (isCallsignDue && payloadSize + Ax25::CfgHeaderSize <= maxPacketSize) {
+    memcpy(payloadBuf - Ax25::CfgHeaderSize, callsignHeader_, Ax25::CfgHeaderSize);
+    payloadBuf[-Ax25::CfgHeaderSize - CfgPacketHeaderSize] = CfgPacketTypeVoice | CfgPacketFlagAx25;
+    lastCallsignTxMs_ = nowMs == 0 ? 1 : nowMs;
+    return CfgPacketHeaderSize + Ax25::CfgHeaderSize;
+  }
+  payloadBuf[-CfgPacketHeaderSize] = CfgPacketTypeVoice;
+  return CfgPacketHeaderSize;
+}
+
+void RadioTask::rigTaskHeardCallsign(const byte *header, int headerSize)
+{
+  char callsign[CFG_CALLSIGN_SIZE];
+  if (!Ax25::decodeHeader(header, headerSize, callsign, sizeof(callsign))) {
+    LOG_DEBUG("Invalid AX.25 header");
+    return;
+  }
+  rigTaskUpdateHeard(callsign);
+}
+
+void RadioTask::rigTaskUpdateHeard(const char *callsign)
+{
+  if (strcmp(callsign, heardCallsign_.callsign) != 0) {
+    LOG_INFO("Heard callsign", callsign);
+    strcpy(heardCallsign_.callsign, callsign);
+    shouldUpdateScreen_ = true;
+    eventNotifier_->notify(EventNotifier::CfgEventRadio);
+  }
+  heardCallsign_.heardMs = millis();
+  heardLock_.write(heardCallsign_);
+}
+
+void RadioTask::rigTaskReceiveM17(int packetSize)
+{
+  // frames are fixed size, so anything else is noise or native packets
+  byte frame[M17Framer::CfgFrameSize];
+  bool isValidPacket = packetSize == M17Framer::CfgFrameSize 
+    && radioModule_->readData(frame, packetSize) == RADIOLIB_ERR_NONE;
+  lastRssi_ = radioModule_->getRSSI();
+  lastSnr_ = radioModule_->getSNR();
+  if (isValidPacket) {
+    byte payload[M17Framer::CfgPayloadSize];
+    bool isLast = false;
+    M17Framer::FrameType frameType = m17Framer_->decode(frame, packetSize, payload, isLast);
+    char callsign[CFG_CALLSIGN_SIZE];
+    if (frameType == M17Framer::FrameType::Stream) {
+      stats_.rxPackets++;
+      stats_.rxBytes += packetSize;
+      stats_.airtimeMs += radioModule_->getTimeOnAir(packetSize) / 1000;
+      // late entry, source is known once all link setup chunks are collected
+      if (m17Framer_->getRxSource(callsign, sizeof(callsign))) rigTaskUpdateHeard(callsign);
+      int payloadSize = getMaxPacketSize();
+      if (radioRxQueue_.push(payload, payloadSize, lastRssi_, lastSnr_)) {
+        if (rxPendingPackets_++ == 0) rxPendingSinceMs_ = millis();
+        rigTaskNotifyAudio();
+      } else {
+        LOG_ERROR("RX queue is full, packet dropped", payloadSize);
+        stats_.rxDropped++;
+      }
+    } else if (frameType == M17Framer::FrameType::Lsf) {
+      if (m17Framer_->getRxSource(callsign, sizeof(callsign))) rigTaskUpdateHeard(callsign);
+    } else if (frameType == M17Framer::FrameType::Invalid) {
+      isValidPacket = false;
+    }
+  }
+  if (!isValidPacket) {
+    LOG_ERROR("Invalid M17 frame was received", packetSize);
+    stats_.rxErrors++;
+  }
+  int state = radioModule_->startReceive();
+  if (state != RADIOLIB_ERR_NONE) {
+    LOG_ERROR("Start receive error:", state);
+  }
+}
+
+bool RadioTask::rigTaskTransmitM17(const byte *payloadBuf, int payloadSize, byte *tmpBuf)
+{
+  // link setup frame goes first, so receivers know the source right away
+  if (!isM17StreamStarted_) {
+    m17Framer_->startStream();
+    int frameSize = m17Framer_->encodeLsf(tmpBuf);
+    if (!rigTaskTransmitPacket(tmpBuf, nullptr, frameSize, true)) return false;
+    isM17StreamStarted_ = true;
+  }
+  int frameSize = m17Framer_->encodeStream(payloadBuf, payloadSize, false, tmpBuf);
+  return rigTaskTransmitPacket(tmpBuf, nullptr, frameSize, true);
+}
+
+void RadioTask::rigTaskEndM17()
+{
+  isM17StreamStarted_ = false;
+  byte frame[M17Framer::CfgFrameSize];
+  int frameSize = m17Framer_->encodeEot(frame);
+  rigTaskTransmitPacket(frame, nullptr, frameSize, true);
+}
+
+bool RadioTask::isVoiceActive() const
+{
+  // over is considered completed when the next voice packet is late
+  uint32_t idleMs = voicePeriodMs_ > 0 ? 2 * voicePeriodMs_ : CfgVoiceIdleMs;
+  return lastVoiceQueuedMs_ != 0 && millis() - lastVoiceQueuedMs_ < idleMs;
+}
+
+bool RadioTask::canSendData(int fragmentSize) const
+{
+  if (!isVoiceActive()) return true;
+  if (voicePeriodMs_ == 0) return false;
+  // fragment must be on air before the next voice packet is queued
+  int encryptedSize = fragmentSize + CfgPacketHeaderSize + (config_->AudioEnPriv ? CfgPrivacyOverhead : 0);
+  int encodedSize = fec_ ? fec_->getEncodedSize(encryptedSize) : encryptedSize;
+  int32_t airtimeMs = radioModule_->getTimeOnAir(encodedSize) / 1000;
+  int32_t slackMs = (int32_t)(lastVoiceQueuedMs_ + voicePeriodMs_ - millis());
+  return airtimeMs + (int32_t)CfgDataGuardMs <= slackMs;
+}
+
+bool RadioTask::isM17Mode() const
+{
+  // stream payload carries Codec2 3200 or 1600 frames only
+  bool isM17 = config_->M17Enabled && config_->ModType == CFG_MOD_TYPE_FSK && config_->AudioCodec == CFG_AUDIO_CODEC_CODEC2
+    && (config_->AudioCodec2Mode == CODEC2_MODE_3200 || config_->AudioCodec2Mode == CODEC2_MODE_1600);
+  // stream frames are not encrypted, voice must not go out in clear when privacy is enabled
+  if (isM17 && config_->AudioEnPriv) {
+    LOG_ERROR("M17 mode needs privacy disabled, native packets are used");
+    return false;
+  }
+  return isM17;
+}
+
+bool RadioTask::setCipherKey(int keyId)
+{
+  bool isKeySet = false;
+  portENTER_CRITICAL(&privacyKeyLock_);
+  if (keyId >= 0 && keyId < CfgKeySlots && isPrivacyKeySet_[keyId]) {
+    cipher_->setKey(privacyKeys_[keyId], CfgKeySize);
+    isKeySet = true;
+  }
+  portEXIT_CRITICAL(&privacyKeyLock_);
+  return isKeySet;
+}
+
+void RadioTask::writeUint32(byte *buf, uint32_t value)
+{
+  buf[0] = value & 0xff;
+  buf[1] = (value >> 8) & 0xff;
+  buf[2] = (value >> 16) & 0xff;
+  buf[3] = (value >> 24) & 0xff;
+}
+
+uint32_t RadioTask::readUint32(const byte *buf)
+{
+  return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
 }
 
 void RadioTask::encryptPacket(byte *inBuf, byte *outBuf, int inBufSize, int& outBufSize) 
 {
-  int curOutBufSize = inBufSize;
-  // generate iv and include it into payload head
-  esp_fill_random(outBuf, CfgIvSize);
-  cipher_->setIV(outBuf, CfgIvSize);
+  // key slot id goes first, it is not encrypted, but authenticated
+  int keyId = privacyKeyId_;
+  outBuf[0] = keyId;
+  setCipherKey(keyId);
+  // iv is sender id, boot epoch and sequence number, it is used by receiver for replay protection
+  byte *iv = outBuf + CfgKeyIdSize;
+  writeUint32(iv, senderId_);
+  writeUint32(iv + 4, txEpoch_);
+  writeUint32(iv + 8, txSeq_++);
+  cipher_->setIV(iv, CfgIvSize);
+  cipher_->addAuthData(outBuf, CfgKeyIdSize);
   // encrypt
-  cipher_->encrypt(outBuf + CfgIvSize, inBuf, inBufSize);
-  curOutBufSize += CfgIvSize;
+  int curOutBufSize = CfgKeyIdSize + CfgIvSize;
+  cipher_->encrypt(outBuf + curOutBufSize, inBuf, inBufSize);
+  curOutBufSize += inBufSize;
   // generate auth tag and include it into payload tail
   cipher_->computeTag(outBuf + curOutBufSize, CfgAuthTagSize);
   curOutBufSize += CfgAuthTagSize;
@@ -324,13 +1142,46 @@ void RadioTask::encryptPacket(byte *inBuf, byte *outBuf, int inBufSize, int& out
 
 bool RadioTask::decryptPacket(byte *inBuf, byte *outBuf, int inBufSize, int& outBufSize) 
 {
-  int curOutBufSize = inBufSize - (CfgIvSize + CfgAuthTagSize);
+  int keyId = inBuf[0];
+  const byte *iv = inBuf + CfgKeyIdSize;
+  uint32_t senderId = readUint32(iv);
+  uint32_t epoch = readUint32(iv + 4);
+  uint32_t seq = readUint32(iv + 8);
+  // drop replayed packets of tracked senders before spending time on decryption
+  if (!replayFilter_.check(senderId, epoch, seq)) {
+    LOG_DEBUG("Replayed packet", senderId, epoch, seq);
+    return false;
+  }
+  if (!setCipherKey(keyId)) {
+    LOG_DEBUG("Unknown key slot", keyId);
+    return false;
+  }
+  int curOutBufSize = inBufSize - CfgPrivacyOverhead;
   // set iv from the packet and decrypt
-  cipher_->setIV(inBuf, CfgIvSize);
-  cipher_->decrypt(outBuf, inBuf + CfgIvSize, curOutBufSize);
+  cipher_->setIV(iv, CfgIvSize);
+  cipher_->addAuthData(inBuf, CfgKeyIdSize);
+  cipher_->decrypt(outBuf, inBuf + CfgKeyIdSize + CfgIvSize, curOutBufSize);
   outBufSize = curOutBufSize;
-  // check tag validity from the received packet
-  return cipher_->checkTag(inBuf + CfgIvSize + curOutBufSize, CfgAuthTagSize);
+  // check tag validity from the received packet, only authenticated packets move replay window
+  // and reach the stored positions of senders
+  if (!cipher_->checkTag(inBuf + CfgKeyIdSize + CfgIvSize + curOutBufSize, CfgAuthTagSize)) {
+    return false;
+  }
+  if (!replayFilter_.update(senderId, epoch, seq)) {
+    LOG_DEBUG("Replayed packet", senderId, epoch, seq);
+    return false;
+  }
+  // gaps in sequence of the same sender session are lost packets
+  bool isSameSession = senderId == lastRxSenderId_ && epoch == lastRxEpoch_;
+  if (isSameSession && seq > lastRxSeq_ + 1) {
+    stats_.rxLost += seq - lastRxSeq_ - 1;
+  }
+  if (!isSameSession || seq > lastRxSeq_) {
+    lastRxSenderId_ = senderId;
+    lastRxEpoch_ = epoch;
+    lastRxSeq_ = seq;
+  }
+  return true;
 }
 
 } // LoraDv
\ No newline at end of file
@@ -0,0 +1,440 @@
+#include "hal/serial_protocol.h"
+#include "hal/radio_task.h"
+#include "audio/audio_task.h"
+
+namespace LoraDv {
+
+SerialProtocol::SerialProtocol(std::shared_ptr<Config> config, std::shared_ptr<DataLink> dataLink)
+  : config_(config)
+  , dataLink_(dataLink)
+  , audioTask_(nullptr)
+  , rxRadioTask_(nullptr)
+  , txRadioTask_(nullptr)
+  , protocolTaskHandle_(0)
+  , rxFrameSize_(0)
+  , isRxEscaped_(false)
+  , isRxOverflow_(false)
+  , telemetryIntervalMs_(config->SerialTelemetryMs_)
+  , lastTelemetryMs_(0)
+  , lastVoiceTxMs_(0)
+  , isVoiceTxActive_(false)
+  , isVoiceRxStreamEnabled_(false)
+  , isRunning_(false)
+  , txDropped_(0)
+{
+}
+
+void SerialProtocol::start(std::shared_ptr<AudioTask> audioTask, std::shared_ptr<RadioTask> rxRadioTask, 
+    std::shared_ptr<RadioTask> txRadioTask, std::shared_ptr<TaskMonitor> taskMonitor)
+{
+  audioTask_ = audioTask;
+  rxRadioTask_ = rxRadioTask;
+  txRadioTask_ = txRadioTask;
+  taskMonitor_ = taskMonitor;
+  xTaskCreatePinnedToCore(&task, "SerialTask", CfgTaskStack, this, CfgTaskPriority, &protocolTaskHandle_, CfgCoreId);
+  // called from uart event task when data arrives, no polling
+  Serial.onReceive([this]() {
+    xTaskNotify(protocolTaskHandle_, CfgRxBit, eSetBits);
+  });
+  // received data messages are forwarded to the host
+  dataLink_->onReceive([this]() {
+    xTaskNotify(protocolTaskHandle_, CfgDataBit, eSetBits);
+  });
+}
+
+bool SerialProtocol::sendVoice(const byte *packetBuf, int packetSize, float rssi, float snr)
+{
+  if (!isVoiceRxStreamEnabled_ || protocolTaskHandle_ == 0) return false;
+  if (!voiceQueue_.push(packetBuf, packetSize, rssi, snr)) return false;
+  xTaskNotify(protocolTaskHandle_, CfgVoiceBit, eSetBits);
+  return true;
+}
+
+void SerialProtocol::task(void *param)
+{
+  static_cast<SerialProtocol*>(param)->protocolTask();
+}
+
+void SerialProtocol::protocolTask()
+{
+  LOG_INFO("Serial protocol task started");
+  isRunning_ = true;
+
+  while (isRunning_) {
+    uint32_t cmdBits = 0;
+    xTaskNotifyWaitIndexed(0, 0x00, ULONG_MAX, &cmdBits, getWaitTicks());
+
+    receiveBytes();
+    sendStagedVoice();
+    sendReceivedData();
+
+    uint32_t nowMs = millis();
+    if (telemetryIntervalMs_ > 0 && nowMs - lastTelemetryMs_ >= telemetryIntervalMs_) {
+      lastTelemetryMs_ = nowMs;
+      sendTelemetry();
+    }
+    // host stopped sending voice
+    if (isVoiceTxActive_ && nowMs - lastVoiceTxMs_ >= CfgVoiceTxHangMs) {
+      isVoiceTxActive_ = false;
+      txRadioTask_->startReceive();
+    }
+  }
+
+  LOG_INFO("Serial protocol task stopped");
+  vTaskDelete(NULL);
+}
+
+TickType_t SerialProtocol::getWaitTicks() const
+{
+  uint32_t nowMs = millis();
+  uint32_t waitMs = UINT32_MAX;
+  if (telemetryIntervalMs_ > 0) {
+    uint32_t elapsedMs = nowMs - lastTelemetryMs_;
+    waitMs = elapsedMs >= telemetryIntervalMs_ ? 0 : telemetryIntervalMs_ - elapsedMs;
+  }
+  if (isVoiceTxActive_) {
+    uint32_t elapsedMs = nowMs - lastVoiceTxMs_;
+    waitMs = min(waitMs, elapsedMs >= CfgVoiceTxHangMs ? 0 : CfgVoiceTxHangMs - elapsedMs);
+  }
+  return waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+}
+
+void SerialProtocol::receiveBytes()
+{
+  while (Serial.available() > 0) {
+    uint8_t b = Serial.read();
+    if (b == CfgFend) {
+      // frame is started and ended with fend, empty frames between them are skipped
+      if (rxFrameSize_ > 0 && !isRxOverflow_) {
+        processFrame(rxFrame_, rxFrameSize_);
+      }
+      rxFrameSize_ = 0;
+      isRxEscaped_ = false;
+      isRxOverflow_ = false;
+      continue;
+    }
+    if (b == CfgFesc) {
+      isRxEscaped_ = true;
+      continue;
+    }
+    if (isRxEscaped_) {
+      if (b == CfgTfend) b = CfgFend;
+      else if (b == CfgTfesc) b = CfgFesc;
+      isRxEscaped_ = false;
+    }
+    if (rxFrameSize_ < CfgMaxFrameSize) {
+      rxFrame_[rxFrameSize_++] = b;
+    } else {
+      isRxOverflow_ = true;
+    }
+  }
+}
+
+void SerialProtocol::processFrame(const byte *frame, int frameSize)
+{
+  if (frameSize < 3) return;
+  int dataSize = frameSize - 2;
+  uint16_t crc = (uint16_t)frame[dataSize] | ((uint16_t)frame[dataSize + 1] << 8);
+  if (crc16(frame, dataSize) != crc) {
+    LOG_DEBUG("Serial frame crc mismatch");
+    sendError(frame[0], CfgErrCrc);
+    return;
+  }
+  processCommand(frame[0], frame + 1, dataSize - 1);
+}
+
+void SerialProtocol::processCommand(uint8_t type, const byte *payload, int payloadSize)
+{
+  switch (type) {
+    case CfgCmdPing:
+      sendAck(type, (const byte *)LORADV_VERSION, strlen(LORADV_VERSION));
+      break;
+    case CfgCmdGetConfig: {
+      // reply with the name followed by the stored value
+      int nameLen = strnlen((const char *)payload, payloadSize);
+      if (nameLen == 0 || nameLen >= payloadSize) {
+        sendError(type, CfgErrArgs);
+        break;
+      }
+      byte reply[CfgMaxFrameSize];
+      memcpy(reply, payload, nameLen + 1);
+      int valueSize = config_->GetField((const char *)payload, reply + nameLen + 1, sizeof(reply) - nameLen - 1);
+      if (valueSize > 0)
+        sendAck(type, reply, nameLen + 1 + valueSize);
+      else
+        sendError(type, CfgErrArgs);
+      break;
+    }
+    case CfgCmdSetConfig: {
+      int nameLen = strnlen((const char *)payload, payloadSize);
+      if (nameLen == 0 || nameLen >= payloadSize - 1) {
+        sendError(type, CfgErrArgs);
+        break;
+      }
+      if (config_->SetField((const char *)payload, payload + nameLen + 1, payloadSize - nameLen - 1))
+        sendAck(type);
+      else
+        sendError(type, CfgErrFailed);
+      break;
+    }
+    case CfgCmdReboot:
+      sendAck(type);
+      Serial.flush();
+      ESP.restart();
+      break;
+    case CfgCmdPtt:
+      if (payloadSize != 1) {
+        sendError(type, CfgErrArgs);
+        break;
+      }
+      LOG_INFO("Serial PTT", payload[0]);
+      audioTask_->setPtt(payload[0] != 0);
+      if (payload[0] != 0) audioTask_->record();
+      sendAck(type);
+      break;
+    case CfgCmdVoiceTx:
+      processVoiceTx(payload, payloadSize);
+      break;
+    case CfgCmdDataTx:
+      processDataTx(payload, payloadSize);
+      break;
+    case CfgCmdTelemetry:
+      if (payloadSize != 2) {
+        sendError(type, CfgErrArgs);
+        break;
+      }
+      telemetryIntervalMs_ = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8);
+      sendAck(type);
+      break;
+    case CfgCmdSetKey:
+      processSetKey(payload, payloadSize);
+      break;
+    case CfgCmdSetKeyId:
+      processSetKeyId(payload, payloadSize);
+      break;
+    case CfgCmdTaskStats:
+      if (!taskMonitor_->isRunning()) {
+        sendError(type, CfgErrFailed);
+        break;
+      }
+      sendTaskStats();
+      break;
+    case CfgCmdVoiceRxStream:
+      if (payloadSize != 1) {
+        sendError(type, CfgErrArgs);
+        break;
+      }
+      isVoiceRxStreamEnabled_ = payload[0] != 0;
+      if (!isVoiceRxStreamEnabled_) voiceQueue_.clear();
+      sendAck(type);
+      break;
+    default:
+      sendError(type, CfgErrUnknown);
+      break;
+  }
+}
+
+void SerialProtocol::processVoiceTx(const byte *payload, int payloadSize)
+{
+  // encoded packets from host go to the radio as is, no ack to keep the stream flowing
+  if (payloadSize <= 0 || payloadSize > txRadioTask_->getMaxPacketSize()) {
+    sendError(CfgCmdVoiceTx, CfgErrArgs);
+    return;
+  }
+  if (!isVoiceTxActive_) {
+    isVoiceTxActive_ = true;
+    txRadioTask_->startTransmit();
+  }
+  if (!txRadioTask_->writePacket(payload, payloadSize)) {
+    txRadioTask_->dropOldestTxPacket();
+    txRadioTask_->writePacket(payload, payloadSize);
+  }
+  txRadioTask_->transmit();
+  lastVoiceTxMs_ = millis();
+}
+
+void SerialProtocol::processDataTx(const byte *payload, int payloadSize)
+{
+  // fragmented and sent by the radio between voice packets
+  if (payloadSize <= 0 || payloadSize > DataLink::CfgMaxMessageSize) {
+    sendError(CfgCmdDataTx, CfgErrArgs);
+    return;
+  }
+  if (txRadioTask_->sendData(payload, payloadSize))
+    sendAck(CfgCmdDataTx);
+  else
+    sendError(CfgCmdDataTx, CfgErrFailed);
+}
+
+void SerialProtocol::processSetKey(const byte *payload, int payloadSize)
+{
+  // key is stored and loaded into running radio tasks, both directions use it right away
+  if (payloadSize != 1 + RadioTask::CfgKeySize) {
+    sendError(CfgCmdSetKey, CfgErrArgs);
+    return;
+  }
+  int keyId = payload[0];
+  if (!config_->SetPrivacyKey(keyId, payload + 1)) {
+    sendError(CfgCmdSetKey, CfgErrFailed);
+    return;
+  }
+  rxRadioTask_->setPrivacyKey(keyId, payload + 1);
+  if (txRadioTask_ != rxRadioTask_) txRadioTask_->setPrivacyKey(keyId, payload + 1);
+  sendAck(CfgCmdSetKey);
+}
+
+void SerialProtocol::processSetKeyId(const byte *payload, int payloadSize)
+{
+  // transmission switches to the slot with the next packet, receiver accepts any set slot
+  if (payloadSize != 1) {
+    sendError(CfgCmdSetKeyId, CfgErrArgs);
+    return;
+  }
+  if (!txRadioTask_->setPrivacyKeyId(payload[0]) || !config_->SetPrivacyKeyId(payload[0])) {
+    sendError(CfgCmdSetKeyId, CfgErrFailed);
+    return;
+  }
+  sendAck(CfgCmdSetKeyId);
+}
+
+void SerialProtocol::sendReceivedData()
+{
+  byte payload[CfgMaxFrameSize];
+  float rssi, snr;
+  int dataSize;
+  while ((dataSize = dataLink_->receive(payload + 2, sizeof(payload) - 2, &rssi, &snr)) > 0) {
+    payload[0] = (int8_t)constrain(rssi, -128.0f, 127.0f);
+    payload[1] = (int8_t)constrain(snr * 4, -128.0f, 127.0f);
+    sendFrame(CfgEvtDataRx, payload, dataSize + 2);
+  }
+}
+
+void SerialProtocol::sendStagedVoice()
+{
+  byte payload[CfgMaxFrameSize];
+  RadioQueue::Packet packet = {};
+  int packetSize;
+  while ((packetSize = voiceQueue_.pop(payload + 2, sizeof(payload) - 2, &packet)) > 0) {
+    payload[0] = (int8_t)constrain(packet.rssi, -128.0f, 127.0f);
+    payload[1] = (int8_t)constrain(packet.snr * 4, -128.0f, 127.0f);
+    sendFrame(CfgEvtVoiceRx, payload, packetSize + 2);
+  }
+}
+
+void SerialProtocol::sendTelemetry()
+{
+  RadioTask::Stats radioStats = rxRadioTask_->getStats();
+  RadioTask::Stats txRadioStats = txRadioTask_->getStats();
+  AudioTask::Stats audioStats = audioTask_->getStats();
+
+  const uint32_t counters[] = {
+    radioStats.rxPackets, radioStats.rxErrors, radioStats.rxLost, radioStats.rxDropped,
+    txRadioStats.txPackets, txRadioStats.txErrors, txRadioStats.txDropped, 
+    radioStats.airtimeMs + (txRadioTask_ != rxRadioTask_ ? txRadioStats.airtimeMs : 0),
+    audioStats.txFrames, audioStats.rxFrames, audioStats.txDropped, audioStats.codecBitRate,
+    txDropped_
+  };
+  constexpr int countersCount = sizeof(counters) / sizeof(counters[0]);
+  byte payload[countersCount * 4 + 2];
+  for (int i = 0; i < countersCount; i++) {
+    writeUint32(payload + 4 * i, counters[i]);
+  }
+  payload[countersCount * 4] = (int8_t)constrain(radioStats.rssi, -128.0f, 127.0f);
+  payload[countersCount * 4 + 1] = (int8_t)constrain(radioStats.snr * 4, -128.0f, 127.0f);
+  sendFrame(CfgEvtTelemetry, payload, sizeof(payload));
+}
+
+void SerialProtocol::sendTaskStats()
+{
+  // core count, load and peak per core, then stack size, minimum free stack, load, peak and name per task
+  TaskMonitor::Stats stats = taskMonitor_->getStats();
+  byte payload[CfgMaxFrameSize - 3];
+  int payloadSize = 0;
+  payload[payloadSize++] = TaskMonitor::CfgCoreCount;
+  for (int coreId = 0; coreId < TaskMonitor::CfgCoreCount; coreId++) {
+    payload[payloadSize++] = stats.coreLoad[coreId];
+    payload[payloadSize++] = stats.corePeakLoad[coreId];
+  }
+  for (int i = 0; i < stats.tasksCount; i++) {
+    const TaskMonitor::TaskStats &task = stats.tasks[i];
+    int nameSize = strlen(task.name) + 1;
+    if (payloadSize + 10 + nameSize > sizeof(payload)) break;
+    writeUint32(payload + payloadSize, task.stackSize);
+    writeUint32(payload + payloadSize + 4, task.stackFree);
+    payload[payloadSize + 8] = task.load == TaskMonitor::CfgNoLoad ? 0xff : task.load;
+    payload[payloadSize + 9] = task.load == TaskMonitor::CfgNoLoad ? 0xff : task.peakLoad;
+    memcpy(payload + payloadSize + 10, task.name, nameSize);
+    payloadSize += 10 + nameSize;
+  }
+  sendAck(CfgCmdTaskStats, payload, payloadSize);
+}
+
+void SerialProtocol::sendAck(uint8_t type, const byte *payload, int payloadSize)
+{
+  sendFrame(type | CfgRspFlag, payload, payloadSize);
+}
+
+void SerialProtocol::sendError(uint8_t type, uint8_t errorCode)
+{
+  byte payload[2] = { type, errorCode };
+  sendFrame(CfgRspError, payload, sizeof(payload));
+}
+
+bool SerialProtocol::sendFrame(uint8_t type, const byte *payload, int payloadSize)
+{
+  if (payloadSize > CfgMaxFrameSize - 3) return false;
+
+  uint16_t crc = crc16(&type, 1);
+  crc = crc16(payload, payloadSize, crc);
+  byte crcBytes[2] = { (byte)(crc & 0xff), (byte)(crc >> 8) };
+
+  int frameSize = 0;
+  txFrame_[frameSize++] = CfgFend;
+  auto append = [this, &frameSize](const byte *data, int dataSize) {
+    for (int i = 0; i < dataSize; i++) {
+      if (data[i] == CfgFend) {
+        txFrame_[frameSize++] = CfgFesc;
+        txFrame_[frameSize++] = CfgTfend;
+      } else if (data[i] == CfgFesc) {
+        txFrame_[frameSize++] = CfgFesc;
+        txFrame_[frameSize++] = CfgTfesc;
+      } else {
+        txFrame_[frameSize++] = data[i];
+      }
+    }
+  };
+  append(&type, 1);
+  append(payload, payloadSize);
+  append(crcBytes, sizeof(crcBytes));
+  txFrame_[frameSize++] = CfgFend;
+
+  // never wait for the port, drop if host is not reading fast enough
+  if (Serial.availableForWrite() < frameSize) {
+    txDropped_++;
+    return false;
+  }
+  Serial.write(txFrame_, frameSize);
+  return true;
+}
+
+uint16_t SerialProtocol::crc16(const byte *data, int dataLen, uint16_t crc)
+{
+  // CRC-16/CCITT-FALSE, polynomial 0x1021
+  for (int i = 0; i < dataLen; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void SerialProtocol::writeUint32(byte *buf, uint32_t value)
+{
+  buf[0] = value & 0xff;
+  buf[1] = (value >> 8) & 0xff;
+  buf[2] = (value >> 16) & 0xff;
+  buf[3] = (value >> 24) & 0xff;
+}
+
+} // LoraDv
@@ -0,0 +1,101 @@
+#include "hal/stats_screen.h"
+
+namespace LoraDv {
+
+StatsScreen::StatsScreen(std::shared_ptr<const Config> config, std::shared_ptr<Adafruit_SSD1306> display)
+  : config_(config)
+  , display_(display)
+  , lastRadioStats_{}
+  , lastDrawMs_(0)
+  , bitRate_(0)
+  , dutyCycle_(0)
+  , lossPercent_(0)
+  , hasLastStats_(false)
+{
+}
+
+void StatsScreen::reset()
+{
+  hasLastStats_ = false;
+  lastDrawMs_ = 0;
+  bitRate_ = 0;
+  dutyCycle_ = 0;
+  lossPercent_ = 0;
+}
+
+uint32_t StatsScreen::getLoopTimeoutMs() const
+{
+  uint32_t elapsedMs = millis() - lastDrawMs_;
+  return (!hasLastStats_ || elapsedMs >= CfgRefreshMs) ? 0 : CfgRefreshMs - elapsedMs;
+}
+
+bool StatsScreen::loop(const RadioTask::Stats &radioStats, const AudioTask::Stats &audioStats)
+{
+  uint32_t nowMs = millis();
+  if (hasLastStats_ && nowMs - lastDrawMs_ < CfgRefreshMs) return false;
+
+  // rates over the refresh interval, smoothed to be readable
+  if (hasLastStats_) {
+    float intervalMs = nowMs - lastDrawMs_;
+    uint32_t bytes = (radioStats.rxBytes - lastRadioStats_.rxBytes) + (radioStats.txBytes - lastRadioStats_.txBytes);
+    bitRate_ = smooth(bitRate_, 8.0f * bytes / intervalMs);
+    dutyCycle_ = smooth(dutyCycle_, 100.0f * (radioStats.airtimeMs - lastRadioStats_.airtimeMs) / intervalMs);
+    uint32_t received = radioStats.rxPackets - lastRadioStats_.rxPackets;
+    uint32_t lost = (radioStats.rxLost - lastRadioStats_.rxLost) + (radioStats.rxErrors - lastRadioStats_.rxErrors);
+    if (received + lost > 0) {
+      lossPercent_ = smooth(lossPercent_, 100.0f * lost / (received + lost));
+    }
+  }
+  lastRadioStats_ = radioStats;
+  lastDrawMs_ = nowMs;
+  hasLastStats_ = true;
+
+  display_->clearDisplay();
+  display_->setTextSize(1);
+  display_->setTextColor(WHITE);
+  char text[24];
+
+  // signal bars with values
+  display_->setCursor(0, 0);
+  display_->print("S");
+  drawBar(0, radioStats.rssi, CfgRssiMin, CfgRssiMax);
+  snprintf(text, sizeof(text), "%d", (int)radioStats.rssi);
+  display_->setCursor(CfgBarX + CfgBarWidth + 4, 0);
+  display_->print(text);
+
+  display_->setCursor(0, 8);
+  display_->print("N");
+  drawBar(8, radioStats.snr, CfgSnrMin, CfgSnrMax);
+  snprintf(text, sizeof(text), "%.1f", radioStats.snr);
+  display_->setCursor(CfgBarX + CfgBarWidth + 4, 8);
+  display_->print(text);
+
+  // loss, rx queue depth, codec and its bit rate
+  snprintf(text, sizeof(text), "L%.1f%% Q%u %s%u", lossPercent_, radioStats.rxQueueDepth,
+    config_->AudioCodec == CFG_AUDIO_CODEC_CODEC2 ? "C2:" : "OP:", audioStats.codecBitRate);
+  display_->setCursor(0, 16);
+  display_->print(text);
+
+  // effective bit rate on air and airtime duty cycle
+  snprintf(text, sizeof(text), "%.1fkbps Air%.0f%%", bitRate_, dutyCycle_);
+  display_->setCursor(0, 24);
+  display_->print(text);
+
+  display_->display();
+  return true;
+}
+
+void StatsScreen::drawBar(int y, float value, float minValue, float maxValue) const
+{
+  float ratio = (value - minValue) / (maxValue - minValue);
+  ratio = constrain(ratio, 0.0f, 1.0f);
+  display_->drawRect(CfgBarX, y, CfgBarWidth, CfgBarHeight, WHITE);
+  display_->fillRect(CfgBarX, y, (int)(CfgBarWidth * ratio), CfgBarHeight, WHITE);
+}
+
+float StatsScreen::smooth(float average, float sample)
+{
+  return average + CfgRateSmoothing * (sample - average);
+}
+
+} // LoraDv
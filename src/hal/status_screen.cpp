@@ -0,0 +1,123 @@
+#include "hal/status_screen.h"
+
+namespace LoraDv {
+
+// first line is small text, second line is large text at the bottom half
+const StatusScreen::FieldLayout StatusScreen::Layout[StatusScreen::CfgFieldsCount] = {
+  { 0, 0, 30, 1 },      // volume, "[10]"
+  { 30, 0, 36, 1 },     // battery voltage, "3.95V"
+  { 66, 0, 62, 1 },     // rssi or dropped packets
+  { 0, 18, 90, 2 },     // frequency, "433.775"
+  { 96, 18, 32, 2 }     // mode, "TX", "RX"
+};
+
+StatusScreen::StatusScreen(std::shared_ptr<Adafruit_SSD1306> display, uint8_t i2cAddress)
+  : display_(display)
+  , i2cAddress_(i2cAddress)
+  , isInvalidated_(true)
+{
+  for (int fieldId = 0; fieldId < CfgFieldsCount; fieldId++) {
+    texts_[fieldId][0] = '\0';
+    isFieldDirty_[fieldId] = true;
+  }
+  for (int page = 0; page < CfgMaxPages; page++) {
+    dirtyColStart_[page] = -1;
+    dirtyColEnd_[page] = -1;
+  }
+}
+
+void StatusScreen::setField(Field field, const char *text)
+{
+  int fieldId = (int)field;
+  if (strncmp(texts_[fieldId], text, CfgMaxFieldLen - 1) == 0) return;
+  strncpy(texts_[fieldId], text, CfgMaxFieldLen - 1);
+  texts_[fieldId][CfgMaxFieldLen - 1] = '\0';
+  isFieldDirty_[fieldId] = true;
+}
+
+void StatusScreen::invalidate()
+{
+  // display content was overwritten, e.g. by the settings menu or sleep
+  isInvalidated_ = true;
+}
+
+void StatusScreen::update()
+{
+  if (isInvalidated_) {
+    display_->clearDisplay();
+    for (int fieldId = 0; fieldId < CfgFieldsCount; fieldId++) {
+      drawField(fieldId);
+    }
+    display_->display();
+    isInvalidated_ = false;
+    for (int page = 0; page < CfgMaxPages; page++) {
+      dirtyColStart_[page] = -1;
+    }
+    return;
+  }
+  for (int fieldId = 0; fieldId < CfgFieldsCount; fieldId++) {
+    if (!isFieldDirty_[fieldId]) continue;
+    const FieldLayout &layout = Layout[fieldId];
+    display_->fillRect(layout.x, layout.y, layout.w, 8 * layout.textSize, BLACK);
+    drawField(fieldId);
+    markDirty(layout.x, layout.y, layout.w, 8 * layout.textSize);
+  }
+  int pagesCount = min(display_->height() / 8, CfgMaxPages);
+  for (int page = 0; page < pagesCount; page++) {
+    if (dirtyColStart_[page] < 0) continue;
+    pushPage(page, dirtyColStart_[page], dirtyColEnd_[page]);
+    dirtyColStart_[page] = -1;
+  }
+}
+
+void StatusScreen::drawField(int fieldId)
+{
+  const FieldLayout &layout = Layout[fieldId];
+  display_->setTextSize(layout.textSize);
+  display_->setTextColor(WHITE);
+  display_->setCursor(layout.x, layout.y);
+  display_->print(texts_[fieldId]);
+  isFieldDirty_[fieldId] = false;
+}
+
+void StatusScreen::markDirty(int x, int y, int w, int h)
+{
+  int colStart = max(x, 0);
+  int colEnd = min(x + w, (int)display_->width()) - 1;
+  int pageStart = max(y, 0) / 8;
+  int pageEnd = min((y + h - 1) / 8, min(display_->height() / 8, CfgMaxPages) - 1);
+  for (int page = pageStart; page <= pageEnd; page++) {
+    if (dirtyColStart_[page] < 0) {
+      dirtyColStart_[page] = colStart;
+      dirtyColEnd_[page] = colEnd;
+    } else {
+      dirtyColStart_[page] = min((int)dirtyColStart_[page], colStart);
+      dirtyColEnd_[page] = max((int)dirtyColEnd_[page], colEnd);
+    }
+  }
+}
+
+void StatusScreen::pushPage(int page, int colStart, int colEnd)
+{
+  // limit display ram window to the changed part of the page
+  display_->ssd1306_command(SSD1306_PAGEADDR);
+  display_->ssd1306_command(page);
+  display_->ssd1306_command(page);
+  display_->ssd1306_command(SSD1306_COLUMNADDR);
+  display_->ssd1306_command(colStart);
+  display_->ssd1306_command(colEnd);
+
+  const uint8_t *data = display_->getBuffer() + page * display_->width() + colStart;
+  int dataLen = colEnd - colStart + 1;
+  while (dataLen > 0) {
+    int chunkLen = min(dataLen, CfgI2cChunkSize);
+    Wire.beginTransmission(i2cAddress_);
+    Wire.write(CfgI2cDataControl);
+    Wire.write(data, chunkLen);
+    Wire.endTransmission();
+    data += chunkLen;
+    dataLen -= chunkLen;
+  }
+}
+
+} // LoraDv
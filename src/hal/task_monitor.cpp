@@ -0,0 +1,196 @@
+#include "hal/task_monitor.h"
+
+namespace LoraDv {
+
+void (* const TaskMonitor::tickHooks_[TaskMonitor::CfgCoreCount])() = {
+  &TaskMonitor::onTick<0>,
+  &TaskMonitor::onTick<1>
+};
+TaskHandle_t TaskMonitor::idleTaskHandles_[TaskMonitor::CfgCoreCount] = { nullptr, nullptr };
+volatile uint32_t TaskMonitor::tickCounts_[TaskMonitor::CfgCoreCount] = { 0, 0 };
+volatile uint32_t TaskMonitor::idleTickCounts_[TaskMonitor::CfgCoreCount] = { 0, 0 };
+
+TaskMonitor::TaskMonitor(std::shared_ptr<const Config> config)
+  : config_(config)
+  , taskMonitorTaskHandle_(0)
+  , taskHandles_{}
+  , stats_{}
+  , modeName_{}
+  , lastTickCounts_{}
+  , lastIdleTickCounts_{}
+  , lastRunTimes_{}
+  , lastTotalRunTime_(0)
+  , lastPeakLogMs_(0)
+  , isRunning_(false)
+{
+}
+
+void TaskMonitor::addTask(const char *name, TaskHandle_t taskHandle, uint32_t stackSize)
+{
+  // task is not started or list is full, monitored tasks must not be deleted
+  if (taskHandle == nullptr) return;
+  if (stats_.tasksCount >= CfgMaxTasks) {
+    LOG_ERROR("Too many tasks to monitor", name);
+    return;
+  }
+  TaskStats &task = stats_.tasks[stats_.tasksCount];
+  task.name = name;
+  task.stackSize = stackSize;
+  task.stackFree = stackSize;
+  task.load = CfgNoLoad;
+  task.peakLoad = 0;
+  taskHandles_[stats_.tasksCount++] = taskHandle;
+}
+
+void TaskMonitor::start()
+{
+  updateModeName();
+  for (int coreId = 0; coreId < CfgCoreCount; coreId++) {
+    idleTaskHandles_[coreId] = xTaskGetIdleTaskHandleForCPU(coreId);
+    if (esp_register_freertos_tick_hook_for_cpu(tickHooks_[coreId], coreId) != ESP_OK) {
+      LOG_ERROR("Failed to register tick hook for core", coreId);
+    }
+  }
+  isRunning_ = true;
+  xTaskCreatePinnedToCore(&task, "TaskMonitor", CfgTaskStack, this, CfgTaskPriority, &taskMonitorTaskHandle_, CfgCoreId);
+}
+
+template<int CoreId>
+IRAM_ATTR void TaskMonitor::onTick()
+{
+  tickCounts_[CoreId]++;
+  if (xTaskGetCurrentTaskHandle() == idleTaskHandles_[CoreId]) idleTickCounts_[CoreId]++;
+}
+
+void TaskMonitor::task(void *param)
+{
+  static_cast<TaskMonitor*>(param)->taskMonitorTask();
+}
+
+void TaskMonitor::taskMonitorTask()
+{
+  LOG_INFO("Task monitor started for", modeName_);
+  addTask("TaskMonitor", xTaskGetCurrentTaskHandle(), CfgTaskStack);
+
+  while (isRunning_) {
+    vTaskDelay(pdMS_TO_TICKS(config_->TaskMonitorIntervalMs_));
+    bool isNewPeak = sampleCoreLoad();
+    isNewPeak |= sampleStacks();
+    isNewPeak |= sampleTaskLoad();
+    statsLock_.write(stats_);
+
+    uint32_t nowMs = millis();
+    if (isNewPeak && nowMs - lastPeakLogMs_ >= CfgPeakLogIntervalMs) {
+      lastPeakLogMs_ = nowMs;
+      logPeaks();
+    }
+  }
+
+  for (int coreId = 0; coreId < CfgCoreCount; coreId++) {
+    esp_deregister_freertos_tick_hook_for_cpu(tickHooks_[coreId], coreId);
+  }
+  LOG_INFO("Task monitor stopped");
+  vTaskDelete(NULL);
+}
+
+bool TaskMonitor::sampleCoreLoad()
+{
+  bool isNewPeak = false;
+  for (int coreId = 0; coreId < CfgCoreCount; coreId++) {
+    uint32_t tickCount = tickCounts_[coreId];
+    uint32_t idleTickCount = idleTickCounts_[coreId];
+    uint32_t ticks = tickCount - lastTickCounts_[coreId];
+    uint32_t idleTicks = idleTickCount - lastIdleTickCounts_[coreId];
+    lastTickCounts_[coreId] = tickCount;
+    lastIdleTickCounts_[coreId] = idleTickCount;
+    // core was sleeping for the whole interval
+    if (ticks == 0) continue;
+
+    uint32_t load = 100 - min(idleTicks, ticks) * 100 / ticks;
+    stats_.coreLoad[coreId] = load;
+    if (load > stats_.corePeakLoad[coreId]) {
+      stats_.corePeakLoad[coreId] = load;
+      isNewPeak = true;
+    }
+  }
+  return isNewPeak;
+}
+
+bool TaskMonitor::sampleStacks()
+{
+  bool isNewPeak = false;
+  for (int i = 0; i < stats_.tasksCount; i++) {
+    // stack is counted in bytes on esp32
+    uint32_t stackFree = uxTaskGetStackHighWaterMark(taskHandles_[i]);
+    if (stackFree < stats_.tasks[i].stackFree) {
+      stats_.tasks[i].stackFree = stackFree;
+      isNewPeak = true;
+    }
+  }
+  return isNewPeak;
+}
+
+bool TaskMonitor::sampleTaskLoad()
+{
+#if configGENERATE_RUN_TIME_STATS == 1
+  TaskStatus_t taskStatuses[CfgMaxSystemTasks];
+  uint32_t totalRunTime = 0;
+  UBaseType_t statusCount = uxTaskGetSystemState(taskStatuses, CfgMaxSystemTasks, &totalRunTime);
+  uint32_t elapsedRunTime = totalRunTime - lastTotalRunTime_;
+  bool isFirstSample = lastTotalRunTime_ == 0;
+  lastTotalRunTime_ = totalRunTime;
+  if (statusCount == 0 || elapsedRunTime == 0) return false;
+
+  bool isNewPeak = false;
+  for (int i = 0; i < stats_.tasksCount; i++) {
+    for (int j = 0; j < statusCount; j++) {
+      if (taskStatuses[j].xHandle != taskHandles_[i]) continue;
+      uint32_t runTime = taskStatuses[j].ulRunTimeCounter;
+      uint32_t elapsedTaskRunTime = runTime - lastRunTimes_[i];
+      lastRunTimes_[i] = runTime;
+      // counters of tasks added after previous sample start from boot
+      if (isFirstSample || elapsedTaskRunTime > elapsedRunTime) break;
+      TaskStats &task = stats_.tasks[i];
+      task.load = (uint64_t)elapsedTaskRunTime * 100 / elapsedRunTime;
+      if (task.load > task.peakLoad) {
+        task.peakLoad = task.load;
+        isNewPeak = true;
+      }
+      break;
+    }
+  }
+  return isNewPeak;
+#else
+  // per task load needs run time stats in freertos configuration, core load is still available
+  return false;
+#endif
+}
+
+void TaskMonitor::updateModeName()
+{
+  if (config_->AudioCodec == CFG_AUDIO_CODEC_OPUS) {
+    snprintf(modeName_, sizeof(modeName_), "opus %d c%d", config_->AudioOpusRate, config_->AudioOpusComplexity_);
+  } else {
+    snprintf(modeName_, sizeof(modeName_), "codec2 mode %d", config_->AudioCodec2Mode);
+  }
+}
+
+void TaskMonitor::logPeaks() const
+{
+  Stats stats = getStats();
+  LOG_INFO("Task peaks for", modeName_);
+  for (int coreId = 0; coreId < CfgCoreCount; coreId++) {
+    LOG_INFO("Core", coreId, "load", stats.coreLoad[coreId], "peak", stats.corePeakLoad[coreId]);
+  }
+  for (int i = 0; i < stats.tasksCount; i++) {
+    const TaskStats &task = stats.tasks[i];
+    if (task.load == CfgNoLoad) {
+      LOG_INFO("Task", task.name, "stack free", task.stackFree, "of", task.stackSize);
+    } else {
+      LOG_INFO("Task", task.name, "stack free", task.stackFree, "of", task.stackSize, "load", task.load,
+        "peak", task.peakLoad);
+    }
+  }
+}
+
+} // LoraDv
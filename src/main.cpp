@@ -5,12 +5,12 @@
 
 using namespace LoraDv;
 
-static constexpr int LoopDelayMs = 10;
-
 std::shared_ptr<Config> config_;
 std::shared_ptr<Service> service_;
 
 void setup() {
+  // without tx ring only the uart fifo is writable, larger protocol frames would always be dropped
+  Serial.setTxBufferSize(SerialProtocol::CfgTxBufferSize);
   Serial.begin(SERIAL_BAUD_RATE);
   while (!Serial);
 
@@ -22,7 +22,7 @@ void setup() {
 }
 
 void loop() {
+  // blocks until there is something to do
   service_->loop();
-  delay(LoopDelayMs);
 }
 
@@ -0,0 +1,254 @@
+#include "protocol/m17_framer.h"
+
+namespace LoraDv {
+
+// xored with interleaved frame bits, so long runs of the same bit are avoided
+const uint8_t M17Framer::RandomSequence[M17Framer::CfgBits / 8] = {
+  0xd6, 0xb5, 0xe2, 0x30, 0x82, 0xff, 0x84, 0x62, 0xba, 0x4e, 0x96, 0x90, 0xd8, 0x98, 0xdd, 0x5d, 
+  0x0c, 0xc8, 0x52, 0x43, 0x91, 0x1d, 0xf8, 0x6e, 0x68, 0x2f, 0x35, 0xda, 0x14, 0xea, 0xcd, 0x76, 
+  0x19, 0x8d, 0xd5, 0x80, 0xd1, 0x33, 0x87, 0x13, 0x57, 0x18, 0x2d, 0x29, 0x78, 0xc3
+};
+
+// base-40 callsign alphabet, index 0 is padding
+const char M17Framer::Charset[41] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-/.";
+
+M17Framer::M17Framer()
+  : convCode_(CfgLsfDataBits)
+  , txFrameNumber_(0)
+  , isRxLsfValid_(false)
+  , rxLichMask_(0)
+{
+  // P1 is 1 followed by 15 repetitions of 1011, P2 drops every 12th bit
+  punctureP1_[0] = 1;
+  for (int i = 1; i < CfgPunctureP1Len; i++) {
+    punctureP1_[i] = (i - 1) % 4 != 1;
+  }
+  for (int i = 0; i < CfgPunctureP2Len; i++) {
+    punctureP2_[i] = i != CfgPunctureP2Len - 1;
+  }
+  // quadratic permutation polynomial interleaver
+  for (uint32_t i = 0; i < CfgBits; i++) {
+    interleave_[i] = (45 * i + 92 * i * i) % CfgBits;
+  }
+  memset(txLsf_, 0, sizeof(txLsf_));
+  memset(rxLsf_, 0, sizeof(rxLsf_));
+  memset(rxLichLsf_, 0, sizeof(rxLichLsf_));
+}
+
+bool M17Framer::setLsf(const char *dst, const char *src, uint16_t type)
+{
+  // dst, src, type, meta, crc
+  memset(txLsf_, 0, sizeof(txLsf_));
+  if (!encodeCallsign(dst, txLsf_) || !encodeCallsign(src, txLsf_ + 6)) return false;
+  txLsf_[12] = type >> 8;
+  txLsf_[13] = type & 0xff;
+  uint16_t crc = crc16(txLsf_, CfgLsfSize - 2);
+  txLsf_[CfgLsfSize - 2] = crc >> 8;
+  txLsf_[CfgLsfSize - 1] = crc & 0xff;
+  return true;
+}
+
+void M17Framer::startStream()
+{
+  txFrameNumber_ = 0;
+}
+
+int M17Framer::encodeLsf(byte *frame)
+{
+  convCode_.encode(txLsf_, CfgLsfDataBits, punctureP1_, CfgPunctureP1Len, bits_);
+  return finishFrame(CfgSyncLsf, bits_, frame);
+}
+
+int M17Framer::encodeStream(const byte *payload, int payloadSize, bool isLast, byte *frame)
+{
+  // lich chunk, counter in the top bits of the last byte
+  int chunkId = txFrameNumber_ % CfgLichChunks;
+  byte lich[CfgLichChunkSize + 1];
+  memcpy(lich, txLsf_ + chunkId * CfgLichChunkSize, CfgLichChunkSize);
+  lich[CfgLichChunkSize] = chunkId << 5;
+  for (int i = 0; i < 4; i++) {
+    const byte *word = lich + 3 * (i / 2);
+    uint16_t data = (i & 1) ? ((word[1] & 0x0f) << 8) | word[2] : (word[0] << 4) | (word[1] >> 4);
+    uint32_t codeword = golay_.encode(data);
+    for (int bit = 0; bit < 24; bit++) {
+      bits_[24 * i + bit] = (codeword >> (23 - bit)) & 1;
+    }
+  }
+
+  // frame number and payload, short payload is padded with zeros
+  byte data[CfgStreamDataBits / 8];
+  uint16_t frameNumber = txFrameNumber_ | (isLast ? CfgFrameNumberLast : 0);
+  data[0] = frameNumber >> 8;
+  data[1] = frameNumber & 0xff;
+  memset(data + 2, 0, CfgPayloadSize);
+  memcpy(data + 2, payload, min(payloadSize, (int)CfgPayloadSize));
+  convCode_.encode(data, CfgStreamDataBits, punctureP2_, CfgPunctureP2Len, bits_ + CfgLichBits);
+
+  txFrameNumber_ = (txFrameNumber_ + 1) & ~CfgFrameNumberLast;
+  return finishFrame(CfgSyncStream, bits_, frame);
+}
+
+int M17Framer::encodeEot(byte *frame)
+{
+  for (int i = 0; i < CfgFrameSize; i += CfgSyncSize) {
+    frame[i] = CfgSyncEot >> 8;
+    frame[i + 1] = CfgSyncEot & 0xff;
+  }
+  return CfgFrameSize;
+}
+
+int M17Framer::finishFrame(uint16_t sync, const uint8_t *bits, byte *frame) const
+{
+  frame[0] = sync >> 8;
+  frame[1] = sync & 0xff;
+  byte *payload = frame + CfgSyncSize;
+  memset(payload, 0, CfgBits / 8);
+  for (int i = 0; i < CfgBits; i++) {
+    if (bits[interleave_[i]]) payload[i >> 3] |= 0x80 >> (i & 7);
+  }
+  for (int i = 0; i < CfgBits / 8; i++) {
+    payload[i] ^= RandomSequence[i];
+  }
+  return CfgFrameSize;
+}
+
+bool M17Framer::readFrameBits(const byte *frame, uint8_t *softBits) const
+{
+  // derandomize and deinterleave into soft bits, radio gives hard decisions
+  const byte *payload = frame + CfgSyncSize;
+  for (int i = 0; i < CfgBits; i++) {
+    uint8_t bit = ((payload[i >> 3] ^ RandomSequence[i >> 3]) >> (7 - (i & 7))) & 1;
+    softBits[interleave_[i]] = bit ? ConvCode::CfgSoftOne : ConvCode::CfgSoftZero;
+  }
+  return true;
+}
+
+M17Framer::FrameType M17Framer::decode(const byte *frame, int frameSize, byte *payload, bool &isLast)
+{
+  if (frameSize != CfgFrameSize) return FrameType::Invalid;
+  uint16_t sync = ((uint16_t)frame[0] << 8) | frame[1];
+  // few bit errors in the sync word are tolerated
+  auto isSync = [sync](uint16_t expected) { return __builtin_popcount(sync ^ expected) <= 2; };
+  
+  if (isSync(CfgSyncStream)) {
+    readFrameBits(frame, bits_);
+    // lich is useful for late entry, payload is decoded even if lich is damaged
+    byte lich[CfgLichChunkSize + 1];
+    bool isLichValid = true;
+    for (int i = 0; i < 4; i++) {
+      uint32_t codeword = 0;
+      for (int bit = 0; bit < 24; bit++) {
+        codeword = (codeword << 1) | (bits_[24 * i + bit] ? 1 : 0);
+      }
+      uint16_t data;
+      isLichValid &= golay_.decode(codeword, data);
+      byte *word = lich + 3 * (i / 2);
+      if (i & 1) {
+        word[1] = (word[1] & 0xf0) | (data >> 8);
+        word[2] = data & 0xff;
+      } else {
+        word[0] = data >> 4;
+        word[1] = (data & 0x0f) << 4;
+      }
+    }
+    if (isLichValid) storeLichChunk(lich);
+
+    byte data[CfgStreamDataBits / 8];
+    convCode_.decode(bits_ + CfgLichBits, CfgBits - CfgLichBits, punctureP2_, CfgPunctureP2Len, 
+      data, CfgStreamDataBits);
+    isLast = data[0] & (CfgFrameNumberLast >> 8);
+    memcpy(payload, data + 2, CfgPayloadSize);
+    return FrameType::Stream;
+  }
+  if (isSync(CfgSyncLsf)) {
+    readFrameBits(frame, bits_);
+    byte lsf[CfgLsfSize];
+    convCode_.decode(bits_, CfgBits, punctureP1_, CfgPunctureP1Len, lsf, CfgLsfDataBits);
+    if (crc16(lsf, CfgLsfSize) != 0) return FrameType::Invalid;
+    memcpy(rxLsf_, lsf, CfgLsfSize);
+    isRxLsfValid_ = true;
+    rxLichMask_ = 0;
+    return FrameType::Lsf;
+  }
+  if (isSync(CfgSyncEot)) {
+    isLast = true;
+    return FrameType::Eot;
+  }
+  return FrameType::Invalid;
+}
+
+void M17Framer::storeLichChunk(const byte *lich)
+{
+  int chunkId = lich[CfgLichChunkSize] >> 5;
+  if (chunkId >= CfgLichChunks) return;
+  memcpy(rxLichLsf_ + chunkId * CfgLichChunkSize, lich, CfgLichChunkSize);
+  rxLichMask_ |= 1 << chunkId;
+  if (rxLichMask_ != (1 << CfgLichChunks) - 1) return;
+  // all chunks are collected, lsf is used if it is consistent
+  rxLichMask_ = 0;
+  if (crc16(rxLichLsf_, CfgLsfSize) == 0) {
+    memcpy(rxLsf_, rxLichLsf_, CfgLsfSize);
+    isRxLsfValid_ = true;
+  }
+}
+
+bool M17Framer::getRxSource(char *src, int srcLen) const
+{
+  return isRxLsfValid_ && decodeCallsign(rxLsf_ + 6, src, srcLen);
+}
+
+bool M17Framer::encodeCallsign(const char *text, byte *address)
+{
+  uint64_t value = 0;
+  if (strcmp(text, "@ALL") == 0) {
+    value = 0xffffffffffffULL;
+  } else {
+    int len = strlen(text);
+    if (len == 0 || len > CfgMaxCallsignLen) return false;
+    // first character is the least significant digit
+    for (int i = len - 1; i >= 0; i--) {
+      const char *c = strchr(Charset + 1, toupper(text[i]));
+      if (c == nullptr || *c == '\0') return false;
+      value = value * 40 + (c - Charset);
+    }
+  }
+  for (int i = 5; i >= 0; i--) {
+    address[i] = value & 0xff;
+    value >>= 8;
+  }
+  return true;
+}
+
+bool M17Framer::decodeCallsign(const byte *address, char *text, int textLen)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < 6; i++) {
+    value = (value << 8) | address[i];
+  }
+  if (value == 0xffffffffffffULL) {
+    snprintf(text, textLen, "@ALL");
+    return true;
+  }
+  int len = 0;
+  while (value > 0 && len < textLen - 1) {
+    text[len++] = Charset[value % 40];
+    value /= 40;
+  }
+  text[len] = '\0';
+  return len > 0 && value == 0;
+}
+
+uint16_t M17Framer::crc16(const byte *data, int dataLen)
+{
+  // polynomial 0x5935, initial value 0xffff
+  uint16_t crc = 0xffff;
+  for (int i = 0; i < dataLen; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x5935 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+} // LoraDv
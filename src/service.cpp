@@ -3,17 +3,33 @@
 namespace LoraDv {
 
 std::shared_ptr<AiEsp32RotaryEncoder> Service::rotaryEncoder_;
+std::shared_ptr<EventNotifier> Service::eventNotifier_ = std::make_shared<EventNotifier>();
+DMA_ATTR uint8_t Service::arenaBuffer_[Service::CfgArenaSize];
 
 Service::Service(std::shared_ptr<Config> config)
   : config_(config)
-  , display_(std::make_shared<Adafruit_SSD1306>(CfgDisplayWidth, CfgDisplayHeight, &Wire, -1))
+  , arena_(std::make_shared<MemoryArena>("tasks", arenaBuffer_, CfgArenaSize))
+  , display_(std::make_shared<Adafruit_SSD1306>(CfgDisplayWidth, CfgDisplayHeight, &Wire, -1, 
+      config->DisplayI2cClock_, config->DisplayI2cClock_))
+  , statusScreen_(std::make_shared<StatusScreen>(display_, CfgDisplayI2cAddress))
+  , statsScreen_(std::make_shared<StatsScreen>(config, display_))
   , pmService_(std::make_shared<PmService>(config, display_))
   , hwMonitor_(std::make_shared<HwMonitor>(config))
-  , radioTask_(std::make_shared<RadioTask>(config))
-  , audioTask_(std::make_shared<AudioTask>(config, pmService_))
-  , settingsMenu_(nullptr)
+  , taskMonitor_(std::make_shared<TaskMonitor>(config))
+  , dataLink_(std::make_shared<DataLink>())
+  , privacyStore_(std::make_shared<PrivacyStore>())
+  , radioTask_(nullptr)
+  , auxRadioTask_(nullptr)
+  , voiceRecorder_(std::make_shared<VoiceRecorder>(config))
+  , serialProtocol_(std::make_shared<SerialProtocol>(config, dataLink_))
+  , audioTask_(std::make_shared<AudioTask>(config, eventNotifier_, pmService_, voiceRecorder_, serialProtocol_, arena_))
+  , settingsMenu_(std::make_shared<SettingsMenu>(config, taskMonitor_))
   , btnPressed_(false)
+  , isStatsVisible_(false)
+  , isClickPending_(false)
+  , clickMs_(0)
 {
+  setupRadios();
   rotaryEncoder_ = std::make_shared<AiEsp32RotaryEncoder>(config->EncoderPinA_, config->EncoderPinB_, 
     config->EncoderPinBtn_, config->EncoderPinVcc_, config->EncoderSteps_);
 }
@@ -22,6 +38,9 @@ void Service::setup()
 {
   LOG_SET_LEVEL(config_->LogLevel);
   LOG_INFO("Board setup started");
+
+  // ui events are delivered to the task running setup and loop
+  eventNotifier_->attach();
  
   // setup bootloader random source as WiFi and BT are not used
   bootloader_random_enable();
@@ -30,12 +49,69 @@ void Service::setup()
   setupScreen();
   setupPttButton();
 
-  audioTask_->start(radioTask_);
-  radioTask_->start(audioTask_);
+  privacyStore_->start();
+  if (config_->RecorderMode != CFG_RECORDER_MODE_OFF) voiceRecorder_->start();
+  audioTask_->start(getRxRadioTask(), getTxRadioTask());
+  radioTask_->start(audioTask_, getTxRadioTask());
+  if (auxRadioTask_) auxRadioTask_->start(audioTask_, getTxRadioTask());
+  if (config_->SerialProtocolEnabled_) serialProtocol_->start(audioTask_, getRxRadioTask(), getTxRadioTask(), taskMonitor_);
+  hwMonitor_->start(getTxRadioTask());
+  pmService_->start(audioTask_, getRxRadioTask(), hwMonitor_);
+  if (config_->TaskMonitorEnabled_) setupTaskMonitor();
 
   updateScreen();
 
   LOG_INFO("Board setup completed");
+  logMemoryUsage();
+}
+
+void Service::setupTaskMonitor()
+{
+  // tasks which are not started have no handle and are skipped
+  taskMonitor_->addTask("LoopTask", xTaskGetCurrentTaskHandle(), getArduinoLoopTaskStackSize());
+  taskMonitor_->addTask("AudioTask", audioTask_->getTaskHandle(), audioTask_->getTaskStackSize());
+  taskMonitor_->addTask("RadioTask0", radioTask_->getTaskHandle(), radioTask_->getTaskStackSize());
+  if (auxRadioTask_) taskMonitor_->addTask("RadioTask1", auxRadioTask_->getTaskHandle(), auxRadioTask_->getTaskStackSize());
+  taskMonitor_->addTask("SerialTask", serialProtocol_->getTaskHandle(), serialProtocol_->getTaskStackSize());
+  taskMonitor_->addTask("RecorderTask", voiceRecorder_->getTaskHandle(), voiceRecorder_->getTaskStackSize());
+  taskMonitor_->addTask("HwMonitorTask", hwMonitor_->getTaskHandle(), hwMonitor_->getTaskStackSize());
+  taskMonitor_->start();
+}
+
+void Service::logMemoryUsage() const
+{
+  // minimum free is the high water mark since boot, largest block shows fragmentation
+  arena_->logUsage();
+  LOG_INFO("Internal heap free", heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+    "min", heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+    "largest", heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+  LOG_INFO("DMA heap free", heap_caps_get_free_size(MALLOC_CAP_DMA),
+    "min", heap_caps_get_minimum_free_size(MALLOC_CAP_DMA),
+    "largest", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
+}
+
+void Service::setupRadios()
+{
+  // second module takes over one direction, so rx and tx could run at the same time
+  if (config_->Lora2Mode_ == CFG_LORA2_MODE_RX) {
+    radioTask_ = std::make_shared<RadioTask>(config_, eventNotifier_, dataLink_, privacyStore_, arena_, 0, RadioTask::Role::TxOnly);
+    auxRadioTask_ = std::make_shared<RadioTask>(config_, eventNotifier_, dataLink_, privacyStore_, arena_, 1, RadioTask::Role::RxOnly);
+  } else if (config_->Lora2Mode_ == CFG_LORA2_MODE_TX) {
+    radioTask_ = std::make_shared<RadioTask>(config_, eventNotifier_, dataLink_, privacyStore_, arena_, 0, RadioTask::Role::RxOnly);
+    auxRadioTask_ = std::make_shared<RadioTask>(config_, eventNotifier_, dataLink_, privacyStore_, arena_, 1, RadioTask::Role::TxOnly);
+  } else {
+    radioTask_ = std::make_shared<RadioTask>(config_, eventNotifier_, dataLink_, privacyStore_, arena_, 0, RadioTask::Role::RxTx);
+  }
+}
+
+std::shared_ptr<RadioTask> Service::getRxRadioTask() const
+{
+  return auxRadioTask_ && auxRadioTask_->canReceive() ? auxRadioTask_ : radioTask_;
+}
+
+std::shared_ptr<RadioTask> Service::getTxRadioTask() const
+{
+  return auxRadioTask_ && auxRadioTask_->canTransmit() ? auxRadioTask_ : radioTask_;
 }
 
 void Service::setupEncoder() 
@@ -43,12 +119,13 @@ void Service::setupEncoder()
   LOG_INFO("Encoder setup started");
   rotaryEncoder_->begin();
   rotaryEncoder_->setup(isrReadEncoder);
+  attachInterrupt(digitalPinToInterrupt(config_->EncoderPinBtn_), isrEncoderButton, CHANGE);
   LOG_INFO("Encoder setup completed");
 }
 
 void Service::setupScreen() 
 {
-  if(display_->begin(SSD1306_SWITCHCAPVCC, 0x3C)) { 
+  if(display_->begin(SSD1306_SWITCHCAPVCC, CfgDisplayI2cAddress)) { 
     LOG_INFO("Display setup completed");
   } else {
     LOG_ERROR("Display init failed");
@@ -59,39 +136,59 @@ void Service::setupPttButton()
 {
   LOG_INFO("PTT setup started");
   pinMode(config_->PttBtnPin_, INPUT);
+  attachInterrupt(digitalPinToInterrupt(config_->PttBtnPin_), isrPttButton, CHANGE);
   LOG_INFO("PTT setup completed");
 }
 
 IRAM_ATTR void Service::isrReadEncoder()
 {
   rotaryEncoder_->readEncoder_ISR();
+  eventNotifier_->notifyFromIsr(EventNotifier::CfgEventEncoder);
+}
+
+IRAM_ATTR void Service::isrEncoderButton()
+{
+  eventNotifier_->notifyFromIsr(EventNotifier::CfgEventButton);
+}
+
+IRAM_ATTR void Service::isrPttButton()
+{
+  eventNotifier_->notifyFromIsr(EventNotifier::CfgEventPtt);
 }
 
 void Service::updateScreen() const
 {
+  // only changed fields are sent to the display
   bool isPlaying = audioTask_->isPlaying();
-  display_->clearDisplay();
-  display_->setTextColor(WHITE);
-  display_->setCursor(0, 0);
+  char text[16];
 
-  display_->setTextSize(1);
-  display_->print("["); display_->print(audioTask_->getVolume()); display_->print("] "); 
-  display_->print(hwMonitor_->getBatteryVoltage()); display_->print("V ");
+  snprintf(text, sizeof(text), "[%d]", audioTask_->getVolume());
+  statusScreen_->setField(StatusScreen::Field::Volume, text);
+  snprintf(text, sizeof(text), "%.2fV", hwMonitor_->getBatteryVoltage());
+  statusScreen_->setField(StatusScreen::Field::Battery, text);
   if (isPlaying)
-    display_->print(radioTask_->getRssi());
-  display_->println();
-
-  display_->setCursor(0, CfgDisplayHeight/2 + 2);
-  display_->setTextSize(2);
-  if (btnPressed_)
-    display_->print((float)config_->LoraFreqTx / 1e6, 3);
+    snprintf(text, sizeof(text), "%d", (int)getRxRadioTask()->getRssi());
+  else if (audioTask_->getStats().txOverDropped > 0)
+    snprintf(text, sizeof(text), "D%u", audioTask_->getStats().txOverDropped);
   else
-    display_->print((float)config_->LoraFreqRx / 1e6, 3);
-  display_->print(" "); 
-  display_->print(btnPressed_ ? "TX" : isPlaying ? "RX" : "--");
-  display_->println();
+    text[0] = '\0';
+  statusScreen_->setField(StatusScreen::Field::Level, text);
 
-  display_->display();
+  // talker callsign replaces frequency while receiving, ssid is dropped if it does not fit
+  RadioTask::HeardCallsign heard = getRxRadioTask()->getHeardCallsign();
+  if (isPlaying && heard.heardMs != 0 && millis() - heard.heardMs < CfgCallsignShowMs) {
+    snprintf(text, sizeof(text), "%s", heard.callsign);
+    char *ssid = strchr(text, '-');
+    if (ssid != nullptr && strlen(text) > CfgFreqFieldLen) *ssid = '\0';
+  } else {
+    long freq = btnPressed_ ? config_->LoraFreqTx : getRxRadioTask()->getRxFreq();
+    snprintf(text, sizeof(text), "%.3f", (float)freq / 1e6);
+  }
+  statusScreen_->setField(StatusScreen::Field::Freq, text);
+  statusScreen_->setField(StatusScreen::Field::Mode, btnPressed_ ? "TX" : isPlaying ? "RX" 
+    : config_->RepeaterEnabled ? "RP" : getRxRadioTask()->isScanning() ? "SC" : "--");
+
+  statusScreen_->update();
 }
 
 bool Service::processPttButton()
@@ -118,7 +215,7 @@ bool Service::processRotaryEncoder()
 
   if (encoderDelta != 0) {
     LOG_INFO("Encoder changed:", rotaryEncoder_->readEncoder(), encoderDelta);
-    if (settingsMenu_) {
+    if (settingsMenu_->isOpen()) {
       settingsMenu_->onEncoderPositionChanged(encoderDelta);
       settingsMenu_->draw(display_);
     } else {
@@ -130,22 +227,34 @@ bool Service::processRotaryEncoder()
 
   if (rotaryEncoder_->isEncoderButtonClicked()) {
     LOG_INFO("Encoder button clicked", esp_get_free_heap_size());
-    if (settingsMenu_) {
+    if (settingsMenu_->isOpen()) {
       settingsMenu_->onEncoderButtonClicked();
       settingsMenu_->draw(display_);
-    } else {
+    } else if (isClickPending_) {
+      // double click switches between status and link stats
+      isClickPending_ = false;
+      isStatsVisible_ = !isStatsVisible_;
+      statusScreen_->invalidate();
+      statsScreen_->reset();
       shouldUpdateScreen = true;
+    } else {
+      // single click is handled when it is clear that it is not a double click
+      isClickPending_ = true;
+      clickMs_ = millis();
     }
     pmService_->lightSleepReset();
   }
 
   if (rotaryEncoder_->isEncoderButtonClicked(CfgEncoderBtnLongMs)) {
     LOG_INFO("Encoder button long clicked");
-    if (settingsMenu_) {
-      settingsMenu_.reset();
+    if (settingsMenu_->isOpen()) {
+      settingsMenu_->close();
+      statusScreen_->invalidate();
+      statsScreen_->reset();
       shouldUpdateScreen = true;
+      logMemoryUsage();
     } else {
-      settingsMenu_ = std::make_shared<SettingsMenu>(config_);
+      settingsMenu_->open();
       settingsMenu_->draw(display_);
     }
     pmService_->lightSleepReset();
@@ -154,18 +263,56 @@ bool Service::processRotaryEncoder()
   return shouldUpdateScreen;
 }
 
+bool Service::processPendingClick()
+{
+  if (!isClickPending_ || millis() - clickMs_ < CfgDoubleClickMs) return false;
+  isClickPending_ = false;
+  // play back last recorded over
+  if (config_->RecorderMode != CFG_RECORDER_MODE_OFF) audioTask_->replay();
+  return true;
+}
+
+uint32_t Service::getLoopTimeoutMs() const
+{
+  // clicks are detected by polling while the button is held
+  if (digitalRead(config_->EncoderPinBtn_) == LOW || isClickPending_) return CfgButtonPollMs;
+
+  uint32_t timeoutMs = min(audioTask_->getLoopTimeoutMs(), pmService_->getLoopTimeoutMs());
+  timeoutMs = min(timeoutMs, radioTask_->getLoopTimeoutMs());
+  if (auxRadioTask_) timeoutMs = min(timeoutMs, auxRadioTask_->getLoopTimeoutMs());
+  if (isStatsVisible_ && !settingsMenu_->isOpen()) timeoutMs = min(timeoutMs, statsScreen_->getLoopTimeoutMs());
+  return timeoutMs;
+}
+
 void Service::loop() 
 {
+  // block until there is an event or some timer is due
+  uint32_t events = eventNotifier_->wait(getLoopTimeoutMs());
+  LOG_DEBUG("Service events", events);
+
   bool screenNeedsUpdate = false;
 
   screenNeedsUpdate |= audioTask_->loop();
   screenNeedsUpdate |= radioTask_->loop();
-  screenNeedsUpdate |= pmService_->loop();
+  if (auxRadioTask_) screenNeedsUpdate |= auxRadioTask_->loop();
+  // display was cleared before sleep
+  if (pmService_->loop()) {
+    statusScreen_->invalidate();
+    screenNeedsUpdate = true;
+  }
   screenNeedsUpdate |= processPttButton();
   screenNeedsUpdate |= processRotaryEncoder();
+  screenNeedsUpdate |= processPendingClick();
 
-  if (screenNeedsUpdate) {
-    updateScreen();
+  if (isStatsVisible_ && !settingsMenu_->isOpen()) {
+    // redrawn by its own timer
+    statsScreen_->loop(getRxRadioTask()->getStats(), audioTask_->getStats());
+  } else if (screenNeedsUpdate) {
+    // menu owns the display while it is open
+    if (settingsMenu_->isOpen())
+      settingsMenu_->draw(display_);
+    else
+      updateScreen();
   }
 }
 
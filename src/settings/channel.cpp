@@ -0,0 +1,30 @@
+#include "settings/channel.h"
+
+namespace LoraDv {
+
+const long Channel::Bandwidths[Channel::CfgBandwidthsCount] = { 
+  7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 
+};
+
+bool Channel::isTxOffsetValid(long freqRx, long freqTx)
+{
+  long offsetHz = freqTx - freqRx;
+  return offsetHz % 1000 == 0 && offsetHz / 1000 >= INT16_MIN && offsetHz / 1000 <= INT16_MAX;
+}
+
+Channel Channel::make(long freqRx, long freqTx, bool isLora, long bw, int sf, int fskFec, int codec, 
+  bool isPrivacy, int privKeyId)
+{
+  int bwIndex = 0;
+  for (int i = 0; i < CfgBandwidthsCount; i++) {
+    if (Bandwidths[i] == bw) bwIndex = i;
+  }
+  Channel channel;
+  channel.freqRx = freqRx;
+  channel.txOffsetKhz = (freqTx - freqRx) / 1000;
+  channel.modulation = isLora ? (bwIndex << 4) | (sf & 0x0f) : (fskFec & 0x0f) << 4;
+  channel.audio = (codec & 0x0f) | ((privKeyId & 0x07) << 4) | (isPrivacy ? 0x80 : 0);
+  return channel;
+}
+
+} // LoraDv
@@ -36,11 +36,23 @@ void Config::InitializeDefault()
   LoraCrc_ = CFG_LORA_CRC; // set to 0 to disable
   LoraPreambleLen_ = CFG_LORA_PREAMBLE_LEN;
 
+  // memory channels
+  ChannelId = CFG_CHANNEL_ID;
+  ScanEnabled = CFG_SCAN_ENABLED;
+  ScanHoldMs_ = CFG_SCAN_HOLD_MS;
+  memset(Channels_, 0, sizeof(Channels_));
+
+  // radio rx batching
+  RadioRxBatchPackets_ = CFG_RADIO_RX_BATCH_PACKETS;
+  RadioRxBatchDeadlineMs_ = CFG_RADIO_RX_BATCH_DEADLINE_MS;
+
   // fsk parameters
   FskBitRate = CFG_FSK_BIT_RATE;
   FskFreqDev = CFG_FSK_FREQ_DEV;
   FskRxBw = CFG_FSK_RX_BW;
   FskShaping = CFG_FSK_SHAPING;
+  FskFec = CFG_FSK_FEC;
+  UepEnabled = CFG_UEP_ENABLED;
 
   // lora pinouts
   LoraPinSs_ = CFG_LORA_PIN_NSS;
@@ -52,9 +64,38 @@ void Config::InitializeDefault()
   LoraFreqMin_ = CFG_LORA_FREQ_MIN;
   LoraFreqMax_ = CFG_LORA_FREQ_MAX;
 
+  // second lora module
+  Lora2Mode_ = CFG_LORA2_MODE;
+  Lora2PinSs_ = CFG_LORA2_PIN_NSS;
+  Lora2PinRst_ = CFG_LORA2_PIN_RST;
+  Lora2PinA_ = CFG_LORA2_PIN_DIO1;
+  Lora2PinB_ = CFG_LORA2_PIN_BUSY;
+  Lora2PinSwitchRx_ = CFG_LORA2_PIN_RXEN;
+  Lora2PinSwitchTx_ = CFG_LORA2_PIN_TXEN;
+
   // ptt button
   PttBtnPin_ = CFG_PTT_BTN_PIN;
 
+  // display
+  DisplayI2cClock_ = CFG_DISPLAY_I2C_CLOCK;
+
+  // serial control protocol
+  SerialProtocolEnabled_ = CFG_SERIAL_PROTOCOL_ENABLED;
+  SerialTelemetryMs_ = CFG_SERIAL_TELEMETRY_MS;
+
+  // task monitor
+  TaskMonitorEnabled_ = CFG_TASK_MONITOR_ENABLED;
+  TaskMonitorIntervalMs_ = CFG_TASK_MONITOR_INTERVAL_MS;
+
+  // callsign
+  CallsignEnabled = CFG_CALLSIGN_ENABLED;
+  memset(Callsign, 0, sizeof(Callsign));
+  strncpy(Callsign, CFG_CALLSIGN, sizeof(Callsign) - 1);
+  CallsignIntervalMs_ = CFG_CALLSIGN_INTERVAL_MS;
+
+  // m17
+  M17Enabled = CFG_M17_ENABLED;
+
   // encoder
   EncoderPinA_ = CFG_ENCODER_PIN_A;
   EncoderPinB_ = CFG_ENCODER_PIN_B;
@@ -73,10 +114,12 @@ void Config::InitializeDefault()
   AudioMaxVol_ = CFG_AUDIO_MAX_VOL;
   AudioVol = CFG_AUDIO_VOL;
   AudioEnPriv = CFG_AUDIO_ENABLE_PRIVACY;
+  AudioPrivKeyId = CFG_AUDIO_PRIVACY_KEY_ID;
 
   // audio, opus
   AudioOpusRate = CFG_AUDIO_OPUS_BITRATE;
   AudioOpusPcmLen = CFG_AUDIO_OPUS_PCMLEN;
+  AudioOpusComplexity_ = CFG_AUDIO_OPUS_COMPLEXITY;
 
   // i2s speaker
   AudioSpkPinBclk_ = CFG_AUDIO_SPK_PIN_BCLK;
@@ -87,6 +130,15 @@ void Config::InitializeDefault()
   AudioMicPinSd_ = CFG_AUDIO_MIC_PIN_SD;
   AudioMicPinWs_ = CFG_AUDIO_MIC_PIN_WS;
   AudioMicPinSck_ = CFG_AUDIO_MIC_PIN_SCK;
+  AudioI2sFullDuplex_ = CFG_AUDIO_I2S_FULL_DUPLEX;
+
+  // repeater
+  RepeaterEnabled = CFG_REPEATER_ENABLED;
+  RepeaterHangMs = CFG_REPEATER_HANG_TIME_MS;
+  RepeaterVerify_ = CFG_REPEATER_VERIFY;
+
+  // voice recorder
+  RecorderMode = CFG_RECORDER_MODE;
 
   // battery monitor
   BatteryMonPin_ = CFG_AUDIO_BATTERY_MON_PIN;
@@ -96,9 +148,210 @@ void Config::InitializeDefault()
   PmSleepAfterMs = CFG_PM_LSLEEP_AFTER_MS;
   PmLightSleepDurationMs_ = CFG_PM_LSLEEP_DURATION_MS;
   PmLightSleepAwakeMs_ = CFG_PM_LSLEEP_AWAKE_MS;
+  PmDimAfterMs_ = CFG_PM_DIM_AFTER_MS;
+  PmDeepSleepAfterMs_ = CFG_PM_DEEP_SLEEP_AFTER_MS;
+  PmDvfsEnabled_ = CFG_PM_DVFS_ENABLED;
+  PmIdleCpuMhz_ = CFG_PM_IDLE_CPU_MHZ;
+  PmBatteryMah_ = CFG_PM_BATTERY_MAH;
+  PmActiveMa_ = CFG_PM_ACTIVE_MA;
+  PmIdleMa_ = CFG_PM_IDLE_MA;
+  PmSleepMa_ = CFG_PM_SLEEP_MA;
+  PmSleepDutyMa_ = CFG_PM_SLEEP_DUTY_MA;
+
+  // encryption keys, only first slot has default key
+  memset(AudioPrivacyKeys_, 0, sizeof(AudioPrivacyKeys_));
+  memcpy(AudioPrivacyKeys_[0], AudioPrivacyKey, sizeof(AudioPrivacyKey));
+}
+
+bool Config::IsPrivacyKeySet(int keyId) const
+{
+  if (keyId < 0 || keyId >= CFG_AUDIO_PRIVACY_KEY_SLOTS) return false;
+  bool isSet = false;
+  portENTER_CRITICAL(&privacyKeysLock_);
+  for (size_t i = 0; i < sizeof(AudioPrivacyKeys_[keyId]); i++) {
+    if (AudioPrivacyKeys_[keyId][i] != 0) {
+      isSet = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&privacyKeysLock_);
+  return isSet;
+}
+
+void Config::GetPrivacyKey(int keyId, byte *key) const
+{
+  portENTER_CRITICAL(&privacyKeysLock_);
+  memcpy(key, AudioPrivacyKeys_[keyId], sizeof(AudioPrivacyKeys_[keyId]));
+  portEXIT_CRITICAL(&privacyKeysLock_);
+}
+
+bool Config::SetPrivacyKey(int keyId, const byte *key)
+{
+  // slot 0 always holds compile time key
+  if (keyId < 1 || keyId >= CFG_AUDIO_PRIVACY_KEY_SLOTS) return false;
+  portENTER_CRITICAL(&privacyKeysLock_);
+  memcpy(AudioPrivacyKeys_[keyId], key, sizeof(AudioPrivacyKeys_[keyId]));
+  portEXIT_CRITICAL(&privacyKeysLock_);
+  char keyName[16];
+  snprintf(keyName, sizeof(keyName), "AudioPrivKey%d", keyId);
+  // cleared transmission slot falls back to slot 0, as in RadioTask::setPrivacyKey
+  if (!IsPrivacyKeySet(keyId) && AudioPrivKeyId == keyId) {
+    SetPrivacyKeyId(0);
+  }
+  serialPrefs_.begin("LoraDv");
+  bool isSaved = serialPrefs_.putBytes(keyName, key, sizeof(AudioPrivacyKeys_[keyId])) > 0;
+  serialPrefs_.end();
+  return isSaved;
+}
+
+bool Config::SetPrivacyKeyId(int keyId)
+{
+  if (!IsPrivacyKeySet(keyId)) return false;
+  portENTER_CRITICAL(&privacyKeysLock_);
+  AudioPrivKeyId = keyId;
+  portEXIT_CRITICAL(&privacyKeysLock_);
+  serialPrefs_.begin("LoraDv");
+  bool isSaved = serialPrefs_.putInt(N(AudioPrivKeyId), keyId) > 0;
+  serialPrefs_.end();
+  return isSaved;
+}
+
+void Config::LoadPrivacyKeys()
+{
+  // slot 0 always holds compile time key
+  for (int keyId = 1; keyId < CFG_AUDIO_PRIVACY_KEY_SLOTS; keyId++) {
+    char keyName[16];
+    snprintf(keyName, sizeof(keyName), "AudioPrivKey%d", keyId);
+    if (prefs_.isKey(keyName)) {
+      prefs_.getBytes(keyName, AudioPrivacyKeys_[keyId], sizeof(AudioPrivacyKeys_[keyId]));
+    } else {
+      prefs_.putBytes(keyName, AudioPrivacyKeys_[keyId], sizeof(AudioPrivacyKeys_[keyId]));
+    }
+  }
+}
+
+void Config::SavePrivacyKeys()
+{
+  // empty slots are stored as zeros, so every slot could be also set over serial by name
+  for (int keyId = 1; keyId < CFG_AUDIO_PRIVACY_KEY_SLOTS; keyId++) {
+    char keyName[16];
+    byte key[sizeof(AudioPrivacyKeys_[keyId])];
+    snprintf(keyName, sizeof(keyName), "AudioPrivKey%d", keyId);
+    GetPrivacyKey(keyId, key);
+    prefs_.putBytes(keyName, key, sizeof(key));
+  }
+}
+
+bool Config::ApplyChannel(int channelId)
+{
+  if (channelId < 0 || channelId >= CFG_CHANNELS_COUNT || Channels_[channelId].isEmpty()) return false;
+  const Channel &channel = Channels_[channelId];
+  LoraFreqRx = channel.getFreqRx();
+  LoraFreqTx = channel.getFreqTx();
+  ModType = channel.isLora() ? CFG_MOD_TYPE_LORA : CFG_MOD_TYPE_FSK;
+  if (channel.isLora()) {
+    LoraBw = channel.getLoraBw();
+    LoraSf = channel.getLoraSf();
+  } else {
+    FskFec = channel.getFskFec();
+  }
+  AudioCodec = channel.getCodec();
+  AudioEnPriv = channel.isPrivacy();
+  if (IsPrivacyKeySet(channel.getPrivKeyId())) AudioPrivKeyId = channel.getPrivKeyId();
+  ChannelId = channelId;
+  return true;
+}
+
+bool Config::StoreChannel(int channelId)
+{
+  if (channelId < 0 || channelId >= CFG_CHANNELS_COUNT) return false;
+  if (!Channel::isTxOffsetValid(LoraFreqRx, LoraFreqTx)) {
+    LOG_ERROR("TX offset does not fit into memory channel, not stored", LoraFreqTx - LoraFreqRx);
+    return false;
+  }
+  Channels_[channelId] = Channel::make(LoraFreqRx, LoraFreqTx, ModType == CFG_MOD_TYPE_LORA, 
+    LoraBw, LoraSf, FskFec, AudioCodec, AudioEnPriv, AudioPrivKeyId);
+  ChannelId = channelId;
+  return true;
+}
 
-  // encryption key
-  memcpy(AudioPrivacyKey_, AudioPrivacyKey, sizeof(AudioPrivacyKey));
+void Config::LoadChannels()
+{
+  if (prefs_.isKey("Channels") && prefs_.getBytesLength("Channels") == sizeof(Channels_)) {
+    prefs_.getBytes("Channels", Channels_, sizeof(Channels_));
+  }
+}
+
+void Config::SaveChannels()
+{
+  prefs_.putBytes("Channels", Channels_, sizeof(Channels_));
+}
+
+int Config::GetField(const char *name, byte *value, int maxValueSize)
+{
+  // persisted fields are looked up by their settings key, serial task has its own handle
+  serialPrefs_.begin("LoraDv", true);
+  int valueSize = 0;
+  switch (serialPrefs_.getType(name)) {
+    case PT_I32: {
+      int32_t intValue = serialPrefs_.getInt(name);
+      if (maxValueSize >= sizeof(intValue)) {
+        memcpy(value, &intValue, sizeof(intValue));
+        valueSize = sizeof(intValue);
+      }
+      break;
+    }
+    case PT_U8:
+      if (maxValueSize >= 1) {
+        value[0] = serialPrefs_.getUChar(name);
+        valueSize = 1;
+      }
+      break;
+    case PT_BLOB:
+      if (serialPrefs_.getBytesLength(name) <= maxValueSize) {
+        valueSize = serialPrefs_.getBytes(name, value, maxValueSize);
+      }
+      break;
+    default:
+      break;
+  }
+  serialPrefs_.end();
+  return valueSize;
+}
+
+bool Config::SetField(const char *name, const byte *value, int valueSize)
+{
+  // value is written in the stored representation, size must match the stored one
+  serialPrefs_.begin("LoraDv");
+  bool isSet = false;
+  switch (serialPrefs_.getType(name)) {
+    case PT_I32: {
+      int32_t intValue;
+      if (valueSize == sizeof(intValue)) {
+        memcpy(&intValue, value, sizeof(intValue));
+        isSet = serialPrefs_.putInt(name, intValue) > 0;
+      }
+      break;
+    }
+    case PT_U8:
+      if (valueSize == 1) {
+        isSet = serialPrefs_.putUChar(name, value[0]) > 0;
+      }
+      break;
+    case PT_BLOB:
+      if (valueSize == serialPrefs_.getBytesLength(name)) {
+        isSet = serialPrefs_.putBytes(name, value, valueSize) > 0;
+      }
+      break;
+    default:
+      break;
+  }
+  serialPrefs_.end();
+  // fields are read by other tasks without locking, so value is only applied after reboot
+  if (isSet) {
+    LOG_INFO("Setting is stored, applied after reboot", name);
+  }
+  return isSet;
 }
 
 void Config::Reset()
@@ -188,10 +441,68 @@ void Config::Load()
   } else {
     prefs_.putBool(N(AudioEnPriv), AudioEnPriv);
   }
+  if (prefs_.isKey(N(AudioPrivKeyId))) {
+    AudioPrivKeyId = prefs_.getInt(N(AudioPrivKeyId));
+  } else {
+    prefs_.putInt(N(AudioPrivKeyId), AudioPrivKeyId);
+  }
+  LoadPrivacyKeys();
+  if (prefs_.isKey(N(RepeaterEnabled))) {
+    RepeaterEnabled = prefs_.getBool(N(RepeaterEnabled));
+  } else {
+    prefs_.putBool(N(RepeaterEnabled), RepeaterEnabled);
+  }
+  if (prefs_.isKey(N(RepeaterHangMs))) {
+    RepeaterHangMs = prefs_.getInt(N(RepeaterHangMs));
+  } else {
+    prefs_.putInt(N(RepeaterHangMs), RepeaterHangMs);
+  }
+  LoadChannels();
+  if (prefs_.isKey(N(ChannelId))) {
+    ChannelId = prefs_.getInt(N(ChannelId));
+  } else {
+    prefs_.putInt(N(ChannelId), ChannelId);
+  }
+  if (prefs_.isKey(N(ScanEnabled))) {
+    ScanEnabled = prefs_.getBool(N(ScanEnabled));
+  } else {
+    prefs_.putBool(N(ScanEnabled), ScanEnabled);
+  }
+  if (prefs_.isKey(N(RecorderMode))) {
+    RecorderMode = prefs_.getInt(N(RecorderMode));
+  } else {
+    prefs_.putInt(N(RecorderMode), RecorderMode);
+  }
+  if (prefs_.isKey(N(CallsignEnabled))) {
+    CallsignEnabled = prefs_.getBool(N(CallsignEnabled));
+  } else {
+    prefs_.putBool(N(CallsignEnabled), CallsignEnabled);
+  }
+  if (prefs_.isKey(N(Callsign)) && prefs_.getBytesLength(N(Callsign)) == sizeof(Callsign)) {
+    prefs_.getBytes(N(Callsign), Callsign, sizeof(Callsign));
+    Callsign[sizeof(Callsign) - 1] = '\0';
+  } else {
+    prefs_.putBytes(N(Callsign), Callsign, sizeof(Callsign));
+  }
+  if (prefs_.isKey(N(M17Enabled))) {
+    M17Enabled = prefs_.getBool(N(M17Enabled));
+  } else {
+    prefs_.putBool(N(M17Enabled), M17Enabled);
+  }
   if (prefs_.isKey(N(BatteryMonCal))) {
     BatteryMonCal = prefs_.getFloat(N(BatteryMonCal));
+    // older firmware stored 0.25 V default offset for raw adc readings, readings are efuse calibrated now
+    if (!prefs_.isKey("BatCalEfuse")) {
+      if (BatteryMonCal == 0.25f) {
+        LOG_INFO("Battery calibration offset is reset for efuse calibrated adc");
+        BatteryMonCal = CFG_AUDIO_BATTERY_MON_CAL;
+        prefs_.putFloat(N(BatteryMonCal), BatteryMonCal);
+      }
+      prefs_.putBool("BatCalEfuse", true);
+    }
   } else {
     prefs_.putFloat(N(BatteryMonCal), BatteryMonCal);
+    prefs_.putBool("BatCalEfuse", true);
   }
   if (prefs_.isKey(N(PmSleepAfterMs))) {
     PmSleepAfterMs = prefs_.getInt(N(PmSleepAfterMs));
@@ -218,6 +529,16 @@ void Config::Load()
   } else {
     prefs_.putInt(N(FskShaping), FskShaping);
   }
+  if (prefs_.isKey(N(FskFec))) {
+    FskFec = prefs_.getInt(N(FskFec));
+  } else {
+    prefs_.putInt(N(FskFec), FskFec);
+  }
+  if (prefs_.isKey(N(UepEnabled))) {
+    UepEnabled = prefs_.getBool(N(UepEnabled));
+  } else {
+    prefs_.putBool(N(UepEnabled), UepEnabled);
+  }
   if (prefs_.isKey(N(ModType))) {
     ModType = prefs_.getInt(N(ModType));
   } else {
@@ -259,12 +580,26 @@ void Config::Save()
   prefs_.putInt(N(AudioVol), AudioVol);
   prefs_.putInt(N(AudioMaxPktSize), AudioMaxPktSize);
   prefs_.putBool(N(AudioEnPriv), AudioEnPriv);
+  prefs_.putInt(N(AudioPrivKeyId), AudioPrivKeyId);
+  SavePrivacyKeys();
+  prefs_.putBool(N(RepeaterEnabled), RepeaterEnabled);
+  prefs_.putInt(N(RepeaterHangMs), RepeaterHangMs);
+  SaveChannels();
+  prefs_.putInt(N(ChannelId), ChannelId);
+  prefs_.putBool(N(ScanEnabled), ScanEnabled);
+  prefs_.putInt(N(RecorderMode), RecorderMode);
+  prefs_.putBool(N(CallsignEnabled), CallsignEnabled);
+  prefs_.putBytes(N(Callsign), Callsign, sizeof(Callsign));
+  prefs_.putBool(N(M17Enabled), M17Enabled);
   prefs_.putFloat(N(BatteryMonCal), BatteryMonCal);
+  prefs_.putBool("BatCalEfuse", true);
   prefs_.putInt(N(PmSleepAfterMs), PmSleepAfterMs);
   prefs_.putFloat(N(FskBitRate), FskBitRate);
   prefs_.putFloat(N(FskFreqDev), FskFreqDev);
   prefs_.putFloat(N(FskRxBw), FskRxBw);
   prefs_.putInt(N(FskShaping), FskShaping);
+  prefs_.putInt(N(FskFec), FskFec);
+  prefs_.putBool(N(UepEnabled), UepEnabled);
   prefs_.putInt(N(ModType), ModType);
   prefs_.putInt(N(AudioOpusRate), AudioOpusRate);
   prefs_.putInt(N(AudioOpusPcmLen), AudioOpusPcmLen);
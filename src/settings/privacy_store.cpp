@@ -0,0 +1,90 @@
+#include "settings/privacy_store.h"
+
+namespace LoraDv {
+
+PrivacyStore::PrivacyStore()
+  : deviceId_(0)
+  , epoch_(0)
+  , isStarted_(false)
+  , writeCount_(0)
+{
+  memset(records_, 0, sizeof(records_));
+}
+
+void PrivacyStore::start()
+{
+  // kept open, nvs calls are serialized by the driver, so radio tasks could use it directly
+  if (!prefs_.begin(CfgNamespace)) {
+    LOG_ERROR("Failed to open privacy store");
+    return;
+  }
+  deviceId_ = prefs_.getUInt("DeviceId", 0);
+  if (deviceId_ == 0) {
+    while (deviceId_ == 0) deviceId_ = esp_random();
+    prefs_.putUInt("DeviceId", deviceId_);
+  }
+  // epoch must be stored before the first packet of the session is sent
+  epoch_ = prefs_.getUInt("Epoch", 0) + 1;
+  if (prefs_.putUInt("Epoch", epoch_) == 0) {
+    LOG_ERROR("Failed to store boot epoch");
+  }
+  // sender records are read once, lookups are served from memory
+  char key[8];
+  for (int i = 0; i < CfgSenderRecords; i++) {
+    recordKey(i, key, sizeof(key));
+    if (prefs_.getBytesLength(key) != sizeof(SenderRecord)) continue;
+    prefs_.getBytes(key, &records_[i], sizeof(SenderRecord));
+    writeCount_ = max(writeCount_, records_[i].writeCount);
+  }
+  isStarted_ = true;
+  LOG_INFO("Privacy device id", deviceId_, "epoch", epoch_);
+}
+
+void PrivacyStore::recordKey(int index, char *key, size_t keySize)
+{
+  snprintf(key, keySize, "s%02d", index);
+}
+
+bool PrivacyStore::loadSender(uint32_t senderId, uint32_t &epoch, uint32_t &seq)
+{
+  if (!isStarted_ || senderId == 0) return false;
+  bool isFound = false;
+  portENTER_CRITICAL(&recordsLock_);
+  for (int i = 0; i < CfgSenderRecords; i++) {
+    if (records_[i].senderId == senderId) {
+      epoch = records_[i].epoch;
+      seq = records_[i].seq;
+      isFound = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&recordsLock_);
+  return isFound;
+}
+
+void PrivacyStore::saveSender(uint32_t senderId, uint32_t epoch, uint32_t seq)
+{
+  if (!isStarted_ || senderId == 0) return;
+  // same sender record or the least recently written one, empty records have zero counter
+  int index = 0;
+  portENTER_CRITICAL(&recordsLock_);
+  for (int i = 0; i < CfgSenderRecords; i++) {
+    if (records_[i].senderId == senderId) {
+      index = i;
+      break;
+    }
+    if (records_[i].writeCount < records_[index].writeCount) index = i;
+  }
+  records_[index] = { senderId, epoch, seq, ++writeCount_ };
+  SenderRecord record = records_[index];
+  portEXIT_CRITICAL(&recordsLock_);
+
+  // flash is written outside of the lock, both radio tasks could store positions
+  char key[8];
+  recordKey(index, key, sizeof(key));
+  if (prefs_.putBytes(key, &record, sizeof(record)) == 0) {
+    LOG_ERROR("Failed to store sender position", senderId);
+  }
+}
+
+} // LoraDv
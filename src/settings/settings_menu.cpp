@@ -2,12 +2,17 @@
 
 namespace LoraDv {
 
-SettingsMenu::SettingsMenu(std::shared_ptr<Config> config)
+SettingsMenu::SettingsMenu(std::shared_ptr<Config> config, std::shared_ptr<TaskMonitor> taskMonitor)
   : config_(config)
   , selectedMenuItemIndex_(0)
+  , isOpen_(false)
   , isValueSelected_(false)
 {
   int i = 0;
+  // channels
+  items_.push_back(std::make_shared<SettingsChannelItem>(config, ++i));
+  items_.push_back(std::make_shared<SettingsChannelStoreItem>(config, ++i));
+  items_.push_back(std::make_shared<SettingsScanItem>(config, ++i));
   // frequency
   items_.push_back(std::make_shared<SettingsLoraFreqStepItem>(config, ++i));
   items_.push_back(std::make_shared<SettingsLoraFreqRxItem>(config, ++i));
@@ -25,6 +30,15 @@ SettingsMenu::SettingsMenu(std::shared_ptr<Config> config)
   // audio
   items_.push_back(std::make_shared<SettingsAudioVolItem>(config, ++i));
   items_.push_back(std::make_shared<SettingsAudioEnablePrivacy>(config, ++i));
+  items_.push_back(std::make_shared<SettingsAudioPrivacyKeyIdItem>(config, ++i));
+  // repeater
+  items_.push_back(std::make_shared<SettingsRepeaterEnabledItem>(config, ++i));
+  items_.push_back(std::make_shared<SettingsRepeaterHangTimeItem>(config, ++i));
+  // recorder
+  items_.push_back(std::make_shared<SettingsRecorderModeItem>(config, ++i));
+  // callsign
+  items_.push_back(std::make_shared<SettingsCallsignItem>(config, ++i));
+  items_.push_back(std::make_shared<SettingsM17Item>(config, ++i));
   // lora
   items_.push_back(std::make_shared<SettingsLoraBwItem>(config, ++i));
   items_.push_back(std::make_shared<SettingsLoraSfItem>(config, ++i));
@@ -34,6 +48,8 @@ SettingsMenu::SettingsMenu(std::shared_ptr<Config> config)
   items_.push_back(std::make_shared<SettingsFskFreqDev>(config, ++i));
   items_.push_back(std::make_shared<SettingsFskRxBw>(config, ++i));
   items_.push_back(std::make_shared<SettingsFskShaping>(config, ++i));
+  items_.push_back(std::make_shared<SettingsFskFec>(config, ++i));
+  items_.push_back(std::make_shared<SettingsUepItem>(config, ++i));
   // other
   items_.push_back(std::make_shared<SettingsBatteryMonCalItem>(config, ++i));
   items_.push_back(std::make_shared<SettingsPmLightSleepAfterMsItem>(config, ++i));
@@ -41,21 +57,30 @@ SettingsMenu::SettingsMenu(std::shared_ptr<Config> config)
   items_.push_back(std::make_shared<SettingsResetItem>(config, ++i));
   items_.push_back(std::make_shared<SettingsRebootItem>(config, ++i));
   items_.push_back(std::make_shared<SettingsInfoItem>(config, ++i));
+  items_.push_back(std::make_shared<SettingsTasksItem>(config, ++i, taskMonitor));
+}
+
+void SettingsMenu::open()
+{
+  isOpen_ = true;
+  isValueSelected_ = false;
+  selectedMenuItemIndex_ = 0;
 }
 
 void SettingsMenu::draw(std::shared_ptr<Adafruit_SSD1306> display) 
 {
-  stringstream s;
-  items_[selectedMenuItemIndex_]->getName(s);
-  s << endl;
-  if (isValueSelected_) s << ">";
-  items_[selectedMenuItemIndex_]->getValue(s);
+  text_.str("");
+  text_.clear();
+  items_[selectedMenuItemIndex_]->getName(text_);
+  text_ << endl;
+  if (isValueSelected_) text_ << ">";
+  items_[selectedMenuItemIndex_]->getValue(text_);
 
   display->clearDisplay();
   display->setTextSize(1);
   display->setTextColor(WHITE);
   display->setCursor(0, 0);
-  display->print(s.str().c_str());
+  display->print(text_.str().c_str());
   display->display();
 }
 
@@ -0,0 +1,67 @@
+#include "utils/ax25.h"
+
+namespace LoraDv {
+
+bool Ax25::encodeHeader(const char *dest, const char *src, byte *header)
+{
+  if (!encodeAddress(dest, header, false)) return false;
+  if (!encodeAddress(src, header + CfgAddressSize, true)) return false;
+  header[2 * CfgAddressSize] = CfgControlUi;
+  header[2 * CfgAddressSize + 1] = CfgPidNoLayer3;
+  return true;
+}
+
+bool Ax25::decodeHeader(const byte *header, int headerSize, char *src, int srcLen)
+{
+  if (headerSize < CfgHeaderSize) return false;
+  // only single hop ui frames, source address must be the last one
+  if (!(header[2 * CfgAddressSize - 1] & CfgAddressLast)) return false;
+  if (header[2 * CfgAddressSize] != CfgControlUi || header[2 * CfgAddressSize + 1] != CfgPidNoLayer3) return false;
+  return decodeAddress(header + CfgAddressSize, src, srcLen);
+}
+
+bool Ax25::encodeAddress(const char *text, byte *address, bool isLast)
+{
+  // callsign is space padded, characters are shifted left by one bit
+  int i = 0;
+  for (; i < CfgMaxCallsignLen && text[i] != '\0' && text[i] != '-'; i++) {
+    char c = toupper(text[i]);
+    if (!isalnum(c)) return false;
+    address[i] = c << 1;
+  }
+  if (i == 0 || (text[i] != '\0' && text[i] != '-')) return false;
+  const char *ssidText = text[i] == '-' ? text + i + 1 : nullptr;
+  for (; i < CfgMaxCallsignLen; i++) {
+    address[i] = ' ' << 1;
+  }
+  int ssid = 0;
+  if (ssidText != nullptr) {
+    char *end;
+    ssid = strtol(ssidText, &end, 10);
+    if (end == ssidText || *end != '\0' || ssid < 0 || ssid > 15) return false;
+  }
+  address[CfgMaxCallsignLen] = CfgSsidReserved | (ssid << 1) | (isLast ? CfgAddressLast : 0);
+  return true;
+}
+
+bool Ax25::decodeAddress(const byte *address, char *text, int textLen)
+{
+  if (textLen < CfgMaxTextLen) return false;
+  int len = 0;
+  for (int i = 0; i < CfgMaxCallsignLen; i++) {
+    char c = address[i] >> 1;
+    if (c == ' ') break;
+    if (!isalnum(c)) return false;
+    text[len++] = c;
+  }
+  if (len == 0) return false;
+  int ssid = (address[CfgMaxCallsignLen] >> 1) & 0x0f;
+  if (ssid > 0) {
+    snprintf(text + len, textLen - len, "-%d", ssid);
+  } else {
+    text[len] = '\0';
+  }
+  return true;
+}
+
+} // LoraDv
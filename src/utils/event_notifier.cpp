@@ -0,0 +1,38 @@
+#include "utils/event_notifier.h"
+
+namespace LoraDv {
+
+EventNotifier::EventNotifier()
+  : taskHandle_(0)
+{
+}
+
+void EventNotifier::attach()
+{
+  // events are delivered to the calling task
+  taskHandle_ = xTaskGetCurrentTaskHandle();
+}
+
+void EventNotifier::notify(uint32_t events) const
+{
+  if (taskHandle_ == 0) return;
+  xTaskNotify(taskHandle_, events, eSetBits);
+}
+
+IRAM_ATTR void EventNotifier::notifyFromIsr(uint32_t events) const
+{
+  if (taskHandle_ == 0) return;
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  xTaskNotifyFromISR(taskHandle_, events, eSetBits, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+uint32_t EventNotifier::wait(uint32_t timeoutMs) const
+{
+  uint32_t events = 0;
+  TickType_t waitTicks = timeoutMs == CfgWaitForever ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+  xTaskNotifyWaitIndexed(0, 0x00, ULONG_MAX, &events, waitTicks);
+  return events;
+}
+
+} // LoraDv
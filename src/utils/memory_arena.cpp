@@ -0,0 +1,31 @@
+#include "utils/memory_arena.h"
+#include "settings/config.h"
+
+namespace LoraDv {
+
+MemoryArena::MemoryArena(const char *name, uint8_t *buffer, size_t size)
+  : name_(name)
+  , buffer_(buffer)
+  , size_(size)
+  , used_(0)
+{
+}
+
+void *MemoryArena::allocate(size_t size, size_t align)
+{
+  uintptr_t start = (uintptr_t)buffer_ + used_;
+  size_t padding = (align - start % align) % align;
+  if (used_ + padding + size > size_) {
+    LOG_ERROR("Memory arena is exhausted", name_, size, used_, size_);
+    return nullptr;
+  }
+  used_ += padding + size;
+  return (void*)(start + padding);
+}
+
+void MemoryArena::logUsage() const
+{
+  LOG_INFO("Memory arena", name_, "used", used_, "of", size_, "bytes");
+}
+
+} // LoraDv
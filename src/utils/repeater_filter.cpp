@@ -0,0 +1,60 @@
+#include "utils/repeater_filter.h"
+
+namespace LoraDv {
+
+RepeaterFilter::RepeaterFilter()
+{
+  reset();
+}
+
+void RepeaterFilter::reset()
+{
+  replayFilter_.reset();
+  memset(hashes_, 0, sizeof(hashes_));
+  hashIndex_ = 0;
+  isLocked_ = false;
+  lockedSenderId_ = 0;
+  lastPacketMs_ = 0;
+}
+
+RepeaterFilter::Result RepeaterFilter::check(uint32_t senderId, uint32_t epoch, uint32_t seq, uint32_t hangTimeMs)
+{
+  uint32_t nowMs = millis();
+
+  // another stream is being repeated
+  if (isLocked_ && senderId != lockedSenderId_ && nowMs - lastPacketMs_ < hangTimeMs) 
+    return Result::Busy;
+
+  // already repeated or too old
+  if (!replayFilter_.check(senderId, epoch, seq) || !replayFilter_.update(senderId, epoch, seq)) 
+    return Result::Duplicate;
+
+  isLocked_ = true;
+  lockedSenderId_ = senderId;
+  lastPacketMs_ = nowMs;
+  return Result::Accept;
+}
+
+RepeaterFilter::Result RepeaterFilter::check(const byte *packetBuf, int packetSize)
+{
+  uint32_t packetHash = hash(packetBuf, packetSize);
+  for (int i = 0; i < CfgHashRingSize; i++) {
+    if (hashes_[i] == packetHash) return Result::Duplicate;
+  }
+  hashes_[hashIndex_] = packetHash;
+  hashIndex_ = (hashIndex_ + 1) % CfgHashRingSize;
+  return Result::Accept;
+}
+
+uint32_t RepeaterFilter::hash(const byte *buf, int size)
+{
+  // FNV-1a, zero is reserved for empty ring entries
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < size; i++) {
+    h ^= buf[i];
+    h *= 16777619u;
+  }
+  return h == 0 ? 1 : h;
+}
+
+} // LoraDv
@@ -0,0 +1,100 @@
+#include "utils/replay_filter.h"
+
+namespace LoraDv {
+
+ReplayFilter::ReplayFilter(std::shared_ptr<ReplayStore> store)
+  : store_(store)
+  , useCounter_(0)
+{
+  reset();
+}
+
+void ReplayFilter::reset()
+{
+  for (int i = 0; i < CfgSenderSlots; i++) {
+    entries_[i] = { 0, 0, 0, 0, 0, 0, false, false };
+  }
+  useCounter_ = 0;
+}
+
+int ReplayFilter::find(uint32_t senderId) const
+{
+  for (int i = 0; i < CfgSenderSlots; i++) {
+    if (entries_[i].isUsed && entries_[i].senderId == senderId) return i;
+  }
+  return -1;
+}
+
+int ReplayFilter::evict()
+{
+  int index = 0;
+  for (int i = 0; i < CfgSenderSlots; i++) {
+    if (!entries_[i].isUsed) return i;
+    if (entries_[i].lastUsed < entries_[index].lastUsed) index = i;
+  }
+  // evicted sender leaves exact position, so its next packets are not dropped when it comes back
+  const Entry &entry = entries_[index];
+  if (store_ && entry.isStored && entry.storedSeq != entry.maxSeq) {
+    store_->saveSender(entry.senderId, entry.epoch, entry.maxSeq);
+  }
+  return index;
+}
+
+bool ReplayFilter::check(uint32_t senderId, uint32_t epoch, uint32_t seq) const
+{
+  // sender is not tracked, decided by update() after the packet is authenticated
+  int index = find(senderId);
+  if (index < 0) return true;
+  const Entry &entry = entries_[index];
+
+  // sender restarted, packets from previous sessions are never accepted
+  if (epoch != entry.epoch) return epoch > entry.epoch;
+
+  // newer than anything seen so far
+  if (seq > entry.maxSeq) return true;
+
+  // too old to be tracked or already seen
+  uint32_t offset = entry.maxSeq - seq;
+  if (offset >= CfgWindowSize) return false;
+  return (entry.window & ((uint64_t)1 << offset)) == 0;
+}
+
+bool ReplayFilter::update(uint32_t senderId, uint32_t epoch, uint32_t seq)
+{
+  int index = find(senderId);
+  if (index < 0) {
+    // sender was evicted or seen before reboot, everything up to the stored position is treated as seen
+    index = evict();
+    uint32_t storedEpoch, storedSeq;
+    if (store_ && store_->loadSender(senderId, storedEpoch, storedSeq)) {
+      entries_[index] = { senderId, storedEpoch, storedSeq, storedSeq, ~(uint64_t)0, 0, true, true };
+    } else {
+      entries_[index] = { senderId, epoch, seq, 0, 0, 0, true, false };
+    }
+  }
+  Entry &entry = entries_[index];
+  entry.lastUsed = ++useCounter_;
+
+  if (epoch < entry.epoch) return false;
+  if (epoch > entry.epoch) {
+    entry = { senderId, epoch, seq, 0, 1, entry.lastUsed, true, false };
+  } else if (seq > entry.maxSeq) {
+    uint32_t shift = seq - entry.maxSeq;
+    entry.window = shift >= CfgWindowSize ? 1 : (entry.window << shift) | 1;
+    entry.maxSeq = seq;
+  } else {
+    uint32_t offset = entry.maxSeq - seq;
+    if (offset >= CfgWindowSize || (entry.window & ((uint64_t)1 << offset)) != 0) return false;
+    entry.window |= (uint64_t)1 << offset;
+  }
+
+  // reserve position ahead, so store is not written for every packet
+  if (store_ && (!entry.isStored || entry.maxSeq >= entry.storedSeq)) {
+    entry.storedSeq = entry.maxSeq > UINT32_MAX - CfgStoreSeqStep ? UINT32_MAX : entry.maxSeq + CfgStoreSeqStep;
+    entry.isStored = true;
+    store_->saveSender(senderId, entry.epoch, entry.storedSeq);
+  }
+  return true;
+}
+
+} // LoraDv
@@ -0,0 +1,130 @@
+#ifndef MOCK_TRANSCEIVER_H
+#define MOCK_TRANSCEIVER_H
+
+#include <Arduino.h>
+#include <random>
+#include <vector>
+
+namespace LoraDv {
+
+// Radio link model for host tests. Transmitted packets are delivered to the receiver
+// with configurable loss, bit errors, duplication and reordering, all driven by a
+// seeded generator, so every failing run could be reproduced from its seed.
+// Corrupted packets are delivered only when radio CRC is disabled, as the radio does.
+class MockTransceiver {
+
+public:
+  struct Params {
+    float lossRate;       // probability packet is not received
+    float bitErrorRate;   // probability of each bit being flipped
+    float duplicateRate;  // probability packet is received twice
+    float reorderRate;    // probability packet is held and received after the next one
+    bool isCrcEnabled;    // corrupted packets are dropped by the radio
+  };
+
+  struct Stats {
+    int sent;
+    int delivered;
+    int lost;
+    int corrupted;
+    int duplicated;
+    int reordered;
+  };
+
+  typedef std::vector<byte> Packet;
+
+public:
+  MockTransceiver(uint32_t seed, const Params &params)
+    : random_(seed)
+    , params_(params)
+    , stats_()
+    , isHeld_(false)
+  {
+  }
+
+  // packets received on the other side after this transmission, in arrival order
+  std::vector<Packet> transmit(const byte *packetBuf, int packetSize)
+  {
+    std::vector<Packet> received;
+    stats_.sent++;
+    if (chance(params_.lossRate)) {
+      stats_.lost++;
+      return received;
+    }
+    Packet packet(packetBuf, packetBuf + packetSize);
+    if (corrupt(packet)) {
+      stats_.corrupted++;
+      if (params_.isCrcEnabled) {
+        stats_.lost++;
+        return received;
+      }
+    }
+    if (!isHeld_ && chance(params_.reorderRate)) {
+      held_ = packet;
+      isHeld_ = true;
+      stats_.reordered++;
+      return received;
+    }
+    deliver(received, packet);
+    if (chance(params_.duplicateRate)) {
+      stats_.duplicated++;
+      deliver(received, packet);
+    }
+    if (isHeld_) {
+      isHeld_ = false;
+      deliver(received, held_);
+    }
+    return received;
+  }
+
+  inline const Stats &getStats() const { return stats_; }
+
+  // random payload of the given size
+  Packet randomPacket(int packetSize)
+  {
+    Packet packet(packetSize);
+    for (int i = 0; i < packetSize; i++) packet[i] = random_() & 0xff;
+    return packet;
+  }
+
+  inline int randomInt(int minValue, int maxValue)
+  {
+    return std::uniform_int_distribution<int>(minValue, maxValue)(random_);
+  }
+
+private:
+  bool chance(float rate)
+  {
+    return rate > 0 && std::uniform_real_distribution<float>(0, 1)(random_) < rate;
+  }
+
+  bool corrupt(Packet &packet)
+  {
+    bool isCorrupted = false;
+    if (params_.bitErrorRate <= 0) return false;
+    for (size_t i = 0; i < 8 * packet.size(); i++) {
+      if (chance(params_.bitErrorRate)) {
+        packet[i / 8] ^= 1 << (i % 8);
+        isCorrupted = true;
+      }
+    }
+    return isCorrupted;
+  }
+
+  void deliver(std::vector<Packet> &received, const Packet &packet)
+  {
+    received.push_back(packet);
+    stats_.delivered++;
+  }
+
+private:
+  std::mt19937 random_;
+  Params params_;
+  Stats stats_;
+  Packet held_;
+  bool isHeld_;
+};
+
+} // LoraDv
+
+#endif // MOCK_TRANSCEIVER_H
@@ -0,0 +1,4 @@
+Import("env")
+
+# build flags only reach the compiler, sanitizer runtime must be linked too
+env.Append(LINKFLAGS=["-fsanitize=address,undefined", "-lpthread"])
@@ -0,0 +1,52 @@
+#ifndef NATIVE_ARDUINO_SHIM_H
+#define NATIVE_ARDUINO_SHIM_H
+
+// Minimal Arduino and FreeRTOS surface for host tests of platform independent code,
+// critical sections are backed by a real spinlock, so tests could run several threads.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <atomic>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// time is driven by the test, so time dependent logic is deterministic
+inline uint32_t &nativeMillis() { static uint32_t nowMs = 0; return nowMs; }
+inline uint32_t millis() { return nativeMillis(); }
+
+struct portMUX_TYPE {
+  std::atomic<int> isLocked;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED { { 0 } }
+
+inline void nativeEnterCritical(portMUX_TYPE *mux)
+{
+  int isLocked = 0;
+  while (!mux->isLocked.compare_exchange_weak(isLocked, 1, std::memory_order_acquire)) {
+    isLocked = 0;
+  }
+}
+
+inline void nativeExitCritical(portMUX_TYPE *mux)
+{
+  mux->isLocked.store(0, std::memory_order_release);
+}
+
+#define portENTER_CRITICAL(mux) nativeEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) nativeExitCritical(mux)
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // NATIVE_ARDUINO_SHIM_H
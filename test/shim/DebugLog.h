@@ -0,0 +1,11 @@
+#ifndef NATIVE_DEBUGLOG_SHIM_H
+#define NATIVE_DEBUGLOG_SHIM_H
+
+// logs are not checked by host tests
+
+#define LOG_ERROR(...) do {} while (0)
+#define LOG_WARN(...) do {} while (0)
+#define LOG_INFO(...) do {} while (0)
+#define LOG_DEBUG(...) do {} while (0)
+
+#endif // NATIVE_DEBUGLOG_SHIM_H
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+
+#include "hal/data_link.h"
+#include "mock_transceiver.h"
+
+using namespace LoraDv;
+
+static const MockTransceiver::Params CleanLink = { 0, 0, 0, 0, true };
+static const MockTransceiver::Params LossyLink = { 0.05f, 0.001f, 0.05f, 0.05f, true };
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// radio task side, pulls fragments from sender and pushes them over the link into receiver
+static void runLink(DataLink &sender, DataLink &receiver, MockTransceiver &link, int maxFragmentSize)
+{
+  byte fragment[256];
+  int fragmentSize;
+  while ((fragmentSize = sender.peekFragment(fragment, maxFragmentSize)) > 0) {
+    sender.releaseFragment();
+    for (const MockTransceiver::Packet &packet : link.transmit(fragment, fragmentSize)) {
+      receiver.onFragment(packet.data(), packet.size(), -90, 10);
+    }
+  }
+}
+
+static void test_messages_are_fragmented_and_reassembled(void)
+{
+  DataLink sender, receiver;
+  MockTransceiver link(10, CleanLink);
+  int notifications = 0;
+  receiver.onReceive([&notifications]() { notifications++; });
+
+  for (int messageSize = 1; messageSize <= DataLink::CfgMaxMessageSize; messageSize += 37) {
+    MockTransceiver::Packet message = link.randomPacket(messageSize);
+    TEST_ASSERT_TRUE(sender.send(message.data(), message.size()));
+    runLink(sender, receiver, link, 64);
+    byte received[DataLink::CfgMaxMessageSize];
+    float rssi = 0, snr = 0;
+    TEST_ASSERT_EQUAL_INT(messageSize, receiver.receive(received, sizeof(received), &rssi, &snr));
+    TEST_ASSERT_EQUAL_MEMORY(message.data(), received, messageSize);
+    TEST_ASSERT_TRUE(rssi == -90 && snr == 10);
+  }
+  TEST_ASSERT_EQUAL_INT(14, notifications);
+  TEST_ASSERT_FALSE(sender.hasFragments());
+}
+
+static void test_rejects_invalid_messages(void)
+{
+  DataLink sender;
+  byte message[DataLink::CfgMaxMessageSize + 1] = {};
+  TEST_ASSERT_FALSE(sender.send(message, 0));
+  TEST_ASSERT_FALSE(sender.send(message, sizeof(message)));
+  TEST_ASSERT_TRUE(sender.send(message, DataLink::CfgMaxMessageSize));
+  // fragment must have room for payload after header
+  byte fragment[8];
+  TEST_ASSERT_EQUAL_INT(0, sender.peekFragment(fragment, DataLink::CfgFragmentHeaderSize));
+}
+
+static void test_lossy_link_never_delivers_wrong_message(void)
+{
+  DataLink sender, receiver;
+  MockTransceiver link(11, LossyLink);
+  std::vector<MockTransceiver::Packet> sent;
+  int delivered = 0;
+
+  for (int i = 0; i < 2000; i++) {
+    MockTransceiver::Packet message = link.randomPacket(link.randomInt(1, 300));
+    // message id is one byte, it is sent as a prefix to find the original
+    message[0] = i & 0xff;
+    message.resize(max((int)message.size(), 2));
+    message[1] = (i >> 8) & 0xff;
+    sent.push_back(message);
+    TEST_ASSERT_TRUE(sender.send(message.data(), message.size()));
+    runLink(sender, receiver, link, link.randomInt(8, 200));
+
+    byte received[DataLink::CfgMaxMessageSize];
+    int receivedSize;
+    while ((receivedSize = receiver.receive(received, sizeof(received))) > 0) {
+      int index = received[0] | (received[1] << 8);
+      TEST_ASSERT_TRUE(index <= i);
+      TEST_ASSERT_EQUAL_INT(sent[index].size(), receivedSize);
+      TEST_ASSERT_EQUAL_MEMORY(sent[index].data(), received, receivedSize);
+      delivered++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(500, delivered);
+  char text[96];
+  snprintf(text, sizeof(text), "lossy link: %d of %d messages delivered", delivered, (int)sent.size());
+  TEST_MESSAGE(text);
+}
+
+static void test_corrupted_fragments_without_crc(void)
+{
+  // radio crc is off with fec, fragments with damaged headers must not break the receiver
+  DataLink sender, receiver;
+  MockTransceiver::Params params = { 0, 0.01f, 0, 0, false };
+  MockTransceiver link(12, params);
+  for (int i = 0; i < 1000; i++) {
+    MockTransceiver::Packet message = link.randomPacket(link.randomInt(1, DataLink::CfgMaxMessageSize));
+    sender.send(message.data(), message.size());
+    runLink(sender, receiver, link, link.randomInt(4, 255));
+    byte received[DataLink::CfgMaxMessageSize];
+    while (receiver.receive(received, sizeof(received)) > 0) {}
+  }
+  TEST_ASSERT_GREATER_THAN(0, link.getStats().corrupted);
+}
+
+static void test_send_queue_overflow(void)
+{
+  DataLink sender;
+  byte message[DataLink::CfgMaxMessageSize] = {};
+  int queued = 0;
+  while (sender.send(message, sizeof(message))) queued++;
+  TEST_ASSERT_GREATER_THAN(0, queued);
+  TEST_ASSERT_TRUE(sender.hasFragments());
+}
+
+static void test_throughput(void)
+{
+  DataLink sender, receiver;
+  MockTransceiver link(13, CleanLink);
+  MockTransceiver::Packet message = link.randomPacket(DataLink::CfgMaxMessageSize);
+  byte received[DataLink::CfgMaxMessageSize];
+  const int iterations = 20000;
+  auto startTime = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sender.send(message.data(), message.size());
+    runLink(sender, receiver, link, 64);
+    receiver.receive(received, sizeof(received));
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  char text[96];
+  snprintf(text, sizeof(text), "data link: %.1f MB/s over 64 byte fragments", iterations * message.size() / seconds / 1e6);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_messages_are_fragmented_and_reassembled);
+  RUN_TEST(test_rejects_invalid_messages);
+  RUN_TEST(test_lossy_link_never_delivers_wrong_message);
+  RUN_TEST(test_corrupted_fragments_without_crc);
+  RUN_TEST(test_send_queue_overflow);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
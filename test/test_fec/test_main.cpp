@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include "fec/fec_golay.h"
+#include "fec/fec_conv.h"
+#include "fec/fec_uep.h"
+
+using namespace LoraDv;
+
+// decode throughput and bit error rate to packet loss simulation for FEC stages,
+// results are printed, so FEC type could be chosen for the bit rate and link quality
+static const int PacketSize = 48;     // six Codec2 3200 frames
+static const int SpeedPackets = 2000;
+static const int SimPackets = 500;
+static const float BitErrorRates[] = { 0.001f, 0.005f, 0.01f, 0.02f, 0.03f, 0.05f };
+static const int BerCount = sizeof(BitErrorRates) / sizeof(BitErrorRates[0]);
+
+struct SimResult {
+  float dropped;
+  float damaged;
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::unique_ptr<Fec> makeUep()
+{
+  // codec2 3200 frames without header, damaged packets have errors in spectral bits only
+  return std::unique_ptr<Fec>(new FecUep(8, 0, 14, [](const byte *packetBuf, int packetSize) { return 0; }));
+}
+
+static void corrupt(std::mt19937 &rng, byte *buf, int size, float ber)
+{
+  std::bernoulli_distribution isError(ber);
+  for (int i = 0; i < 8 * size; i++) {
+    if (isError(rng)) buf[i >> 3] ^= 0x80 >> (i & 7);
+  }
+}
+
+static void simulate(Fec &fec, SimResult *results)
+{
+  std::mt19937 rng(42);
+  byte data[PacketSize], encoded[256], corrupted[256], decoded[256];
+  for (int i = 0; i < PacketSize; i++) data[i] = rng() & 0xff;
+  int encodedSize = fec.encode(data, PacketSize, encoded);
+  TEST_ASSERT_GREATER_THAN(0, encodedSize);
+  TEST_ASSERT_EQUAL_INT(PacketSize, fec.decode(encoded, encodedSize, decoded));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(data, decoded, PacketSize);
+
+  // decode time does not depend on errors for all codes
+  auto startTime = std::chrono::steady_clock::now();
+  for (int i = 0; i < SpeedPackets; i++) fec.decode(encoded, encodedSize, decoded);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  char message[128];
+  snprintf(message, sizeof(message), "%s encoded size: %d, decode us/packet: %.1f, kbps: %.0f", fec.getName(),
+    encodedSize, 1e6 * seconds / SpeedPackets, 8.0 * PacketSize * SpeedPackets / seconds / 1000);
+  TEST_MESSAGE(message);
+
+  // packet is either dropped or delivered with errors
+  for (int i = 0; i < BerCount; i++) {
+    int dropped = 0;
+    int damaged = 0;
+    for (int j = 0; j < SimPackets; j++) {
+      memcpy(corrupted, encoded, encodedSize);
+      corrupt(rng, corrupted, encodedSize, BitErrorRates[i]);
+      int decodedSize = fec.decode(corrupted, encodedSize, decoded);
+      if (decodedSize != PacketSize) {
+        dropped++;
+      } else if (memcmp(decoded, data, PacketSize) != 0) {
+        damaged++;
+      }
+    }
+    results[i] = { (float)dropped / SimPackets, (float)damaged / SimPackets };
+    snprintf(message, sizeof(message), "%s BER: %.3f dropped: %.3f damaged: %.3f", fec.getName(),
+      BitErrorRates[i], results[i].dropped, results[i].damaged);
+    TEST_MESSAGE(message);
+  }
+}
+
+static float uncodedLoss(float ber)
+{
+  // uncoded packet is lost on any bit error
+  return 1.0f - powf(1.0f - ber, 8 * PacketSize);
+}
+
+static void test_uncoded_loss(void)
+{
+  char message[64];
+  for (int i = 0; i < BerCount; i++) {
+    snprintf(message, sizeof(message), "None BER: %.3f loss: %.3f", BitErrorRates[i], uncodedLoss(BitErrorRates[i]));
+    TEST_MESSAGE(message);
+  }
+}
+
+static void test_golay(void)
+{
+  FecGolay fec;
+  SimResult results[BerCount];
+  simulate(fec, results);
+  // corrects up to 3 errors per codeword, more errors are mostly detected and dropped
+  TEST_ASSERT_TRUE(results[0].dropped < 0.01f);
+  TEST_ASSERT_TRUE(results[1].dropped < uncodedLoss(BitErrorRates[1]) / 4);
+  for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(results[i].damaged < 0.01f);
+}
+
+static void test_conv(void)
+{
+  FecConv fec;
+  SimResult results[BerCount];
+  simulate(fec, results);
+  TEST_ASSERT_TRUE(results[1].dropped + results[1].damaged < 0.01f);
+  TEST_ASSERT_TRUE(results[2].dropped + results[2].damaged < uncodedLoss(BitErrorRates[2]) / 4);
+}
+
+static void test_uep(void)
+{
+  std::unique_ptr<Fec> fec = makeUep();
+  SimResult results[BerCount];
+  simulate(*fec, results);
+  // spectral bit errors are delivered, so fewer packets are dropped than with full protection
+  TEST_ASSERT_TRUE(results[2].dropped < uncodedLoss(BitErrorRates[2]) / 4);
+}
+
+static void test_sizes_round_trip(void)
+{
+  // every size up to the largest one fitting into the radio packet survives encode and decode
+  FecGolay golay;
+  FecConv conv;
+  std::unique_ptr<Fec> uep = makeUep();
+  Fec *fecs[] = { &golay, &conv, uep.get() };
+  std::mt19937 rng(7);
+  byte data[256], encoded[256], decoded[256];
+  for (Fec *fec : fecs) {
+    int maxDataSize = fec->getMaxDataSize(255);
+    for (int dataSize = 1; dataSize <= maxDataSize; dataSize++) {
+      for (int i = 0; i < dataSize; i++) data[i] = rng() & 0xff;
+      int encodedSize = fec->encode(data, dataSize, encoded);
+      // uep estimate is the fully protected size
+      TEST_ASSERT_GREATER_THAN(0, encodedSize);
+      TEST_ASSERT_LESS_OR_EQUAL(fec->getEncodedSize(dataSize), encodedSize);
+      TEST_ASSERT_LESS_OR_EQUAL(255, encodedSize);
+      TEST_ASSERT_EQUAL_INT(dataSize, fec->decode(encoded, encodedSize, decoded));
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(data, decoded, dataSize);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_uncoded_loss);
+  RUN_TEST(test_golay);
+  RUN_TEST(test_conv);
+  RUN_TEST(test_uep);
+  RUN_TEST(test_sizes_round_trip);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+#include <unity.h>
+#include <random>
+
+#include "fec/fec_uep.h"
+#include "hal/radio_queue.h"
+
+using namespace LoraDv;
+
+// codec2 3200: 8 byte frames, voicing, pitch and energy in the first 14 bits
+static const int FrameSize = 8;
+static const int SensitiveBits = 14;
+static const byte TypeVoice = 0x01;
+static const int RadioMaxPacketSize = 255;
+
+static int getHeaderSize(const byte *packet, int packetSize)
+{
+  return packet[0] == TypeVoice ? 1 : packetSize;
+}
+
+static int makeVoicePacket(std::mt19937 &rng, int frames, byte *packet)
+{
+  packet[0] = TypeVoice;
+  for (int i = 1; i <= frames * FrameSize; i++) packet[i] = rng() & 0xff;
+  return 1 + frames * FrameSize;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_voice_packets_decode_larger_than_estimate(void)
+{
+  // estimate is the fully protected size, used as a lower bound only
+  FecUep fec(FrameSize, 0, SensitiveBits, &getHeaderSize);
+  std::mt19937 rng(1);
+  byte packet[256], encoded[256], decoded[256];
+  for (int frames = 1; frames <= 15; frames++) {
+    int packetSize = makeVoicePacket(rng, frames, packet);
+    int encodedSize = fec.encode(packet, packetSize, encoded);
+    TEST_ASSERT_GREATER_THAN(0, encodedSize);
+    TEST_ASSERT_LESS_OR_EQUAL(RadioMaxPacketSize, encodedSize);
+    TEST_ASSERT_LESS_OR_EQUAL(packetSize, fec.getMaxDataSize(encodedSize));
+    TEST_ASSERT_EQUAL_INT(packetSize, fec.decode(encoded, encodedSize, decoded));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(packet, decoded, packetSize);
+  }
+}
+
+static void test_rx_queue_sizing_round_trip(void)
+{
+  // rx path: decode into the packet buffer, then reserve the decoded size in the queue
+  FecUep fec(FrameSize, 0, SensitiveBits, &getHeaderSize);
+  RadioQueue queue;
+  std::mt19937 rng(2);
+  byte packet[256], encoded[256], decoded[256], popped[256];
+  for (int frames = 1; frames <= 15; frames++) {
+    int packetSize = makeVoicePacket(rng, frames, packet);
+    int encodedSize = fec.encode(packet, packetSize, encoded);
+
+    // reservation by the estimate is too small, commit must not take the decoded size
+    int decodedSize = fec.decode(encoded, encodedSize, decoded);
+    TEST_ASSERT_NOT_NULL(queue.reserve(fec.getMaxDataSize(encodedSize)));
+    TEST_ASSERT_FALSE(queue.commit(decodedSize));
+
+    byte *queueBuf = queue.reserve(decodedSize);
+    TEST_ASSERT_NOT_NULL(queueBuf);
+    memcpy(queueBuf, decoded, decodedSize);
+    TEST_ASSERT_TRUE(queue.commit(decodedSize, 0, 0, 1));
+    TEST_ASSERT_EQUAL_INT(packetSize, queue.pop(popped, sizeof(popped)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(packet, popped, packetSize);
+  }
+}
+
+static void test_encode_is_bounded_by_bit_buffers(void)
+{
+  FecUep fec(FrameSize, 0, SensitiveBits, &getHeaderSize);
+  int maxDataSize = fec.getMaxDataSize(256);
+  byte packet[256] = {}, encoded[512];
+  // data packets are fully protected, the largest one still fits into 256 encoded bytes
+  packet[0] = 0x02;
+  int encodedSize = fec.encode(packet, maxDataSize, encoded);
+  TEST_ASSERT_GREATER_THAN(0, encodedSize);
+  TEST_ASSERT_LESS_OR_EQUAL(256, encodedSize);
+  TEST_ASSERT_EQUAL_INT(0, fec.encode(packet, maxDataSize + 1, encoded));
+  TEST_ASSERT_EQUAL_INT(0, fec.encode(packet, 127, encoded));
+}
+
+static void test_spectral_bit_errors_are_delivered(void)
+{
+  FecUep fec(FrameSize, 0, SensitiveBits, &getHeaderSize);
+  std::mt19937 rng(3);
+  byte packet[256], encoded[256], decoded[256];
+  int packetSize = makeVoicePacket(rng, 10, packet);
+  int encodedSize = fec.encode(packet, packetSize, encoded);
+  // few scattered errors are corrected, the packet keeps its size
+  encoded[encodedSize / 2] ^= 0x10;
+  encoded[encodedSize - 2] ^= 0x01;
+  int correctedBits = 0;
+  TEST_ASSERT_EQUAL_INT(packetSize, fec.decode(encoded, encodedSize, decoded, &correctedBits));
+  TEST_ASSERT_GREATER_THAN(0, correctedBits);
+  TEST_ASSERT_EQUAL_HEX8(TypeVoice, decoded[0]);
+}
+
+static void test_corrupted_packets_never_exceed_radio_packet(void)
+{
+  // random radio packets either fail or decode into a packet the rx buffers could hold
+  FecUep fec(FrameSize, 0, SensitiveBits, &getHeaderSize);
+  std::mt19937 rng(4);
+  byte encoded[256], decoded[256];
+  for (int i = 0; i < 20000; i++) {
+    int encodedSize = 1 + rng() % RadioMaxPacketSize;
+    for (int j = 0; j < encodedSize; j++) encoded[j] = rng() & 0xff;
+    int decodedSize = fec.decode(encoded, encodedSize, decoded);
+    TEST_ASSERT_LESS_OR_EQUAL(RadioMaxPacketSize, decodedSize);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_voice_packets_decode_larger_than_estimate);
+  RUN_TEST(test_rx_queue_sizing_round_trip);
+  RUN_TEST(test_encode_is_bounded_by_bit_buffers);
+  RUN_TEST(test_spectral_bit_errors_are_delivered);
+  RUN_TEST(test_corrupted_packets_never_exceed_radio_packet);
+  return UNITY_END();
+}
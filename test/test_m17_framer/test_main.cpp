@@ -0,0 +1,275 @@
+#include <unity.h>
+#include <vector>
+
+#include "protocol/m17_framer.h"
+
+using namespace LoraDv;
+
+// reference values and definitions from the M17 specification, the reference encoder
+// below is a plain bit level implementation of the spec, independent from the framer
+
+typedef std::vector<uint8_t> Bits;
+
+static const uint16_t SpecGolayMatrix[12] = {
+  0x8eb, 0x93e, 0xa97, 0xdc6, 0x367, 0x6cd, 0xd99, 0x3da, 0x7b4, 0xf68, 0x63b, 0xc75
+};
+
+static const uint8_t SpecP1[61] = {
+  1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0,
+  1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1
+};
+
+static const uint8_t SpecP2[12] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 };
+
+static const uint8_t SpecRandomizer[46] = {
+  0xd6, 0xb5, 0xe2, 0x30, 0x82, 0xff, 0x84, 0x62, 0xba, 0x4e, 0x96, 0x90, 0xd8, 0x98, 0xdd, 0x5d,
+  0x0c, 0xc8, 0x52, 0x43, 0x91, 0x1d, 0xf8, 0x6e, 0x68, 0x2f, 0x35, 0xda, 0x14, 0xea, 0xcd, 0x76,
+  0x19, 0x8d, 0xd5, 0x80, 0xd1, 0x33, 0x87, 0x13, 0x57, 0x18, 0x2d, 0x29, 0x78, 0xc3
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void appendBits(Bits &bits, uint32_t value, int count)
+{
+  for (int i = count - 1; i >= 0; i--) bits.push_back((value >> i) & 1);
+}
+
+static Bits bytesToBits(const byte *data, int dataLen)
+{
+  Bits bits;
+  for (int i = 0; i < dataLen; i++) appendBits(bits, data[i], 8);
+  return bits;
+}
+
+static uint32_t specGolayEncode(uint16_t data)
+{
+  uint16_t parity = 0;
+  for (int i = 0; i < 12; i++) {
+    if (data & (1 << i)) parity ^= SpecGolayMatrix[i];
+  }
+  return ((uint32_t)data << 12) | parity;
+}
+
+static Bits specConvEncode(const Bits &data, const uint8_t *puncture, int punctureLen)
+{
+  // G1 = 1 + D^3 + D^4, G2 = 1 + D + D^2 + D^4, encoder is flushed with 4 zero bits
+  uint8_t d[5] = {};
+  Bits encoded;
+  int pos = 0;
+  for (size_t i = 0; i < data.size() + 4; i++) {
+    for (int j = 4; j > 0; j--) d[j] = d[j - 1];
+    d[0] = i < data.size() ? data[i] : 0;
+    uint8_t out[2] = { (uint8_t)(d[0] ^ d[3] ^ d[4]), (uint8_t)(d[0] ^ d[1] ^ d[2] ^ d[4]) };
+    for (int j = 0; j < 2; j++, pos++) {
+      if (puncture[pos % punctureLen]) encoded.push_back(out[j]);
+    }
+  }
+  return encoded;
+}
+
+static void specFinishFrame(uint16_t sync, const Bits &bits, byte *frame)
+{
+  // quadratic permutation polynomial interleaver, then randomizer
+  TEST_ASSERT_EQUAL_INT(368, bits.size());
+  memset(frame, 0, 48);
+  frame[0] = sync >> 8;
+  frame[1] = sync & 0xff;
+  for (int i = 0; i < 368; i++) {
+    uint8_t bit = bits[(45 * i + 92 * i * i) % 368] ^ ((SpecRandomizer[i / 8] >> (7 - i % 8)) & 1);
+    frame[2 + i / 8] |= bit << (7 - i % 8);
+  }
+}
+
+static void specLsf(byte *lsf)
+{
+  // @ALL broadcast, source AB1CD, voice stream type
+  memset(lsf, 0, 30);
+  memset(lsf, 0xff, 6);
+  const byte src[6] = { 0x00, 0x00, 0x00, 0x9f, 0xdd, 0x51 };
+  memcpy(lsf + 6, src, 6);
+  lsf[13] = 0x05;
+  uint16_t crc = M17Framer::crc16(lsf, 28);
+  lsf[28] = crc >> 8;
+  lsf[29] = crc & 0xff;
+}
+
+static void test_crc16_matches_spec_vectors(void)
+{
+  TEST_ASSERT_EQUAL_HEX16(0xffff, M17Framer::crc16((const byte *)"", 0));
+  TEST_ASSERT_EQUAL_HEX16(0x206e, M17Framer::crc16((const byte *)"A", 1));
+  TEST_ASSERT_EQUAL_HEX16(0x772b, M17Framer::crc16((const byte *)"123456789", 9));
+  byte all[256];
+  for (int i = 0; i < 256; i++) all[i] = i;
+  TEST_ASSERT_EQUAL_HEX16(0x1c31, M17Framer::crc16(all, sizeof(all)));
+}
+
+static void test_callsign_matches_spec_encoding(void)
+{
+  byte address[6];
+  const byte ab1cd[6] = { 0x00, 0x00, 0x00, 0x9f, 0xdd, 0x51 };
+  TEST_ASSERT_TRUE(M17Framer::encodeCallsign("AB1CD", address));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(ab1cd, address, 6);
+  TEST_ASSERT_TRUE(M17Framer::encodeCallsign("ab1cd", address));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(ab1cd, address, 6);
+
+  const byte broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  TEST_ASSERT_TRUE(M17Framer::encodeCallsign("@ALL", address));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(broadcast, address, 6);
+
+  char text[16];
+  TEST_ASSERT_TRUE(M17Framer::decodeCallsign(ab1cd, text, sizeof(text)));
+  TEST_ASSERT_EQUAL_STRING("AB1CD", text);
+  TEST_ASSERT_TRUE(M17Framer::decodeCallsign(broadcast, text, sizeof(text)));
+  TEST_ASSERT_EQUAL_STRING("@ALL", text);
+
+  TEST_ASSERT_FALSE(M17Framer::encodeCallsign("", address));
+  TEST_ASSERT_FALSE(M17Framer::encodeCallsign("TOOLONGCALL", address));
+  TEST_ASSERT_FALSE(M17Framer::encodeCallsign("AB_CD", address));
+}
+
+static void test_golay_matches_spec_generator(void)
+{
+  Golay24 golay;
+  for (int i = 0; i < 12; i++) {
+    TEST_ASSERT_EQUAL_HEX32(((uint32_t)1 << (12 + i)) | SpecGolayMatrix[i], golay.encode(1 << i));
+  }
+  // extended Golay code weight distribution: 1, 759, 2576, 759, 1
+  int weights[25] = {};
+  for (uint32_t data = 0; data < 4096; data++) {
+    uint32_t codeword = golay.encode(data);
+    TEST_ASSERT_EQUAL_HEX32(specGolayEncode(data), codeword);
+    weights[__builtin_popcount(codeword)]++;
+  }
+  TEST_ASSERT_EQUAL_INT(1, weights[0]);
+  TEST_ASSERT_EQUAL_INT(759, weights[8]);
+  TEST_ASSERT_EQUAL_INT(2576, weights[12]);
+  TEST_ASSERT_EQUAL_INT(759, weights[16]);
+  TEST_ASSERT_EQUAL_INT(1, weights[24]);
+}
+
+static void test_golay_corrects_three_errors(void)
+{
+  Golay24 golay;
+  uint16_t data;
+  uint32_t codeword = golay.encode(0xa5c);
+  TEST_ASSERT_TRUE(golay.decode(codeword ^ 0x800101, data));
+  TEST_ASSERT_EQUAL_HEX16(0xa5c, data);
+  TEST_ASSERT_TRUE(golay.decode(codeword ^ 0x000007, data));
+  TEST_ASSERT_EQUAL_HEX16(0xa5c, data);
+  TEST_ASSERT_FALSE(golay.decode(codeword ^ 0x00000f, data));
+}
+
+static void test_conv_code_impulse_response(void)
+{
+  // single one bit followed by the flush bits gives G1 and G2 taps interleaved
+  ConvCode convCode(8);
+  const byte data[1] = { 0x80 };
+  uint8_t encoded[32];
+  const uint8_t expected[10] = { 1, 1, 0, 1, 0, 1, 1, 0, 1, 1 };
+  const uint8_t noPuncture[1] = { 1 };
+  TEST_ASSERT_EQUAL_INT(10, convCode.encode(data, 1, noPuncture, 1, encoded));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, encoded, 10);
+}
+
+static void test_punctured_lengths_match_spec(void)
+{
+  TEST_ASSERT_EQUAL_INT(368, ConvCode::getEncodedBits(240, SpecP1, 61));
+  TEST_ASSERT_EQUAL_INT(272, ConvCode::getEncodedBits(144, SpecP2, 12));
+}
+
+static void test_lsf_frame_matches_reference(void)
+{
+  byte lsf[30];
+  specLsf(lsf);
+  byte expected[48];
+  specFinishFrame(0x55f7, specConvEncode(bytesToBits(lsf, 30), SpecP1, 61), expected);
+
+  M17Framer framer;
+  byte frame[M17Framer::CfgFrameSize];
+  TEST_ASSERT_TRUE(framer.setLsf("@ALL", "AB1CD", M17Framer::CfgTypeVoice));
+  TEST_ASSERT_EQUAL_INT(48, framer.encodeLsf(frame));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, 48);
+
+  byte payload[M17Framer::CfgPayloadSize];
+  bool isLast = false;
+  M17Framer receiver;
+  TEST_ASSERT_EQUAL_INT((int)M17Framer::FrameType::Lsf, (int)receiver.decode(frame, sizeof(frame), payload, isLast));
+  char src[16];
+  TEST_ASSERT_TRUE(receiver.getRxSource(src, sizeof(src)));
+  TEST_ASSERT_EQUAL_STRING("AB1CD", src);
+}
+
+static void test_stream_frames_match_reference(void)
+{
+  byte lsf[30];
+  specLsf(lsf);
+  M17Framer framer;
+  TEST_ASSERT_TRUE(framer.setLsf("@ALL", "AB1CD", M17Framer::CfgTypeVoice));
+  framer.startStream();
+
+  for (int frameNumber = 0; frameNumber < 8; frameNumber++) {
+    bool isLast = frameNumber == 7;
+    byte payload[16];
+    for (int i = 0; i < 16; i++) payload[i] = frameNumber * 16 + i;
+
+    // lich: 40 lsf bits and 3 bit chunk counter, 4 Golay codewords
+    int chunkId = frameNumber % 6;
+    Bits lich = bytesToBits(lsf + 5 * chunkId, 5);
+    appendBits(lich, chunkId << 5, 8);
+    Bits bits;
+    for (int i = 0; i < 4; i++) {
+      uint16_t word = 0;
+      for (int j = 0; j < 12; j++) word = (word << 1) | lich[12 * i + j];
+      appendBits(bits, specGolayEncode(word), 24);
+    }
+    // frame number with end of stream bit and payload
+    Bits data;
+    appendBits(data, frameNumber | (isLast ? 0x8000 : 0), 16);
+    Bits payloadBits = bytesToBits(payload, 16);
+    data.insert(data.end(), payloadBits.begin(), payloadBits.end());
+    Bits encoded = specConvEncode(data, SpecP2, 12);
+    bits.insert(bits.end(), encoded.begin(), encoded.end());
+    byte expected[48];
+    specFinishFrame(0xff5d, bits, expected);
+
+    byte frame[M17Framer::CfgFrameSize];
+    TEST_ASSERT_EQUAL_INT(48, framer.encodeStream(payload, sizeof(payload), isLast, frame));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, 48);
+  }
+}
+
+static void test_eot_and_sync_words(void)
+{
+  M17Framer framer;
+  byte frame[M17Framer::CfgFrameSize];
+  TEST_ASSERT_EQUAL_INT(48, framer.encodeEot(frame));
+  for (int i = 0; i < 48; i += 2) {
+    TEST_ASSERT_EQUAL_HEX8(0x55, frame[i]);
+    TEST_ASSERT_EQUAL_HEX8(0x5d, frame[i + 1]);
+  }
+  byte payload[M17Framer::CfgPayloadSize];
+  bool isLast = false;
+  TEST_ASSERT_EQUAL_INT((int)M17Framer::FrameType::Eot, (int)framer.decode(frame, sizeof(frame), payload, isLast));
+  TEST_ASSERT_TRUE(isLast);
+
+  // packet mode sync word is not used by the framer
+  frame[0] = 0x75;
+  frame[1] = 0xff;
+  TEST_ASSERT_EQUAL_INT((int)M17Framer::FrameType::Invalid, (int)framer.decode(frame, sizeof(frame), payload, isLast));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_crc16_matches_spec_vectors);
+  RUN_TEST(test_callsign_matches_spec_encoding);
+  RUN_TEST(test_golay_matches_spec_generator);
+  RUN_TEST(test_golay_corrects_three_errors);
+  RUN_TEST(test_conv_code_impulse_response);
+  RUN_TEST(test_punctured_lengths_match_spec);
+  RUN_TEST(test_lsf_frame_matches_reference);
+  RUN_TEST(test_stream_frames_match_reference);
+  RUN_TEST(test_eot_and_sync_words);
+  return UNITY_END();
+}
@@ -0,0 +1,291 @@
+#include <unity.h>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "hal/radio_queue.h"
+#include "mock_transceiver.h"
+
+using namespace LoraDv;
+
+static const MockTransceiver::Params CleanLink = { 0, 0, 0, 0, true };
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_push_pop_keeps_order_and_metadata(void)
+{
+  RadioQueue queue;
+  byte packet[64];
+  for (int i = 0; i < 5; i++) {
+    memset(packet, i, sizeof(packet));
+    TEST_ASSERT_TRUE(queue.push(packet, 10 + i, -100.0f + i, 5.0f + i, i));
+  }
+  TEST_ASSERT_EQUAL_INT(5, queue.size());
+  for (int i = 0; i < 5; i++) {
+    RadioQueue::Packet meta;
+    TEST_ASSERT_EQUAL_INT(10 + i, queue.pop(packet, sizeof(packet), &meta));
+    TEST_ASSERT_EQUAL_INT(i, packet[0]);
+    TEST_ASSERT_EQUAL_INT(i, packet[9 + i]);
+    TEST_ASSERT_TRUE(meta.rssi == -100.0f + i);
+    TEST_ASSERT_TRUE(meta.snr == 5.0f + i);
+    TEST_ASSERT_EQUAL_INT(i, meta.flags);
+  }
+  TEST_ASSERT_FALSE(queue.hasData());
+  TEST_ASSERT_EQUAL_INT(0, queue.pop(packet, sizeof(packet)));
+}
+
+static void test_rejects_invalid_sizes(void)
+{
+  RadioQueue queue;
+  static byte packet[4096];
+  TEST_ASSERT_FALSE(queue.push(packet, 0));
+  TEST_ASSERT_FALSE(queue.push(packet, -1));
+  TEST_ASSERT_FALSE(queue.push(packet, sizeof(packet)));
+  TEST_ASSERT_NULL(queue.reserve(0));
+  TEST_ASSERT_EQUAL_INT(0, queue.size());
+}
+
+static void test_too_large_packet_is_skipped_on_pop(void)
+{
+  RadioQueue queue;
+  byte packet[32] = { 1, 2, 3 };
+  TEST_ASSERT_TRUE(queue.push(packet, 32));
+  TEST_ASSERT_TRUE(queue.push(packet, 3));
+  TEST_ASSERT_EQUAL_INT(-1, queue.pop(packet, 16));
+  TEST_ASSERT_EQUAL_INT(3, queue.pop(packet, 16));
+  TEST_ASSERT_EQUAL_INT(0, queue.size());
+}
+
+static void test_overflow_by_slots_and_by_bytes(void)
+{
+  byte packet[200] = {};
+
+  // small packets run out of slots first
+  RadioQueue slotsQueue;
+  int slots = 0;
+  while (slotsQueue.push(packet, 1)) slots++;
+  TEST_ASSERT_GREATER_THAN(0, slots);
+  TEST_ASSERT_EQUAL_INT(slots, slotsQueue.size());
+  TEST_ASSERT_EQUAL_INT(100, slotsQueue.load());
+
+  // large packets run out of bytes first
+  RadioQueue bytesQueue;
+  int packets = 0;
+  while (bytesQueue.push(packet, sizeof(packet))) packets++;
+  TEST_ASSERT_GREATER_THAN(0, packets);
+  TEST_ASSERT_TRUE(packets < slots);
+  TEST_ASSERT_TRUE(bytesQueue.load() > 50);
+
+  // space is back after the oldest is dropped
+  TEST_ASSERT_TRUE(bytesQueue.dropOldest());
+  TEST_ASSERT_TRUE(bytesQueue.push(packet, sizeof(packet)));
+  bytesQueue.clear();
+  TEST_ASSERT_EQUAL_INT(0, bytesQueue.size());
+  TEST_ASSERT_EQUAL_INT(0, bytesQueue.load());
+  TEST_ASSERT_FALSE(bytesQueue.dropOldest());
+}
+
+static void test_commit_rejects_larger_than_reserved(void)
+{
+  RadioQueue queue;
+  byte packet[16] = {};
+  TEST_ASSERT_NOT_NULL(queue.reserve(8));
+  TEST_ASSERT_FALSE(queue.commit(9));
+  TEST_ASSERT_EQUAL_INT(0, queue.size());
+  // reservation is released, commit without a new reserve does nothing
+  TEST_ASSERT_FALSE(queue.commit(4));
+  TEST_ASSERT_NOT_NULL(queue.reserve(8));
+  TEST_ASSERT_TRUE(queue.commit(6));
+  TEST_ASSERT_EQUAL_INT(6, queue.pop(packet, sizeof(packet)));
+}
+
+static void test_counts_dropped_packets(void)
+{
+  RadioQueue queue;
+  byte packet[8] = {};
+  TEST_ASSERT_FALSE(queue.dropOldest());
+  TEST_ASSERT_EQUAL_UINT32(0, queue.getDroppedCount());
+  queue.push(packet, sizeof(packet));
+  queue.push(packet, sizeof(packet));
+  TEST_ASSERT_TRUE(queue.dropOldest());
+  queue.countDropped();
+  queue.clear();
+  TEST_ASSERT_EQUAL_UINT32(2, queue.getDroppedCount());
+}
+
+static void test_wraps_without_splitting_packets(void)
+{
+  RadioQueue queue;
+  MockTransceiver generator(1, CleanLink);
+  std::deque<MockTransceiver::Packet> expected;
+  byte packet[256];
+
+  // keep queue half full while offsets go around the buffer many times
+  for (int i = 0; i < 2000; i++) {
+    MockTransceiver::Packet next = generator.randomPacket(generator.randomInt(1, 150));
+    while (!queue.push(next.data(), next.size())) {
+      TEST_ASSERT_EQUAL_INT(expected.front().size(), queue.pop(packet, sizeof(packet)));
+      TEST_ASSERT_EQUAL_MEMORY(expected.front().data(), packet, expected.front().size());
+      expected.pop_front();
+    }
+    expected.push_back(next);
+  }
+  while (!expected.empty()) {
+    TEST_ASSERT_EQUAL_INT(expected.front().size(), queue.pop(packet, sizeof(packet)));
+    TEST_ASSERT_EQUAL_MEMORY(expected.front().data(), packet, expected.front().size());
+    expected.pop_front();
+  }
+  TEST_ASSERT_EQUAL_INT(0, queue.size());
+}
+
+static void test_randomized_against_model(void)
+{
+  RadioQueue queue;
+  MockTransceiver generator(2, CleanLink);
+  std::deque<MockTransceiver::Packet> model;
+  byte packet[512];
+
+  for (int i = 0; i < 50000; i++) {
+    int op = generator.randomInt(0, 9);
+    if (op < 4) {
+      MockTransceiver::Packet next = generator.randomPacket(generator.randomInt(1, 300));
+      if (queue.push(next.data(), next.size())) model.push_back(next);
+    } else if (op < 6) {
+      // radio reads fifo straight into the queue
+      int packetSize = generator.randomInt(1, 300);
+      byte *reserved = queue.reserve(packetSize);
+      if (reserved != nullptr) {
+        MockTransceiver::Packet next = generator.randomPacket(packetSize);
+        memcpy(reserved, next.data(), packetSize);
+        queue.commit(packetSize);
+        model.push_back(next);
+      }
+    } else if (op < 8) {
+      int packetSize = queue.pop(packet, sizeof(packet));
+      if (model.empty()) {
+        TEST_ASSERT_EQUAL_INT(0, packetSize);
+      } else {
+        TEST_ASSERT_EQUAL_INT(model.front().size(), packetSize);
+        TEST_ASSERT_EQUAL_MEMORY(model.front().data(), packet, packetSize);
+        model.pop_front();
+      }
+    } else if (op == 8) {
+      // audio task decodes in place
+      RadioQueue::Packet meta;
+      const byte *data = queue.peek(meta);
+      if (model.empty()) {
+        TEST_ASSERT_NULL(data);
+      } else {
+        TEST_ASSERT_NOT_NULL(data);
+        TEST_ASSERT_EQUAL_INT(model.front().size(), meta.size);
+        TEST_ASSERT_EQUAL_MEMORY(model.front().data(), data, meta.size);
+        queue.release();
+        model.pop_front();
+      }
+    } else {
+      TEST_ASSERT_EQUAL_INT(!model.empty(), queue.dropOldest());
+      if (!model.empty()) model.pop_front();
+    }
+    TEST_ASSERT_EQUAL_INT(model.size(), queue.size());
+  }
+}
+
+static void test_burst_fill_and_drain(void)
+{
+  RadioQueue queue;
+  byte packet[64];
+  // rx batching: radio fills the queue in a burst, audio drains it in one go
+  for (int burst = 0; burst < 100; burst++) {
+    int pushed = 0;
+    for (int i = 0; i < 1000 && queue.push(packet, 1 + (burst + i) % 64); i++) pushed++;
+    TEST_ASSERT_GREATER_THAN(0, pushed);
+    TEST_ASSERT_EQUAL_INT(pushed, queue.size());
+    int popped = 0;
+    while (queue.pop(packet, sizeof(packet)) > 0) popped++;
+    TEST_ASSERT_EQUAL_INT(pushed, popped);
+    TEST_ASSERT_EQUAL_INT(0, queue.load());
+  }
+}
+
+static void test_concurrent_producers(void)
+{
+  // audio, serial and repeater push into the same tx queue from different tasks
+  RadioQueue queue;
+  const int producers = 3;
+  const int packetsPerProducer = 20000;
+  std::vector<std::thread> threads;
+  for (int id = 0; id < producers; id++) {
+    threads.emplace_back([&queue, id]() {
+      byte packet[64];
+      for (int seq = 0; seq < packetsPerProducer; seq++) {
+        int size = 4 + (seq * 7 + id) % 60;
+        packet[0] = id;
+        packet[1] = seq & 0xff;
+        packet[2] = (seq >> 8) & 0xff;
+        packet[3] = (seq >> 16) & 0xff;
+        for (int i = 4; i < size; i++) packet[i] = (byte)(id + seq + i);
+        while (!queue.push(packet, size, 0, 0, id)) std::this_thread::yield();
+      }
+    });
+  }
+
+  int nextSeq[producers] = {};
+  int received = 0;
+  byte packet[64];
+  RadioQueue::Packet meta;
+  while (received < producers * packetsPerProducer) {
+    int size = queue.pop(packet, sizeof(packet), &meta);
+    if (size <= 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    int id = packet[0];
+    int seq = packet[1] | (packet[2] << 8) | (packet[3] << 16);
+    TEST_ASSERT_LESS_THAN(producers, id);
+    TEST_ASSERT_EQUAL_INT(id, meta.flags);
+    TEST_ASSERT_EQUAL_INT(nextSeq[id], seq);
+    TEST_ASSERT_EQUAL_INT(4 + (seq * 7 + id) % 60, size);
+    for (int i = 4; i < size; i++) TEST_ASSERT_EQUAL_UINT8((byte)(id + seq + i), packet[i]);
+    nextSeq[id]++;
+    received++;
+  }
+  for (auto &thread : threads) thread.join();
+  TEST_ASSERT_EQUAL_INT(0, queue.size());
+}
+
+static void test_throughput(void)
+{
+  RadioQueue queue;
+  byte packet[64] = {};
+  const int iterations = 2000000;
+  auto startTime = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    queue.push(packet, 8 + i % 48);
+    if (i % 4 == 3) {
+      while (queue.pop(packet, sizeof(packet)) > 0) {}
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  char message[96];
+  snprintf(message, sizeof(message), "queue push/pop: %.1f M packets/s", iterations / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_push_pop_keeps_order_and_metadata);
+  RUN_TEST(test_rejects_invalid_sizes);
+  RUN_TEST(test_too_large_packet_is_skipped_on_pop);
+  RUN_TEST(test_overflow_by_slots_and_by_bytes);
+  RUN_TEST(test_commit_rejects_larger_than_reserved);
+  RUN_TEST(test_counts_dropped_packets);
+  RUN_TEST(test_wraps_without_splitting_packets);
+  RUN_TEST(test_randomized_against_model);
+  RUN_TEST(test_burst_fill_and_drain);
+  RUN_TEST(test_concurrent_producers);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
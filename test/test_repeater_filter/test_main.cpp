@@ -0,0 +1,61 @@
+#include <unity.h>
+
+#include "utils/repeater_filter.h"
+#include "mock_transceiver.h"
+
+using namespace LoraDv;
+
+static const uint32_t HangTimeMs = 1000;
+static const MockTransceiver::Params DuplicatingLink = { 0.1f, 0, 0.5f, 0.2f, true };
+
+void setUp(void)
+{
+  nativeMillis() = 0;
+}
+
+void tearDown(void) {}
+
+static void test_stream_is_repeated_once(void)
+{
+  RepeaterFilter filter;
+  for (uint32_t seq = 0; seq < 100; seq++) {
+    TEST_ASSERT_TRUE(filter.check(1, 1, seq, HangTimeMs) == RepeaterFilter::Result::Accept);
+    TEST_ASSERT_TRUE(filter.check(1, 1, seq, HangTimeMs) == RepeaterFilter::Result::Duplicate);
+  }
+}
+
+static void test_other_stream_waits_for_hang_time(void)
+{
+  RepeaterFilter filter;
+  TEST_ASSERT_TRUE(filter.check(1, 1, 0, HangTimeMs) == RepeaterFilter::Result::Accept);
+  nativeMillis() += HangTimeMs - 1;
+  TEST_ASSERT_TRUE(filter.check(2, 1, 0, HangTimeMs) == RepeaterFilter::Result::Busy);
+  nativeMillis() += 1;
+  TEST_ASSERT_TRUE(filter.check(2, 1, 0, HangTimeMs) == RepeaterFilter::Result::Accept);
+  TEST_ASSERT_TRUE(filter.check(1, 1, 1, HangTimeMs) == RepeaterFilter::Result::Busy);
+}
+
+static void test_plain_packets_by_hash(void)
+{
+  RepeaterFilter filter;
+  MockTransceiver link(5, DuplicatingLink);
+  int accepted = 0;
+  for (int i = 0; i < 1000; i++) {
+    MockTransceiver::Packet packet = link.randomPacket(link.randomInt(1, 64));
+    for (const MockTransceiver::Packet &received : link.transmit(packet.data(), packet.size())) {
+      if (filter.check(received.data(), received.size()) == RepeaterFilter::Result::Accept) accepted++;
+    }
+  }
+  // duplicates and late copies arrive within hash ring, every packet is repeated at most once
+  const MockTransceiver::Stats &stats = link.getStats();
+  TEST_ASSERT_EQUAL_INT(stats.sent - stats.lost, accepted);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_stream_is_repeated_once);
+  RUN_TEST(test_other_stream_waits_for_hang_time);
+  RUN_TEST(test_plain_packets_by_hash);
+  return UNITY_END();
+}
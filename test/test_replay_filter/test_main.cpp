@@ -0,0 +1,203 @@
+#include <unity.h>
+#include <map>
+#include <memory>
+
+#include "utils/replay_filter.h"
+#include "mock_transceiver.h"
+
+using namespace LoraDv;
+
+// nvs stand-in, survives filter re-creation the same way nvs survives reboot
+class MemoryReplayStore : public ReplayStore {
+public:
+  MemoryReplayStore() : loads(0), writes(0) {}
+
+  bool loadSender(uint32_t senderId, uint32_t &epoch, uint32_t &seq) override
+  {
+    loads++;
+    auto it = positions.find(senderId);
+    if (it == positions.end()) return false;
+    epoch = it->second.first;
+    seq = it->second.second;
+    return true;
+  }
+
+  void saveSender(uint32_t senderId, uint32_t epoch, uint32_t seq) override
+  {
+    positions[senderId] = std::make_pair(epoch, seq);
+    writes++;
+  }
+
+  std::map<uint32_t, std::pair<uint32_t, uint32_t>> positions;
+  int loads;
+  int writes;
+};
+
+static const MockTransceiver::Params LossyLink = { 0.2f, 0, 0.2f, 0.2f, true };
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// check before and update after authentication, as done by the radio task
+static bool accept(ReplayFilter &filter, uint32_t senderId, uint32_t epoch, uint32_t seq)
+{
+  return filter.check(senderId, epoch, seq) && filter.update(senderId, epoch, seq);
+}
+
+static void test_accepts_once_within_window(void)
+{
+  ReplayFilter filter;
+  for (uint32_t seq = 0; seq < 100; seq++) {
+    TEST_ASSERT_TRUE(accept(filter, 1, 1, seq));
+    TEST_ASSERT_FALSE(filter.check(1, 1, seq));
+  }
+  // late packets inside window are accepted once, older ones are not
+  ReplayFilter gapFilter;
+  TEST_ASSERT_TRUE(accept(gapFilter, 1, 1, 100));
+  TEST_ASSERT_TRUE(accept(gapFilter, 1, 1, 90));
+  TEST_ASSERT_FALSE(accept(gapFilter, 1, 1, 90));
+  TEST_ASSERT_FALSE(accept(gapFilter, 1, 1, 100 - 64));
+}
+
+static void test_older_epoch_is_rejected(void)
+{
+  ReplayFilter filter;
+  TEST_ASSERT_TRUE(accept(filter, 1, 5, 1000));
+  TEST_ASSERT_FALSE(filter.check(1, 4, 2000));
+  // restarted sender begins from zero in the new epoch
+  TEST_ASSERT_TRUE(accept(filter, 1, 6, 0));
+  TEST_ASSERT_FALSE(filter.check(1, 5, 1001));
+}
+
+static void test_replay_after_receiver_reboot(void)
+{
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  {
+    ReplayFilter filter(store);
+    for (uint32_t seq = 0; seq < 500; seq++) TEST_ASSERT_TRUE(accept(filter, 7, 3, seq));
+    // store is not written for every packet
+    TEST_ASSERT_TRUE(store->writes < 10);
+  }
+  ReplayFilter rebooted(store);
+  for (uint32_t seq = 0; seq < 500; seq++) TEST_ASSERT_FALSE(accept(rebooted, 7, 3, seq));
+  TEST_ASSERT_FALSE(accept(rebooted, 7, 2, 10000));
+  TEST_ASSERT_TRUE(accept(rebooted, 7, 4, 0));
+}
+
+static void test_evicted_sender_is_not_new(void)
+{
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  ReplayFilter filter(store);
+  for (uint32_t seq = 0; seq < 10; seq++) TEST_ASSERT_TRUE(accept(filter, 1, 1, seq));
+  // many newer senders push the first one out of the table
+  for (uint32_t senderId = 2; senderId < 100; senderId++) TEST_ASSERT_TRUE(accept(filter, senderId, 1, 0));
+  for (uint32_t seq = 0; seq < 10; seq++) TEST_ASSERT_FALSE(accept(filter, 1, 1, seq));
+  TEST_ASSERT_FALSE(accept(filter, 1, 0, 100));
+  // evicted sender continues right after its last packet
+  TEST_ASSERT_TRUE(accept(filter, 1, 1, 10));
+}
+
+static void test_captured_stream_replayed_over_lossy_link(void)
+{
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  ReplayFilter filter(store);
+  MockTransceiver link(3, LossyLink);
+  std::map<uint32_t, int> accepted;
+
+  // live stream with loss, duplicates and reordering, every sequence is accepted at most once
+  for (uint32_t seq = 0; seq < 2000; seq++) {
+    byte header[4] = { (byte)seq, (byte)(seq >> 8), (byte)(seq >> 16), (byte)(seq >> 24) };
+    for (const MockTransceiver::Packet &packet : link.transmit(header, sizeof(header))) {
+      uint32_t rxSeq = packet[0] | (packet[1] << 8) | (packet[2] << 16) | ((uint32_t)packet[3] << 24);
+      if (accept(filter, 9, 1, rxSeq)) accepted[rxSeq]++;
+    }
+  }
+  for (auto &it : accepted) TEST_ASSERT_EQUAL_INT(1, it.second);
+  TEST_ASSERT_GREATER_THAN(1000, (int)accepted.size());
+
+  // whole capture replayed after reboot
+  ReplayFilter rebooted(store);
+  for (uint32_t seq = 0; seq < 2000; seq++) TEST_ASSERT_FALSE(accept(rebooted, 9, 1, seq));
+}
+
+static void test_check_never_reads_store(void)
+{
+  // check runs before authentication, forged sender ids must not cost store access
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  store->positions[5] = std::make_pair(1u, 100u);
+  ReplayFilter filter(store);
+  MockTransceiver generator(5, LossyLink);
+  for (int i = 0; i < 1000; i++) {
+    filter.check(generator.randomInt(0, 0x7fffffff), 1, generator.randomInt(0, 1000));
+  }
+  TEST_ASSERT_EQUAL_INT(0, store->loads);
+  TEST_ASSERT_EQUAL_INT(0, store->writes);
+  // stored position is applied once the packet is authenticated
+  TEST_ASSERT_TRUE(filter.check(5, 1, 50));
+  TEST_ASSERT_FALSE(filter.update(5, 1, 50));
+  TEST_ASSERT_EQUAL_INT(1, store->loads);
+  TEST_ASSERT_FALSE(filter.check(5, 1, 60));
+  TEST_ASSERT_TRUE(accept(filter, 5, 1, 101));
+}
+
+static void test_interleaved_senders_do_not_thrash_store(void)
+{
+  // senders which collided in a direct mapped table, alternating every packet
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  ReplayFilter filter(store);
+  const uint32_t senders[] = { 1, 9, 17, 25 };
+  for (uint32_t seq = 0; seq < 200; seq++) {
+    for (uint32_t senderId : senders) TEST_ASSERT_TRUE(accept(filter, senderId, 1, seq));
+  }
+  TEST_ASSERT_EQUAL_INT(4, store->loads);
+  TEST_ASSERT_LESS_OR_EQUAL(4 * 2, store->writes);
+}
+
+static void test_least_recently_used_sender_is_evicted(void)
+{
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  ReplayFilter filter(store);
+  for (uint32_t senderId = 1; senderId <= 16; senderId++) TEST_ASSERT_TRUE(accept(filter, senderId, 1, 0));
+  // sender 1 stays active, sender 2 becomes the oldest one
+  TEST_ASSERT_TRUE(accept(filter, 1, 1, 1));
+  TEST_ASSERT_TRUE(accept(filter, 100, 1, 0));
+  int loads = store->loads;
+  TEST_ASSERT_TRUE(accept(filter, 1, 1, 2));
+  TEST_ASSERT_EQUAL_INT(loads, store->loads);
+  // evicted sender is reloaded with its exact position
+  TEST_ASSERT_TRUE(accept(filter, 2, 1, 1));
+  TEST_ASSERT_EQUAL_INT(loads + 1, store->loads);
+}
+
+static void test_random_headers(void)
+{
+  // forged headers are checked but never update the filter, check must not accept what was accepted
+  std::shared_ptr<MemoryReplayStore> store = std::make_shared<MemoryReplayStore>();
+  ReplayFilter filter(store);
+  MockTransceiver generator(4, LossyLink);
+  std::map<std::pair<uint32_t, uint64_t>, bool> seen;
+  for (int i = 0; i < 100000; i++) {
+    uint32_t senderId = generator.randomInt(0, 15);
+    uint32_t epoch = generator.randomInt(0, 3);
+    uint32_t seq = generator.randomInt(0, 200);
+    bool isAccepted = accept(filter, senderId, epoch, seq);
+    std::pair<uint32_t, uint64_t> key(senderId, ((uint64_t)epoch << 32) | seq);
+    if (seen[key]) TEST_ASSERT_FALSE(isAccepted);
+    if (isAccepted) seen[key] = true;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_accepts_once_within_window);
+  RUN_TEST(test_older_epoch_is_rejected);
+  RUN_TEST(test_replay_after_receiver_reboot);
+  RUN_TEST(test_evicted_sender_is_not_new);
+  RUN_TEST(test_captured_stream_replayed_over_lossy_link);
+  RUN_TEST(test_check_never_reads_store);
+  RUN_TEST(test_interleaved_senders_do_not_thrash_store);
+  RUN_TEST(test_least_recently_used_sender_is_evicted);
+  RUN_TEST(test_random_headers);
+  return UNITY_END();
+}
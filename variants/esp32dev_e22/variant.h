@@ -13,4 +13,12 @@
 #define CFG_LORA_PIN_RXEN           32          // (sx127x - unused, sx126x - RXEN pin number)
 #define CFG_LORA_PIN_TXEN           33          // (sx127x - unused, sx126x - TXEN pin number)
 
+// second LoRa module pinouts, used when CFG_LORA2_MODE is set
+#define CFG_LORA2_PIN_NSS           27
+#define CFG_LORA2_PIN_RST           RADIOLIB_NC
+#define CFG_LORA2_PIN_DIO1          35          // (sx127x - dio0, sx126x/sx128x - dio1)
+//#define CFG_LORA2_PIN_BUSY        x           // (sx127x - dio1, sx126x/sx128x - busy), wire to a free gpio
+#define CFG_LORA2_PIN_RXEN          RADIOLIB_NC // (sx127x - unused, sx126x - RXEN pin number)
+#define CFG_LORA2_PIN_TXEN          RADIOLIB_NC // (sx127x - unused, sx126x - TXEN pin number)
+
 #endif // VARIANT_H
\ No newline at end of file